@@ -9,6 +9,8 @@
    an unspecified point that cannot change.
    Validity is checked by ensuring that the time returned is always
    increasing.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -15,6 +15,8 @@
  *   will be executed.]
  * - There is no way of knowing for sure that it was the signal that
  *   stopped clock_nanosleep().
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -10,6 +10,8 @@
  * to the signal, but should resume after a SIGCONT signal is received.
  *
  * SIGSTOP will be used to stop the sleep.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
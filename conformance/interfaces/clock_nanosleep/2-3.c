@@ -9,6 +9,8 @@
  * until a signal whose action is to terminate the process is received
  * for an absolute clock.  [Same as test 1-4.c except with TIMER_ABSTIME
  * set.]
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -8,6 +8,8 @@
  * Test that when clock_nanosleep() is interrupted by a signal, rmtp
  * contains the amount of time remaining (test with relative sleep).
  *
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
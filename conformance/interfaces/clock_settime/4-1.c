@@ -22,6 +22,8 @@
  * 
  * adam.li: I think should check that (abs(T2-T1) <= ACCEPTABLEDELTA)  
  * 2004-04-30 
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -16,6 +16,8 @@
  * - ensure that timer has expired with no error
  *
  * signal SIGTOTEST is used.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
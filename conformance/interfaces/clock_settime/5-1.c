@@ -16,6 +16,8 @@
  * - determine if the time remaining in nanosleep ~= SLEEPDELTA
  *
  * signal SIGTOTEST is used.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
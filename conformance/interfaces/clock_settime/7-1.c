@@ -17,6 +17,8 @@
  * - in parent:  set time back to T0
  * - in child:  ensure time when clock_nanosleep() expires is within
  *   ACCEPTABLEDELTA of T1
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
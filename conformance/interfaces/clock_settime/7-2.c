@@ -16,6 +16,8 @@
  * - in parent:  set time forward to T2 = T1 + SMALLTIME
  * - in child:  ensure clock_nanosleep() expires within ACCEPTABLEDELTA of
  *              T2
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
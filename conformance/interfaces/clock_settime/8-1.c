@@ -15,6 +15,8 @@
  * - in parent:  set time back to T0
  * - in child:  ensure time when clock_nanosleep() expires is within
  *   ACCEPTABLEDELTA of T0+(SLEEPSEC-SMALLTIME)
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
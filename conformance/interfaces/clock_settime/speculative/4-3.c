@@ -26,6 +26,8 @@
  *            george REMOVE-THIS AT mvista DOT com
  *
  * signal SIGTOTEST is used.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -25,6 +25,8 @@
  * - sleep for time TIMERINTERVAL and ensure timer expires (2X)
  *
  * signal SIGTOTEST is used.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -7,6 +7,8 @@
 
  Test that the difftime function shall return the difference between 
  two calendar times.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define WAIT_DURATION 1
@@ -28,6 +28,8 @@
  
  * The test fails if the duration is > 2 seconds or if semaphore is not posted.
  
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
  
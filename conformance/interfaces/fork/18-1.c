@@ -26,6 +26,8 @@
 
 * The test fails if the timer expires in child (timer signal is delivered).
 
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
 */
 
 
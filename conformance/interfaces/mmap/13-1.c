@@ -14,6 +14,8 @@
  * 1. Do stat before mmap() and after munmap(), 
  *    also after writing the mapped region.
  * 2. Compare whether st_atime has been updated. 
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
  /* adam.li@intel.com: On linux, it looks mmap() will update
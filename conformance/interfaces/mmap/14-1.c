@@ -13,6 +13,8 @@
  * as a result of a write reference, then these fields shall be marked
  * for update at some time after the write reference.
  * 
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
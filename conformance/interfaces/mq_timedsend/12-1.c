@@ -4,6 +4,8 @@
  * This file is licensed under the GPL license.  For the full content
  * of this license, see the COPYING file at the top level of this
  * source tree.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 /*
@@ -4,6 +4,8 @@
  * of this license, see the COPYING file at the top level of this
  * source tree.
  * adam.li@intel.com - 2004-04-29
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
 /*
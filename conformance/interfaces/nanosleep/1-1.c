@@ -7,6 +7,8 @@
 
  * Test that nanosleep() causes the current thread to be suspended
  * until the time interval in rqtp passes.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
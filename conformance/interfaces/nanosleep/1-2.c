@@ -7,6 +7,8 @@
 
  * Test that nanosleep() causes the current thread to be suspended
  * until a signal whose action is to terminate the process is received.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -8,6 +8,8 @@
  * Test that nanosleep() causes the current thread to be suspended
  * until a signal whose action is to invoke a signal handling function
  * is received.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
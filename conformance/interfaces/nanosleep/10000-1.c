@@ -13,6 +13,8 @@
  *
  * For invalid parameters, nanosleep should fail with -1 exit and 
  * errno set to EINVAL.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -8,6 +8,8 @@
  * Test that nanosleep() causes the current thread to be suspended
  * until _at least_ the time interval in rqtp passes.
  * Test for a variety of time intervals (in nsecs)
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
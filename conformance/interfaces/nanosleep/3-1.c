@@ -10,6 +10,8 @@
  * - Send a signal to the child process and have the handler exit with
  *   success; if the handler is not called, return 0
  * - In the parent, if the child exitted success, return success.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -7,6 +7,8 @@
  *
  * Regression test motivated by an LKML discussion.  Test that nanosleep()
  * can be interrupted and then continue.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -7,6 +7,8 @@
 
  * Test that nanosleep() returns -1 on failure.
  * Simulate failure condition by sending -1 as the nsec to sleep for.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -8,6 +8,8 @@
  * Test that nanosleep() returns -1 if interrupted.
  * Test by sending a signal to a child doing nanosleep().  If nanosleep
  * returns -1, return success from the child.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -7,6 +7,8 @@
 
  * Test that nanosleep() sets errno to EINVAL if rqtp contained a 
  * nanosecond value < 0 or >= 1,000 million
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -8,6 +8,8 @@
  * Test that nanosleep() sets errno to EINTR if it is interrupted by a signal.
  * Test by sending a signal to a child doing nanosleep().  If nanosleep
  * errno = EINTR, return success from the child.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
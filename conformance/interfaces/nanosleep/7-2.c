@@ -8,6 +8,8 @@
  * Test that nanosleep() sets rmtp to the time remaining if
  * it is interrupted by a signal.
  * If time remaining is within OKDELTA difference, the test is a pass.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #include <stdio.h>
 #include <time.h>
@@ -18,6 +18,8 @@
  * 2. Main create a child thread
  * 3. Child thread call pthread_barrier_wait(), should block
  * 4. Main call pthread_barrier_init()
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #define _XOPEN_SOURCE 600
 #include <pthread.h>
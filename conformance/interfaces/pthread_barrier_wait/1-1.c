@@ -17,6 +17,8 @@
  * 3. Child thread call pthread_barrier_wait(), should block
  * 4. Main call pthread_barrier_wait(), child and main should all return 
  *    from pthread_barrier_wait()
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #define _XOPEN_SOURCE 600
 #include <pthread.h>
@@ -17,6 +17,8 @@
  * 4.  Call pthread_cancel on the thread.
  * 5.  Make sure that the destructor was called after the cleanup handler
  * 
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <pthread.h>
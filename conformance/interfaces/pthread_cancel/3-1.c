@@ -16,6 +16,8 @@
  * 3. Cancel the thread from main and get timestamp, then block.
  * 4. The cleanup function should be automatically 
  *    executed, else the test will fail.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <pthread.h>
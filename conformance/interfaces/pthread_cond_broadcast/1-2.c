@@ -26,6 +26,8 @@
  *
  *  The test will fail when the threads are not terminated within a certain duration.
  *
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
  
@@ -25,6 +25,8 @@
  *  -> broadcast the condition
  *  -> Every child checks that it owns the mutex (when possible)
  *
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
  
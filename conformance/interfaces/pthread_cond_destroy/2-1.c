@@ -27,6 +27,8 @@
  * The test fails if it hangs or if an error is returned, either
  * in the wait routines or in the destroy routine.
  *
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
  
@@ -8,6 +8,8 @@
  * Test that pthread_cond_signal()
  *   shall unblock at least one of the threads currently blocked on
  *   the specified condition variable cond.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
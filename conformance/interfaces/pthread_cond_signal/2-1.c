@@ -9,6 +9,8 @@
  *   When each thread unblocked as a result of pthread_cond_signal() 
  *   returns from its call to pthread_cond_wait(), the thread shall 
  *   own the mutex with which it called pthread_cond_wait().
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
 #define _XOPEN_SOURCE 600
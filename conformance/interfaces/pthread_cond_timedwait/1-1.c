@@ -8,6 +8,8 @@
  * Test that pthread_cond_timedwait()
  *   shall block on a condition variable. It shall be called with mutex locked
  *   by the calling thread or undefined behavior results.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
@@ -14,6 +14,8 @@
  * Case 2-1
  *   Upon successful return, the mutex shall have been locked and shall 
  *   be owned by the calling thread.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
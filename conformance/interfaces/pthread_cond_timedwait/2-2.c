@@ -10,6 +10,8 @@
  *   if the absolute time specified by abstime passes before the condition cond is 
  *   signaled or broadcasted.
  * 
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
 #define _XOPEN_SOURCE 600
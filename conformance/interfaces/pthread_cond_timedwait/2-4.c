@@ -32,6 +32,8 @@
  *    then signals the condition; and checks the child does not leave the wait function.
  * -> The parent unlocks the mutex then waits for the child.
  * -> The child checks that it owns the mutex; then it leaves.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
  /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
@@ -26,6 +26,8 @@
  *   ->  this thread locks a mutex then waits for a condition
  * -> cancel the thread
  *   -> the cancelation handler will test if the thread owns the mutex.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
  /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
@@ -31,6 +31,8 @@
  *    then sleeps until the timeout is terminated; and checks the child does not leave the wait function.
  * -> The parent unlocks the mutex then waits for the child.
  * -> The child checks that it owns the mutex; then it leaves.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
  /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
@@ -7,6 +7,8 @@
 
  * Test that pthread_cond_timedwait()
  *   Upon successful completion, a value of zero shall be returned.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
 #define _XOPEN_SOURCE 600
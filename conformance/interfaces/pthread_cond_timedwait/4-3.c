@@ -27,6 +27,8 @@
  * -> Another thread will signal this condition from time to time.
  * -> Another thread which loops on sending a signal to the first thread.
  * 
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
  /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
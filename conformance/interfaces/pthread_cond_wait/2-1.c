@@ -8,6 +8,8 @@
  * Test that pthread_cond_wait()
  *   Upon successful return, the mutex shall have been locked and shall be owned 
  *   by the calling thread.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
  
 #define _XOPEN_SOURCE 600
@@ -17,6 +17,8 @@
  *     seconds. This is done for 'timeing-out' reasons, in case main DOES
  *     wait for the thread to return.  This would also mean that the test
  *     failed.  
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <pthread.h>
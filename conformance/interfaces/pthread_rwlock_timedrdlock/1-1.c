@@ -22,6 +22,8 @@
  *     using pthread_rwlock_timedrdlock, should block
  *     but when the timer expires, the wait will be terminated
  * 7.  Main thread unlock 'rwlock'
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 #define _XOPEN_SOURCE 600
 #include <pthread.h>
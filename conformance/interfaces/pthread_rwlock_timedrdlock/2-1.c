@@ -18,6 +18,8 @@
  *     a timeout value of 1. (this ensures that the abs_timeout has already passed)
  * 4.  The thread lock 'rwlock' for reading, using pthread_rwlock_timedrdlock(). Should
  *	get an ETIMEOUT error. 
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
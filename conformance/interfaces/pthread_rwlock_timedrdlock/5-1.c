@@ -19,6 +19,8 @@
  * 4.  The child thread lock 'rwlock' for reading, with pthread_rwlock_timedrdlock(), 
  *	specifying a 'abs_timeout'. The thread sleeps until 'abs_timeout' expires.
  * 5.  The thread call pthread_rwlock_timedrdlock(). Should _NOT_ get ETIMEDOUT.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
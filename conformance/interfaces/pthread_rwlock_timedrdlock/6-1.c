@@ -24,6 +24,8 @@
  * 7. When the wait is terminated, check that the thread wait for a proper period before
  *    expiring. 
  *
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
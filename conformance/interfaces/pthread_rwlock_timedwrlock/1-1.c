@@ -24,6 +24,8 @@
  * 8.  Create child thread to lock 'rwlock' for writing, using pthread_rwlock_timedwrlock,
  *	 it should block but when the timer expires, the wait will be terminated
  * 8.  Main thread unlocks 'rwlock'
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
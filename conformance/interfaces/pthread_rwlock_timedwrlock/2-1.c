@@ -19,6 +19,8 @@
  *     passed.
  * 4.  The thread locks 'rwlock' for writing, using pthread_rwlock_timedwrlock(). Should
  *	get an ETIMEOUT error. 
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
@@ -19,6 +19,8 @@
  * 5.  The child thread lock 'rwlock' for write, with pthread_rwlock_timedwrlock(), 
  *	specifying a 'abs_timeout'. The thread sleeps untile 'abs_timeout' expires.
  * 6.  The thread call pthread_rwlock_timedwrlock(). Should not get ETIMEDOUT.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
@@ -22,6 +22,8 @@
  * 6. While sig_thread sleeping in signal handler, main thread unlock 'rwlock' 
  * 7. check that when thread handler returns, sig_thread get the read lock without 
  *    getting ETIMEDOUT.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
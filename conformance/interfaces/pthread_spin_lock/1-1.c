@@ -18,6 +18,8 @@
  * 3.  Create a child thread. The thread lock 'spinlock', should spin. 
  * 4.  After child thread spin for 2 seconds, send SIGALRM to it.
  * 5.  Child thread check its status in the signal handler.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
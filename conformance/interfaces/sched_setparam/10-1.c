@@ -24,6 +24,8 @@
  *   4. Call sched_setparam with a priority smaller than those of children.
  *   5. Check if the shared value has been changed by a child process. If not,
  *      the test fail.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
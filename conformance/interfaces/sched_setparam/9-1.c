@@ -29,6 +29,8 @@
  *      last children.
  *   5. Check if the shared value has been changed by the child process. If
  *      not, the test fail.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
@@ -15,6 +15,8 @@
  * This test launch NPROCESS processes which all try to open NLOOP shared
  * memory objects. If an unexpected error occurs or if the number of created
  * objects is not NLOOP, the test failed. In other case the test is unresolved.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 /* ftruncate was formerly an XOPEN extension. We define _XOPEN_SOURCE here to
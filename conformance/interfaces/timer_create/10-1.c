@@ -8,6 +8,8 @@
  * Test that CLOCK_PROCESS_CPUTIME_ID is supported by timer_create().
  *
  * Same test as 1-1.c.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #define _XOPEN_SOURCE 600
@@ -10,6 +10,8 @@
  * Test that CLOCK_MONOTONIC is supported by timer_create().
  *
  * Same test as 1-1.c with CLOCK_MONOTONIC.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <time.h>
@@ -26,6 +26,8 @@
  *            was set to return PTS_UNRESOLVED if nanosleep() was interrupted,
  *            even though expected behavior is that it be interrupted once
  *            to catch the signal.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <time.h>
@@ -28,6 +28,8 @@
  * Note:  This test is identical to 1-1.c minus the evp lines.
  *
  * For this test clock CLOCK_REALTIME will be used.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <time.h>
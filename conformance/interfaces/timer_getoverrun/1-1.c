@@ -12,6 +12,8 @@
  * - Set up a repeating timer to expire with signal SIGTOTEST.
  * - Sleep for enough time for > 2 signals to be sent.
  * - After the signals are unblocked, ensure only one signal is sent.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <signal.h>
@@ -15,6 +15,8 @@
  * - Wait for that timer to expire twice (wait VALUESEC + INTERVALSEC).
  * - Call timer_getoverrun() and ensure 1 (EXPECTEDOVERRUNS) was returned.
  *   [First signal made it.  Second signal was the overrun.]
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <signal.h>
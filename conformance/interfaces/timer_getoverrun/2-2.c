@@ -17,6 +17,8 @@
  *   (EXPECTEDIVERRUNS)*INTERVALNSEC).
  * - Call timer_getoverrun() and ensure EXPECTEDOVERRUNS was returned.
  *   [First signal made it.  All others were overruns.]
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <signal.h>
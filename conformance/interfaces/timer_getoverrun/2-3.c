@@ -33,6 +33,8 @@
  *   - It seems disalarm the timer before calling timer_getoverun() will discard
  *     previous overrun (when testing on libc-2004-04-29
  *   - Make itvalue = 1 sec. 
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <signal.h>
@@ -16,6 +16,8 @@
  * Signal SIGCONT will be used so that it will not affect the test if
  * the timer expires.
  * Clock CLOCK_REALTIME will be used.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <time.h>
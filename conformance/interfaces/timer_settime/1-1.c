@@ -22,6 +22,8 @@
  *
  * For this test, signal SIGTOTEST will be used, clock CLOCK_REALTIME
  * will be used.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <time.h>
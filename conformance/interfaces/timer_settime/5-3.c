@@ -14,6 +14,8 @@
  * Note:  This test was made in response to a bug seen where timers
  *        would return -1 intermittently on time values generally
  *        > 9000 seconds before the current time.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <time.h>
@@ -15,6 +15,8 @@
  *
  * For this test, signal SIGCONT will be used so that the test will
  * not abort.  Clock CLOCK_REALTIME will be used.
+ *
+ * PTS_REAL_TIME: this test depends on real sleep durations.
  */
 
 #include <time.h>
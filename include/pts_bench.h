@@ -0,0 +1,302 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * Common routines for the bench* programs of the stress directories.
+ *
+ * A benchmark runs each configuration for a fixed duration: the worker
+ * threads are created, wait at a start gate until all of them are
+ * ready, then loop until the main thread closes the gate.
+ *
+ * NTHREADS_MAX may be defined on the command line to set the maximum #
+ * of threads of the sweeps (0, the default, lets pts_max_threads decide).
+ * PTS_CACHE_LINE is the size used to pad the per-thread counters, so
+ * that the counters of two threads never share a cache line.
+ *
+ * unsigned long long pts_now_ns(void)
+ *    returns the CLOCK_MONOTONIC time, in nanoseconds.
+ * void pts_spin_ns(unsigned long long ns)
+ *    busy-waits for ns nanoseconds (used to emulate some work).
+ * void pts_sleep_ms(long ms)
+ *    sleeps for ms milliseconds, even if interrupted by a signal.
+ * long pts_ncpus(void)
+ *    returns the number of online processors (at least 1).
+ * int pts_max_threads(int per_cpu)
+ *    returns NTHREADS_MAX if it is set, per_cpu threads per processor
+ *    otherwise; never less than 2, so the contended cases always run.
+ * int pts_next_count(int n, int max)
+ *    iterates over 1, 2, 4, ... max (max is always included);
+ *    returns 0 after max.
+ * double pts_fairness(const unsigned long long * v, int n)
+ *    returns the Jain fairness index of the n values: 1.0 when all
+ *    values are equal, 1/n when a single one is non-zero.
+ * int pts_cmp_dbl(const void * a, const void * b)
+ *    qsort comparison routine for an array of doubles.
+ *
+ * int pts_gate_init(pts_gate_t * g)
+ * int pts_gate_destroy(pts_gate_t * g)
+ * int pts_gate_ready(pts_gate_t * g)
+ *    called by each worker: waits for the gate to be opened.
+ * int pts_gate_open(pts_gate_t * g, int n)
+ *    called by the main thread: waits for n workers, then releases them.
+ * void pts_gate_close(pts_gate_t * g)
+ *    tells the workers to stop; they check pts_gate_closed(g).
+ *
+ * int pts_bench_run(pts_gate_t * g, int n, void * (*fn)(void *),
+ *                   void * args, size_t size, long ms,
+ *                   unsigned long long * start, unsigned long long * end)
+ *    runs n threads of fn behind the gate g: thread #i gets
+ *    (char *) args + i * size as argument, or i itself (cast to a
+ *    pointer) when args is NULL, and shall call pts_gate_ready(g).
+ *    With ms > 0, the gate is closed ms milliseconds after it opened;
+ *    with ms == 0, the threads return by themselves. All the threads
+ *    are joined before the return. *start receives the opening time of
+ *    the gate, and *end the closing time (ms > 0) or the time the last
+ *    thread was joined; both may be NULL. On error the threads already
+ *    started are left behind, as the caller is expected to give up.
+ *
+ * The gate and run routines return 0 or the error code of the failing
+ * pthread routine.
+ */
+
+#ifndef PTS_BENCH_H
+#define PTS_BENCH_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef NTHREADS_MAX
+#define NTHREADS_MAX 0
+#endif
+
+#define PTS_CACHE_LINE 64
+
+static inline
+unsigned long long pts_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline
+void pts_spin_ns(unsigned long long ns)
+{
+	unsigned long long end;
+
+	if (ns == 0)
+		return;
+
+	end = pts_now_ns() + ns;
+	while (pts_now_ns() < end)
+		;
+}
+
+static inline
+void pts_sleep_ms(long ms)
+{
+	struct timespec ts, rem;
+
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000;
+
+	while ((nanosleep(&ts, &rem) == -1) && (errno == EINTR))
+		ts = rem;
+}
+
+static inline
+long pts_ncpus(void)
+{
+	long n;
+
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0) ? n : 1;
+}
+
+static inline
+int pts_max_threads(int per_cpu)
+{
+	long n;
+
+	n = (NTHREADS_MAX > 0) ? NTHREADS_MAX : per_cpu * pts_ncpus();
+	return (n < 2) ? 2 : (int) n;
+}
+
+static inline
+int pts_next_count(int n, int max)
+{
+	if (n >= max)
+		return 0;
+	if (n <= 0)
+		return 1;
+	return (2 * n < max) ? 2 * n : max;
+}
+
+static inline
+double pts_fairness(const unsigned long long * v, int n)
+{
+	double s = 0.0, s2 = 0.0;
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		s += (double) v[i];
+		s2 += (double) v[i] * (double) v[i];
+	}
+
+	if (s2 == 0.0)
+		return 1.0;
+
+	return (s * s) / (n * s2);
+}
+
+static inline
+int pts_cmp_dbl(const void * a, const void * b)
+{
+	double d = *(const double *)a - *(const double *)b;
+	return (d > 0) - (d < 0);
+}
+
+typedef struct
+{
+	pthread_mutex_t mtx;
+	pthread_cond_t cnd;
+	int ready;           /* # of workers waiting at the gate */
+	int open;
+	volatile int closed; /* read without the mutex by the workers */
+} pts_gate_t;
+
+static inline
+int pts_gate_init(pts_gate_t * g)
+{
+	int ret;
+
+	g->ready = 0;
+	g->open = 0;
+	g->closed = 0;
+
+	ret = pthread_mutex_init(&g->mtx, NULL);
+	if (ret != 0)
+		return ret;
+
+	return pthread_cond_init(&g->cnd, NULL);
+}
+
+static inline
+int pts_gate_destroy(pts_gate_t * g)
+{
+	int ret;
+
+	ret = pthread_cond_destroy(&g->cnd);
+	if (ret != 0)
+		return ret;
+
+	return pthread_mutex_destroy(&g->mtx);
+}
+
+static inline
+int pts_gate_ready(pts_gate_t * g)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(&g->mtx);
+	if (ret != 0)
+		return ret;
+
+	g->ready++;
+	ret = pthread_cond_broadcast(&g->cnd);
+
+	while ((ret == 0) && !g->open)
+		ret = pthread_cond_wait(&g->cnd, &g->mtx);
+
+	pthread_mutex_unlock(&g->mtx);
+	return ret;
+}
+
+static inline
+int pts_gate_open(pts_gate_t * g, int n)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(&g->mtx);
+	if (ret != 0)
+		return ret;
+
+	while ((ret == 0) && (g->ready < n))
+		ret = pthread_cond_wait(&g->cnd, &g->mtx);
+
+	if (ret == 0)
+	{
+		g->open = 1;
+		ret = pthread_cond_broadcast(&g->cnd);
+	}
+
+	pthread_mutex_unlock(&g->mtx);
+	return ret;
+}
+
+static inline
+void pts_gate_close(pts_gate_t * g)
+{
+	g->closed = 1;
+}
+
+static inline
+int pts_gate_closed(pts_gate_t * g)
+{
+	return g->closed;
+}
+
+static inline
+int pts_bench_run(pts_gate_t * g, int n, void * (*fn)(void *),
+                  void * args, size_t size, long ms,
+                  unsigned long long * start, unsigned long long * end)
+{
+	pthread_t * th;
+	void * arg;
+	int ret, i;
+
+	th = (pthread_t *) calloc(n, sizeof(pthread_t));
+	if (th == NULL)
+		return ENOMEM;
+
+	ret = pts_gate_init(g);
+
+	for (i = 0; (ret == 0) && (i < n); i++)
+	{
+		arg = (args != NULL) ? (void *) ((char *) args + i * size) : (void *) (long) i;
+		ret = pthread_create(&th[i], NULL, fn, arg);
+	}
+
+	if (ret == 0)
+		ret = pts_gate_open(g, n);
+	if (start != NULL)
+		*start = pts_now_ns();
+
+	if ((ret == 0) && (ms > 0))
+	{
+		pts_sleep_ms(ms);
+		pts_gate_close(g);
+		if (end != NULL)
+			*end = pts_now_ns();
+	}
+
+	for (i = 0; (ret == 0) && (i < n); i++)
+		ret = pthread_join(th[i], NULL);
+
+	if ((ret == 0) && (ms == 0) && (end != NULL))
+		*end = pts_now_ns();
+
+	if (ret == 0)
+		ret = pts_gate_destroy(g);
+
+	free(th);
+	return ret;
+}
+
+#endif /* PTS_BENCH_H */
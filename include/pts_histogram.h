@@ -0,0 +1,184 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * Latency histograms for the stress and s-c* tests.
+ *
+ * The averages computed by the tests hide the rare slow operations.
+ * The following routines record every latency (in nanoseconds) in a
+ * log-linear histogram, in the manner of HdrHistogram: each power of 2
+ * is divided into PTS_HIST_SUB linear buckets, so any value is known
+ * with a relative error below 1 / PTS_HIST_SUB (about 3%) whatever its
+ * magnitude, in a fixed size table.
+ *
+ * Recording takes no lock: each thread owns its histogram, and the
+ * histograms are merged once the threads are joined.
+ *
+ * void pts_hist_init(pts_hist_t * h)
+ * void pts_hist_record(pts_hist_t * h, unsigned long long ns)
+ * void pts_hist_record_ts(pts_hist_t * h, const struct timespec * ref,
+ *                         const struct timespec * fin)
+ *    records the duration from ref to fin.
+ * void pts_hist_merge(pts_hist_t * dst, const pts_hist_t * src)
+ * unsigned long long pts_hist_percentile(const pts_hist_t * h, double p)
+ *    returns the value below which p percent of the records lie.
+ * void pts_hist_report(const char * name, const pts_hist_t * h)
+ *    prints the count, mean, p50, p99, p99.9 and max values.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* log2 of the number of linear buckets per power of 2 */
+#define PTS_HIST_SUB_BITS 5
+#define PTS_HIST_SUB      (1 << PTS_HIST_SUB_BITS)
+
+/* Values below PTS_HIST_SUB are exact, then one row per remaining power of 2 */
+#define PTS_HIST_NBUCKETS (PTS_HIST_SUB * (64 - PTS_HIST_SUB_BITS + 1))
+
+typedef struct
+{
+	unsigned long long count;
+	unsigned long long min;
+	unsigned long long max;
+	double sum;
+	unsigned long long buckets[PTS_HIST_NBUCKETS];
+} pts_hist_t;
+
+static inline
+void pts_hist_init(pts_hist_t * h)
+{
+	memset(h, 0, sizeof(pts_hist_t));
+	h->min = ~0ULL;
+}
+
+static inline
+int pts_hist_msb(unsigned long long v)
+{
+	int b = 0;
+
+	while (v >>= 1)
+		b++;
+
+	return b;
+}
+
+static inline
+int pts_hist_index(unsigned long long v)
+{
+	int e;
+
+	if (v < PTS_HIST_SUB)
+		return (int) v;
+
+	/* v lies in [PTS_HIST_SUB << e, PTS_HIST_SUB << (e + 1)) */
+	e = pts_hist_msb(v) - PTS_HIST_SUB_BITS;
+	return PTS_HIST_SUB * e + (int) (v >> e);
+}
+
+/* Highest value which falls in bucket idx */
+static inline
+unsigned long long pts_hist_bucket_max(int idx)
+{
+	int e;
+
+	if (idx < PTS_HIST_SUB)
+		return (unsigned long long) idx;
+
+	e = idx / PTS_HIST_SUB - 1;
+	return ((((unsigned long long) (idx % PTS_HIST_SUB + PTS_HIST_SUB)) + 1) << e) - 1;
+}
+
+static inline
+void pts_hist_record(pts_hist_t * h, unsigned long long ns)
+{
+	h->buckets[pts_hist_index(ns)]++;
+	h->count++;
+	h->sum += (double) ns;
+	if (ns < h->min)
+		h->min = ns;
+	if (ns > h->max)
+		h->max = ns;
+}
+
+static inline
+void pts_hist_record_ts(pts_hist_t * h, const struct timespec * ref, const struct timespec * fin)
+{
+	long long ns;
+
+	ns = (fin->tv_sec - ref->tv_sec) * 1000000000LL + (fin->tv_nsec - ref->tv_nsec);
+
+	/* CLOCK_REALTIME may step backward */
+	if (ns < 0)
+		ns = 0;
+
+	pts_hist_record(h, (unsigned long long) ns);
+}
+
+static inline
+void pts_hist_merge(pts_hist_t * dst, const pts_hist_t * src)
+{
+	int i;
+
+	if (src->count == 0)
+		return;
+
+	for (i = 0; i < PTS_HIST_NBUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+static inline
+unsigned long long pts_hist_percentile(const pts_hist_t * h, double p)
+{
+	unsigned long long rank, seen = 0;
+	unsigned long long v;
+	int i;
+
+	if (h->count == 0)
+		return 0;
+
+	rank = (unsigned long long) (p / 100.0 * (double) h->count + 0.5);
+	if (rank < 1)
+		rank = 1;
+	if (rank > h->count)
+		rank = h->count;
+
+	for (i = 0; i < PTS_HIST_NBUCKETS; i++)
+	{
+		seen += h->buckets[i];
+		if (seen >= rank)
+			break;
+	}
+
+	/* The bucket bound may exceed the largest recorded value */
+	v = pts_hist_bucket_max(i);
+	return (v > h->max) ? h->max : v;
+}
+
+static inline
+void pts_hist_report(const char * name, const pts_hist_t * h)
+{
+	if (h->count == 0)
+	{
+		printf("%s: no data\n", name);
+		return;
+	}
+
+	printf("%s: %llu ops, latency (us) mean %.3f p50 %.3f p99 %.3f p99.9 %.3f max %.3f\n",
+	       name,
+	       h->count,
+	       h->sum / (double) h->count / 1000.0,
+	       pts_hist_percentile(h, 50.0) / 1000.0,
+	       pts_hist_percentile(h, 99.0) / 1000.0,
+	       pts_hist_percentile(h, 99.9) / 1000.0,
+	       h->max / 1000.0);
+}
@@ -0,0 +1,487 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * CPU placement of the threads for the scalability (s-c*) tests.
+ *
+ * The following placements are available:
+ *  none    -- the threads are not pinned (scheduler decides).
+ *  compact -- thread #i is pinned to the i-th CPU, filling the hardware
+ *             threads of a core, then the cores of a package, then the
+ *             next package.
+ *  scatter -- thread #i is pinned so that consecutive threads land on
+ *             different packages (NUMA nodes) and cores first.
+ *  node    -- thread #i is allowed on every CPU of the (i % #nodes)-th
+ *             NUMA node.
+ *
+ * int pts_placement_init(void)
+ *    discovers the topology; returns the number of usable CPUs,
+ *    or 0 if placement is not supported on this system.
+ * int pts_place_thread(int index)
+ *    pins the calling thread (or process) according to the current
+ *    placement; index 0 is the main thread. Returns 0 or an error code.
+ * void pts_placement_sweep(void)
+ *    runs the remaining of the test once per placement, each run in a
+ *    child process, then merges the "# COLUMNS" outputs of all the runs
+ *    into one table (a column per series and placement) and exits with
+ *    the first non-PASS status. It returns only in the children, with
+ *    pts_placement set and the main thread already placed.
+ *
+ * Placement relies on the Linux affinity API, so the test must define
+ * _GNU_SOURCE before any include; otherwise pts_placement_init returns 0
+ * and the sweep runs the test once, unpinned.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "posixtest.h"
+#include "pts_bench.h"
+
+#define PTS_PLACE_NONE    0
+#define PTS_PLACE_COMPACT 1
+#define PTS_PLACE_SCATTER 2
+#define PTS_PLACE_NODE    3
+#define PTS_NPLACEMENTS   4
+
+#if defined(__linux__) && defined(_GNU_SOURCE)
+#define PTS_HAVE_AFFINITY
+#define PTS_MAX_CPUS CPU_SETSIZE
+#else
+#define PTS_MAX_CPUS 1
+#endif
+
+#define PTS_SYSFS_CPU "/sys/devices/system/cpu"
+
+/* Maximum length of an output line of the tests */
+#define PTS_LINE_MAX 4096
+
+typedef struct
+{
+	int ncpus;
+	int cpu[PTS_MAX_CPUS];     /* The CPUs we are allowed to run on */
+	int package[PTS_MAX_CPUS];
+	int core[PTS_MAX_CPUS];
+	int node[PTS_MAX_CPUS];
+	int smt[PTS_MAX_CPUS];     /* Rank of this CPU among its core siblings */
+	int corerank[PTS_MAX_CPUS];/* Rank of its core within its package */
+	int compact[PTS_MAX_CPUS]; /* Indexes in cpu[] in compact order */
+	int scatter[PTS_MAX_CPUS]; /* Indexes in cpu[] in scatter order */
+	int nnodes;
+	int nodes[PTS_MAX_CPUS];   /* The distinct node ids */
+} pts_topology_t;
+
+static pts_topology_t pts_topo;
+static int pts_placement = PTS_PLACE_NONE;
+
+static inline
+const char * pts_placement_name(int placement)
+{
+	switch (placement)
+	{
+		case PTS_PLACE_COMPACT: return "compact";
+		case PTS_PLACE_SCATTER: return "scatter";
+		case PTS_PLACE_NODE:    return "node";
+		default:                return "none";
+	}
+}
+
+#ifdef PTS_HAVE_AFFINITY
+
+static inline
+int pts_sysfs_int(int cpu, const char * file)
+{
+	char path[128];
+	FILE * f;
+	int val = 0;
+
+	snprintf(path, sizeof(path), PTS_SYSFS_CPU "/cpu%d/%s", cpu, file);
+	f = fopen(path, "r");
+	if (f == NULL)
+		return 0;
+	if (fscanf(f, "%d", &val) != 1)
+		val = 0;
+	fclose(f);
+	return val;
+}
+
+/* The cpuN directory contains a nodeM link for its NUMA node */
+static inline
+int pts_sysfs_node(int cpu)
+{
+	char path[128];
+	struct dirent * de;
+	DIR * dir;
+	int node = 0;
+
+	snprintf(path, sizeof(path), PTS_SYSFS_CPU "/cpu%d", cpu);
+	dir = opendir(path);
+	if (dir == NULL)
+		return 0;
+	while ((de = readdir(dir)) != NULL)
+	{
+		if ((strncmp(de->d_name, "node", 4) == 0) && (de->d_name[4] >= '0') && (de->d_name[4] <= '9'))
+		{
+			node = atoi(de->d_name + 4);
+			break;
+		}
+	}
+	closedir(dir);
+	return node;
+}
+
+static inline
+int pts_cmp_keys(int a1, int a2, int a3, int a4, int b1, int b2, int b3, int b4)
+{
+	if (a1 != b1) return a1 - b1;
+	if (a2 != b2) return a2 - b2;
+	if (a3 != b3) return a3 - b3;
+	return a4 - b4;
+}
+
+static inline
+int pts_cmp_compact(const void * a, const void * b)
+{
+	int i = *(const int *)a, j = *(const int *)b;
+	return pts_cmp_keys(pts_topo.node[i], pts_topo.package[i], pts_topo.core[i], pts_topo.cpu[i],
+	                    pts_topo.node[j], pts_topo.package[j], pts_topo.core[j], pts_topo.cpu[j]);
+}
+
+static inline
+int pts_cmp_scatter(const void * a, const void * b)
+{
+	int i = *(const int *)a, j = *(const int *)b;
+	return pts_cmp_keys(pts_topo.smt[i], pts_topo.corerank[i], pts_topo.node[i], pts_topo.package[i],
+	                    pts_topo.smt[j], pts_topo.corerank[j], pts_topo.node[j], pts_topo.package[j]);
+}
+
+static inline
+int pts_placement_init(void)
+{
+	cpu_set_t set;
+	int i, j, n;
+
+	pts_topo.ncpus = 0;
+	pts_topo.nnodes = 0;
+
+	if (sched_getaffinity(0, sizeof(set), &set) != 0)
+		return 0;
+
+	for (i = 0; i < CPU_SETSIZE; i++)
+	{
+		if (!CPU_ISSET(i, &set))
+			continue;
+		n = pts_topo.ncpus++;
+		pts_topo.cpu[n] = i;
+		pts_topo.package[n] = pts_sysfs_int(i, "topology/physical_package_id");
+		pts_topo.core[n] = pts_sysfs_int(i, "topology/core_id");
+		pts_topo.node[n] = pts_sysfs_node(i);
+	}
+
+	/* Rank each CPU among its core siblings, and list the nodes */
+	for (i = 0; i < pts_topo.ncpus; i++)
+	{
+		pts_topo.smt[i] = 0;
+		for (j = 0; j < pts_topo.ncpus; j++)
+			if ((pts_topo.package[j] == pts_topo.package[i]) && (pts_topo.core[j] == pts_topo.core[i])
+			 && (pts_topo.cpu[j] < pts_topo.cpu[i]))
+				pts_topo.smt[i]++;
+
+		for (j = 0; j < pts_topo.nnodes; j++)
+			if (pts_topo.nodes[j] == pts_topo.node[i])
+				break;
+		if (j == pts_topo.nnodes)
+			pts_topo.nodes[pts_topo.nnodes++] = pts_topo.node[i];
+
+		pts_topo.compact[i] = i;
+		pts_topo.scatter[i] = i;
+	}
+
+	/* Rank each core within its package, counting the cores through their first CPU */
+	for (i = 0; i < pts_topo.ncpus; i++)
+	{
+		pts_topo.corerank[i] = 0;
+		for (j = 0; j < pts_topo.ncpus; j++)
+			if ((pts_topo.package[j] == pts_topo.package[i]) && (pts_topo.smt[j] == 0)
+			 && (pts_topo.core[j] < pts_topo.core[i]))
+				pts_topo.corerank[i]++;
+	}
+
+	qsort(pts_topo.compact, pts_topo.ncpus, sizeof(int), pts_cmp_compact);
+	qsort(pts_topo.scatter, pts_topo.ncpus, sizeof(int), pts_cmp_scatter);
+
+	return pts_topo.ncpus;
+}
+
+static inline
+int pts_place_thread(int index)
+{
+	cpu_set_t set;
+	int i, node;
+
+	if ((pts_placement == PTS_PLACE_NONE) || (pts_topo.ncpus == 0))
+		return 0;
+
+	CPU_ZERO(&set);
+	switch (pts_placement)
+	{
+		case PTS_PLACE_COMPACT:
+			CPU_SET(pts_topo.cpu[pts_topo.compact[index % pts_topo.ncpus]], &set);
+			break;
+		case PTS_PLACE_SCATTER:
+			CPU_SET(pts_topo.cpu[pts_topo.scatter[index % pts_topo.ncpus]], &set);
+			break;
+		case PTS_PLACE_NODE:
+			node = pts_topo.nodes[index % pts_topo.nnodes];
+			for (i = 0; i < pts_topo.ncpus; i++)
+				if (pts_topo.node[i] == node)
+					CPU_SET(pts_topo.cpu[i], &set);
+			break;
+	}
+
+	/* On Linux, pid 0 designates the calling thread */
+	if (sched_setaffinity(0, sizeof(set), &set) != 0)
+		return errno;
+
+	return 0;
+}
+
+#else /* PTS_HAVE_AFFINITY */
+
+static inline
+int pts_placement_init(void)
+{
+	pts_topo.ncpus = 0;
+	return 0;
+}
+
+static inline
+int pts_place_thread(int index)
+{
+	return (pts_placement == PTS_PLACE_NONE) ? 0 : ENOSYS;
+}
+
+#endif /* PTS_HAVE_AFFINITY */
+
+/* Output of one run of the sweep */
+typedef struct
+{
+	int ncols;          /* As announced in the COLUMNS line, including X */
+	char * header;      /* The column names following the count */
+	int nrows;
+	double * x;
+	char ** rest;       /* The values following X on each row */
+} pts_run_t;
+
+static inline
+char * pts_strdup(const char * s)
+{
+	char * d = malloc(strlen(s) + 1);
+	if (d != NULL)
+		strcpy(d, s);
+	return d;
+}
+
+/* Reads the output of a run; the lines which are not data are forwarded */
+static inline
+void pts_sweep_read(FILE * in, int placement, pts_run_t * run)
+{
+	char line[PTS_LINE_MAX];
+	char * p, * end;
+	double x;
+	int n;
+
+	run->ncols = 0;
+	run->header = NULL;
+	run->nrows = 0;
+	run->x = NULL;
+	run->rest = NULL;
+
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		line[strcspn(line, "\n")] = '\0';
+
+		p = strstr(line, "COLUMNS");
+		if ((line[0] == '#') && (p != NULL) && (run->header == NULL))
+		{
+			run->ncols = (int) strtol(p + 7, &end, 10);
+			run->header = pts_strdup(end);
+			continue;
+		}
+
+		x = strtod(line, &end);
+		if ((run->header != NULL) && (end != line) && ((*end == ' ') || (*end == '\t') || (*end == '\0')))
+		{
+			n = run->nrows++;
+			run->x = realloc(run->x, run->nrows * sizeof(double));
+			run->rest = realloc(run->rest, run->nrows * sizeof(char *));
+			if ((run->x == NULL) || (run->rest == NULL))
+			{
+				printf("Not enough memory to merge the outputs\n");
+				exit(PTS_UNRESOLVED);
+			}
+			run->x[n] = x;
+			run->rest[n] = pts_strdup(end);
+			continue;
+		}
+
+		if (line[0] == '#')
+			printf("%s\n", line);
+		else
+			printf("[%s] %s\n", pts_placement_name(placement), line);
+	}
+}
+
+static inline
+void pts_sweep_merge(pts_run_t * runs)
+{
+	char * names, * tok, * save;
+	double * keys;
+	int nkeys, ncols, p, r, c, k;
+
+	ncols = 1;
+	nkeys = 0;
+	for (p = 0; p < PTS_NPLACEMENTS; p++)
+	{
+		if (runs[p].header != NULL)
+			ncols += runs[p].ncols - 1;
+		nkeys += runs[p].nrows;
+	}
+	if (ncols == 1)
+		return; /* Nothing to plot */
+
+	/* The X column name is taken from the first run with a header */
+	for (p = 0; runs[p].header == NULL; p++);
+	names = pts_strdup(runs[p].header);
+	tok = strtok_r(names, " \t", &save);
+	printf("# COLUMNS %d %s", ncols, (tok != NULL) ? tok : "X");
+	free(names);
+
+	for (p = 0; p < PTS_NPLACEMENTS; p++)
+	{
+		if (runs[p].header == NULL)
+			continue;
+		names = pts_strdup(runs[p].header);
+		tok = strtok_r(names, " \t", &save);
+		for (c = 1; c < runs[p].ncols; c++)
+		{
+			tok = (tok != NULL) ? strtok_r(NULL, " \t", &save) : NULL;
+			if (tok != NULL)
+				printf(" %s/%s", tok, pts_placement_name(p));
+			else
+				printf(" %d/%s", c, pts_placement_name(p));
+		}
+		free(names);
+	}
+	printf("\n");
+
+	/* Build the sorted list of distinct X values */
+	keys = calloc(nkeys + 1, sizeof(double));
+	if (keys == NULL)
+	{
+		printf("Not enough memory to merge the outputs\n");
+		exit(PTS_UNRESOLVED);
+	}
+	k = 0;
+	for (p = 0; p < PTS_NPLACEMENTS; p++)
+		for (r = 0; r < runs[p].nrows; r++)
+			keys[k++] = runs[p].x[r];
+	qsort(keys, nkeys, sizeof(double), pts_cmp_dbl);
+
+	for (k = 0; k < nkeys; k++)
+	{
+		if ((k > 0) && (keys[k] == keys[k - 1]))
+			continue;
+		printf("%g", keys[k]);
+		for (p = 0; p < PTS_NPLACEMENTS; p++)
+		{
+			if (runs[p].header == NULL)
+				continue;
+			for (r = 0; r < runs[p].nrows; r++)
+				if (runs[p].x[r] == keys[k])
+					break;
+			if (r < runs[p].nrows)
+				printf("%s", runs[p].rest[r]);
+			else
+				for (c = 1; c < runs[p].ncols; c++)
+					printf(" NaN");
+		}
+		printf("\n");
+	}
+	free(keys);
+}
+
+static inline
+void pts_placement_sweep(void)
+{
+	pts_run_t runs[PTS_NPLACEMENTS];
+	int fd[2];
+	int p, r, status, result;
+	pid_t child;
+	FILE * in;
+
+	if (pts_placement_init() == 0)
+		return; /* Just run the test once, unpinned */
+
+	result = PTS_PASS;
+
+	for (p = 0; p < PTS_NPLACEMENTS; p++)
+	{
+		/* The child must not inherit the forwarded lines */
+		fflush(stdout);
+
+		if ((pipe(fd) != 0) || ((child = fork()) == (pid_t) -1))
+		{
+			printf("Unable to start the run for placement %s: %s\n", pts_placement_name(p), strerror(errno));
+			exit(PTS_UNRESOLVED);
+		}
+
+		if (child == 0)
+		{
+			close(fd[0]);
+			if (dup2(fd[1], STDOUT_FILENO) == -1)
+				exit(PTS_UNRESOLVED);
+			close(fd[1]);
+			pts_placement = p;
+			if (pts_place_thread(0) != 0)
+				exit(PTS_UNRESOLVED);
+			return;
+		}
+
+		close(fd[1]);
+		in = fdopen(fd[0], "r");
+		if (in == NULL)
+		{
+			printf("Unable to read the run for placement %s\n", pts_placement_name(p));
+			exit(PTS_UNRESOLVED);
+		}
+		pts_sweep_read(in, p, &runs[p]);
+		fclose(in);
+
+		while ((waitpid(child, &status, 0) == -1) && (errno == EINTR));
+		if ((result == PTS_PASS) && (!WIFEXITED(status) || (WEXITSTATUS(status) != PTS_PASS)))
+			result = WIFEXITED(status) ? WEXITSTATUS(status) : PTS_UNRESOLVED;
+	}
+
+	pts_sweep_merge(runs);
+
+	for (p = 0; p < PTS_NPLACEMENTS; p++)
+	{
+		for (r = 0; r < runs[p].nrows; r++)
+			free(runs[p].rest[r]);
+		free(runs[p].rest);
+		free(runs[p].x);
+		free(runs[p].header);
+	}
+
+	fflush(stdout);
+	exit(result);
+}
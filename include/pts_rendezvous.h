@@ -0,0 +1,261 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * Readiness handshakes for the tests.
+ *
+ * Many tests need to wait until another thread is blocked (in
+ * pthread_mutex_lock, pthread_cond_wait, sem_wait, ...) before they can
+ * go on. Instead of a sleep(1) or a sched_yield() loop, the following
+ * routines poll the thread states from /proc/self/task and return as
+ * soon as the expected state is reached, or after a bounded delay.
+ *
+ * pid_t pts_gettid(void)
+ *    returns the kernel id of the calling thread, or -1 if unknown.
+ * int pts_wait_blocked(pid_t tid, long timeout_ms)
+ *    waits until thread tid is blocked on a futex.
+ * int pts_wait_nblocked(int n, long timeout_ms)
+ *    waits until n threads of the process (other than the caller)
+ *    are blocked on a futex.
+ * int pts_wait_sleeping(pid_t tid, long timeout_ms)
+ *    waits until thread tid sleeps, whatever it waits for; for the
+ *    waits which are not on a futex (nanosleep, mq_receive, ...).
+ *
+ * A thread is blocked on a futex when it is sleeping (state S or D) and
+ * its wait channel (/proc/self/task/<tid>/wchan) names a futex routine.
+ * When the wait channel is hidden (it reads "0" without the proper
+ * privileges on recent kernels) any sleeping thread is taken as blocked:
+ * a thread sleeping in a read() or a nanosleep() cannot be told apart.
+ *
+ * The wait routines return 0 when the state is reached, ETIMEDOUT
+ * when timeout_ms milliseconds have elapsed before, and ESRCH when tid
+ * does not exist. When the thread states cannot be read (no /proc, or
+ * tid is -1) they return ENOSYS at once; the caller shall then fall
+ * back to its former sleep-based synchronization, for example:
+ *
+ *	if (pts_wait_blocked(tid, 1000) == ENOSYS)
+ *		sleep(1);
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#define PTS_TASK_DIR "/proc/self/task"
+
+/* Delay between two polls of the thread states */
+#define PTS_POLL_NS 200000
+
+static inline
+pid_t pts_gettid(void)
+{
+	char buf[64];
+	char *p;
+	ssize_t len;
+
+	/* The link target is "<pid>/task/<tid>" */
+	len = readlink("/proc/thread-self", buf, sizeof(buf) - 1);
+	if (len <= 0)
+		return -1;
+	buf[len] = '\0';
+
+	p = strrchr(buf, '/');
+	if (p == NULL)
+		return -1;
+
+	return (pid_t) atol(p + 1);
+}
+
+/* Returns the state letter of thread tid (R, S, D, ...), 0 if it does not exist */
+static inline
+char pts_task_state(pid_t tid)
+{
+	char path[64];
+	char buf[512];
+	char *p;
+	ssize_t len;
+	int fd;
+
+	snprintf(path, sizeof(path), PTS_TASK_DIR "/%ld/stat", (long) tid);
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return 0;
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0)
+		return 0;
+	buf[len] = '\0';
+
+	/* The format is "tid (comm) state ...", and comm may contain ')' */
+	p = strrchr(buf, ')');
+	if ((p == NULL) || (p[1] != ' '))
+		return 0;
+
+	return p[2];
+}
+
+static inline
+int pts_task_sleeping(char state)
+{
+	return (state == 'S') || (state == 'D');
+}
+
+/* Returns 1 if thread tid waits on a futex, 0 if it waits on something
+   else, and -1 if its wait channel cannot be read */
+static inline
+int pts_task_futex_wait(pid_t tid)
+{
+	char path[64];
+	char buf[128];
+	ssize_t len;
+	int fd;
+
+	snprintf(path, sizeof(path), PTS_TASK_DIR "/%ld/wchan", (long) tid);
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return -1;
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0)
+		return -1;
+	buf[len] = '\0';
+
+	if (strcmp(buf, "0") == 0)
+		return -1;
+
+	return strstr(buf, "futex") != NULL;
+}
+
+static inline
+int pts_task_blocked(pid_t tid, char state)
+{
+	return pts_task_sleeping(state) && (pts_task_futex_wait(tid) != 0);
+}
+
+static inline
+int pts_task_dir_available(void)
+{
+	return access(PTS_TASK_DIR, R_OK) == 0;
+}
+
+/* Sleeps one polling period; returns !0 once the deadline has passed */
+static inline
+int pts_poll_expired(const struct timespec *deadline)
+{
+	struct timespec now, ts = { 0, PTS_POLL_NS };
+
+	nanosleep(&ts, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec > deadline->tv_sec) ||
+	       ((now.tv_sec == deadline->tv_sec) && (now.tv_nsec >= deadline->tv_nsec));
+}
+
+static inline
+void pts_deadline(struct timespec *deadline, long timeout_ms)
+{
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	deadline->tv_sec += timeout_ms / 1000;
+	deadline->tv_nsec += (timeout_ms % 1000) * 1000000;
+	if (deadline->tv_nsec >= 1000000000)
+	{
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000;
+	}
+}
+
+static inline
+int pts_wait_blocked(pid_t tid, long timeout_ms)
+{
+	struct timespec deadline;
+	char state;
+
+	if ((tid == -1) || !pts_task_dir_available())
+		return ENOSYS;
+
+	pts_deadline(&deadline, timeout_ms);
+
+	do
+	{
+		state = pts_task_state(tid);
+		if (state == 0)
+			return ESRCH;
+		if (pts_task_blocked(tid, state))
+			return 0;
+	} while (!pts_poll_expired(&deadline));
+
+	return ETIMEDOUT;
+}
+
+static inline
+int pts_wait_nblocked(int n, long timeout_ms)
+{
+	struct timespec deadline;
+	struct dirent *de;
+	DIR *dir;
+	pid_t self;
+	pid_t tid;
+	int count;
+
+	self = pts_gettid();
+
+	if ((self == -1) || !pts_task_dir_available())
+		return ENOSYS;
+
+	pts_deadline(&deadline, timeout_ms);
+
+	do
+	{
+		dir = opendir(PTS_TASK_DIR);
+		if (dir == NULL)
+			return ENOSYS;
+
+		count = 0;
+		while ((de = readdir(dir)) != NULL)
+		{
+			tid = (pid_t) atol(de->d_name);
+			if ((tid <= 0) || (tid == self))
+				continue;
+			if (pts_task_blocked(tid, pts_task_state(tid)))
+				count++;
+		}
+		closedir(dir);
+
+		if (count >= n)
+			return 0;
+	} while (!pts_poll_expired(&deadline));
+
+	return ETIMEDOUT;
+}
+
+static inline
+int pts_wait_sleeping(pid_t tid, long timeout_ms)
+{
+	struct timespec deadline;
+	char state;
+
+	if ((tid == -1) || !pts_task_dir_available())
+		return ENOSYS;
+
+	pts_deadline(&deadline, timeout_ms);
+
+	do
+	{
+		state = pts_task_state(tid);
+		if (state == 0)
+			return ESRCH;
+		if (pts_task_sleeping(state))
+			return 0;
+	} while (!pts_poll_expired(&deadline));
+
+	return ETIMEDOUT;
+}
@@ -0,0 +1,333 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * Scalability analysis for the s-c* tests.
+ *
+ * A test stores each series of measurements (X = # of objects,
+ * Y = duration) in a pts_serie_t, then calls pts_scal_fit to know
+ * whether Y grows with X. The tested models are:
+ * -> Y = k;             (constant)
+ * -> Y = a * X + b;     (linear)
+ * -> Y = c * X ^ a;     (power, fitted as ln(Y) = a ln(X) + ln(c))
+ * -> Y = exp(a * X + b) (exponential, fitted as ln(Y) = a X + b)
+ *
+ * The fits use centered sums in two passes, so large X or Y values do
+ * not cancel out. For each model we report the mean squared error
+ * (divergence) and the coefficient of determination R².
+ *
+ * The serie is considered as not scalable when:
+ * -> one of the growing models fits better than the constant one,
+ *    with the same ponderations as the historical parse_measure
+ *    (1.1 for linear, 1.2 for power, 1.3 for exponential);
+ * -> and the 95% bootstrap confidence interval of the linear slope
+ *    lies entirely above 0, so a trend which could be noise is not
+ *    reported as a failure.
+ *
+ * int pts_serie_add(pts_serie_t * s, double x, double y)
+ *    appends a measure; returns 0 or ENOMEM.
+ * void pts_serie_free(pts_serie_t * s)
+ * int pts_scal_fit(const pts_serie_t * s, pts_fit_t * fit)
+ *    computes the models and the verdict; returns 0 or ENOMEM.
+ * void pts_scal_report(const char * name, const pts_fit_t * fit)
+ *    prints the models and the verdict with output(), so testfrmw.h
+ *    must be included before this file.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pts_bench.h"
+
+#define PTS_MODEL_CONST  0
+#define PTS_MODEL_LINEAR 1
+#define PTS_MODEL_POWER  2
+#define PTS_MODEL_EXP    3
+#define PTS_NMODELS      4
+
+/* Number of resamplings for the confidence interval */
+#ifndef PTS_BOOTSTRAP
+#define PTS_BOOTSTRAP 1000
+#endif
+
+typedef struct
+{
+	int n;
+	int size;  /* allocated length of x and y */
+	double * x;
+	double * y;
+} pts_serie_t;
+
+#define PTS_SERIE_INITIALIZER { 0, 0, NULL, NULL }
+
+typedef struct
+{
+	int n;
+	double a[PTS_NMODELS];   /* Model parameters, see above (k is b) */
+	double b[PTS_NMODELS];
+	double mse[PTS_NMODELS]; /* Divergence; HUGE_VAL if the model does not apply */
+	double r2[PTS_NMODELS];
+	double slope_lo;         /* 95% confidence interval of the linear slope */
+	double slope_hi;
+	int best;                /* The model which fits best */
+	int grows;               /* !0 when the serie is not scalable */
+} pts_fit_t;
+
+static inline
+int pts_serie_add(pts_serie_t * s, double x, double y)
+{
+	double * nx, * ny;
+	int size;
+
+	if (s->n == s->size)
+	{
+		size = (s->size == 0) ? 64 : 2 * s->size;
+		nx = realloc(s->x, size * sizeof(double));
+		if (nx == NULL)
+			return ENOMEM;
+		s->x = nx;
+		ny = realloc(s->y, size * sizeof(double));
+		if (ny == NULL)
+			return ENOMEM;
+		s->y = ny;
+		s->size = size;
+	}
+
+	s->x[s->n] = x;
+	s->y[s->n] = y;
+	s->n++;
+	return 0;
+}
+
+static inline
+void pts_serie_free(pts_serie_t * s)
+{
+	free(s->x);
+	free(s->y);
+	s->x = NULL;
+	s->y = NULL;
+	s->n = 0;
+	s->size = 0;
+}
+
+/* Least squares fit of v = a u + b, with centered sums. Returns the slope. */
+static inline
+double pts_lsq(const double * u, const double * v, int n, double * b)
+{
+	double ubar = 0.0, vbar = 0.0, suu = 0.0, suv = 0.0;
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		ubar += u[i];
+		vbar += v[i];
+	}
+	ubar /= n;
+	vbar /= n;
+
+	for (i = 0; i < n; i++)
+	{
+		suu += (u[i] - ubar) * (u[i] - ubar);
+		suv += (u[i] - ubar) * (v[i] - vbar);
+	}
+
+	if (suu == 0.0)
+	{
+		*b = vbar;
+		return 0.0;
+	}
+
+	*b = vbar - (suv / suu) * ubar;
+	return suv / suu;
+}
+
+/* Small deterministic generator, so a given data set always gets the same verdict */
+static inline
+unsigned int pts_xorshift(unsigned int * state)
+{
+	unsigned int x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static inline
+int pts_bootstrap_slope(const pts_serie_t * s, double * lo, double * hi)
+{
+	double * slopes, * u, * v;
+	double b;
+	unsigned int seed = 2463534242U;
+	int i, r, k;
+
+	slopes = malloc(PTS_BOOTSTRAP * sizeof(double));
+	u = malloc((size_t) s->n * sizeof(double));
+	v = malloc((size_t) s->n * sizeof(double));
+	if ((slopes == NULL) || (u == NULL) || (v == NULL))
+	{
+		free(slopes);
+		free(u);
+		free(v);
+		return ENOMEM;
+	}
+
+	for (r = 0; r < PTS_BOOTSTRAP; r++)
+	{
+		for (i = 0; i < s->n; i++)
+		{
+			k = pts_xorshift(&seed) % s->n;
+			u[i] = s->x[k];
+			v[i] = s->y[k];
+		}
+		slopes[r] = pts_lsq(u, v, s->n, &b);
+	}
+
+	qsort(slopes, PTS_BOOTSTRAP, sizeof(double), pts_cmp_dbl);
+	*lo = slopes[PTS_BOOTSTRAP * 25 / 1000];
+	*hi = slopes[PTS_BOOTSTRAP * 975 / 1000 - 1];
+
+	free(slopes);
+	free(u);
+	free(v);
+	return 0;
+}
+
+static inline
+int pts_scal_fit(const pts_serie_t * s, pts_fit_t * fit)
+{
+	double * lx, * ly;
+	double ybar, sst, e, pred;
+	int i, m, ok_log, ret;
+
+	fit->n = s->n;
+	fit->best = PTS_MODEL_CONST;
+	fit->grows = 0;
+	fit->slope_lo = fit->slope_hi = 0.0;
+	for (m = 0; m < PTS_NMODELS; m++)
+	{
+		fit->a[m] = fit->b[m] = 0.0;
+		fit->mse[m] = HUGE_VAL;
+		fit->r2[m] = 0.0;
+	}
+
+	if (s->n <= 0)
+		return 0;
+
+	/* The logarithmic fits need strictly positive values */
+	ok_log = 1;
+	for (i = 0; i < s->n; i++)
+		if ((s->x[i] <= 0.0) || (s->y[i] <= 0.0))
+			ok_log = 0;
+
+	lx = malloc((size_t) s->n * sizeof(double));
+	ly = malloc((size_t) s->n * sizeof(double));
+	if ((lx == NULL) || (ly == NULL))
+	{
+		free(lx);
+		free(ly);
+		return ENOMEM;
+	}
+	for (i = 0; i < s->n; i++)
+	{
+		lx[i] = ok_log ? log(s->x[i]) : 0.0;
+		ly[i] = ok_log ? log(s->y[i]) : 0.0;
+	}
+
+	/* Parameters */
+	ybar = 0.0;
+	for (i = 0; i < s->n; i++)
+		ybar += s->y[i];
+	ybar /= s->n;
+	fit->b[PTS_MODEL_CONST] = ybar;
+
+	fit->a[PTS_MODEL_LINEAR] = pts_lsq(s->x, s->y, s->n, &fit->b[PTS_MODEL_LINEAR]);
+	if (ok_log)
+	{
+		fit->a[PTS_MODEL_POWER] = pts_lsq(lx, ly, s->n, &fit->b[PTS_MODEL_POWER]);
+		fit->b[PTS_MODEL_POWER] = exp(fit->b[PTS_MODEL_POWER]); /* c */
+		fit->a[PTS_MODEL_EXP] = pts_lsq(s->x, ly, s->n, &fit->b[PTS_MODEL_EXP]);
+	}
+
+	/* Divergences, always computed on Y (not ln Y) so they compare */
+	sst = 0.0;
+	for (i = 0; i < s->n; i++)
+		sst += (s->y[i] - ybar) * (s->y[i] - ybar);
+
+	for (m = 0; m < PTS_NMODELS; m++)
+	{
+		if ((m >= PTS_MODEL_POWER) && !ok_log)
+			continue;
+
+		e = 0.0;
+		for (i = 0; i < s->n; i++)
+		{
+			switch (m)
+			{
+				case PTS_MODEL_CONST:  pred = ybar; break;
+				case PTS_MODEL_LINEAR: pred = fit->a[m] * s->x[i] + fit->b[m]; break;
+				case PTS_MODEL_POWER:  pred = fit->b[m] * pow(s->x[i], fit->a[m]); break;
+				default:               pred = exp(fit->a[m] * s->x[i] + fit->b[m]); break;
+			}
+			e += (s->y[i] - pred) * (s->y[i] - pred);
+		}
+		fit->mse[m] = e / s->n;
+		fit->r2[m] = (sst > 0.0) ? 1.0 - e / sst : 0.0;
+	}
+
+	free(lx);
+	free(ly);
+
+	/* A trend needs at least 3 points to be discussed */
+	if (s->n < 3)
+		return 0;
+
+	if ((fit->mse[PTS_MODEL_CONST] > 1.1 * fit->mse[PTS_MODEL_LINEAR])
+	 || (fit->mse[PTS_MODEL_CONST] > 1.2 * fit->mse[PTS_MODEL_POWER])
+	 || (fit->mse[PTS_MODEL_CONST] > 1.3 * fit->mse[PTS_MODEL_EXP]))
+	{
+		fit->best = PTS_MODEL_LINEAR;
+		for (m = PTS_MODEL_POWER; m < PTS_NMODELS; m++)
+			if (fit->mse[m] < fit->mse[fit->best])
+				fit->best = m;
+	}
+
+	ret = pts_bootstrap_slope(s, &fit->slope_lo, &fit->slope_hi);
+	if (ret != 0)
+		return ret;
+
+	fit->grows = (fit->best != PTS_MODEL_CONST) && (fit->slope_lo > 0.0);
+
+	return 0;
+}
+
+static inline
+void pts_scal_report(const char * name, const pts_fit_t * fit)
+{
+	output("\nSerie: %s\n", name);
+	output(" # of data: %i\n", fit->n);
+
+	output("  Model: Y = k\n");
+	output("       k = %g\n", fit->b[PTS_MODEL_CONST]);
+	output("    Divergence %g\n", fit->mse[PTS_MODEL_CONST]);
+
+	output("  Model: Y = a * X + b\n");
+	output("       a = %g  (95%% CI: %g .. %g)\n", fit->a[PTS_MODEL_LINEAR], fit->slope_lo, fit->slope_hi);
+	output("       b = %g\n", fit->b[PTS_MODEL_LINEAR]);
+	output("    Divergence %g  R2 %g\n", fit->mse[PTS_MODEL_LINEAR], fit->r2[PTS_MODEL_LINEAR]);
+
+	output("  Model: Y = c * X ^ a\n");
+	output("       a = %g\n", fit->a[PTS_MODEL_POWER]);
+	output("       c = %g\n", fit->b[PTS_MODEL_POWER]);
+	output("    Divergence %g  R2 %g\n", fit->mse[PTS_MODEL_POWER], fit->r2[PTS_MODEL_POWER]);
+
+	output("  Model: Y = exp(a * X + b)\n");
+	output("       a = %g\n", fit->a[PTS_MODEL_EXP]);
+	output("       b = %g\n", fit->b[PTS_MODEL_EXP]);
+	output("    Divergence %g  R2 %g\n", fit->mse[PTS_MODEL_EXP], fit->r2[PTS_MODEL_EXP]);
+
+	output(" Sanction: %s\n", fit->grows ? "NOT SCALABLE" : "OK");
+}
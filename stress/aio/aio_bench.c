@@ -0,0 +1,514 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * This is a throughput and latency benchmark of the asynchronous I/O.
+ * For each directory (by default /dev/shm, which is usually a tmpfs,
+ * and the current directory, usually on disk; or the directories given
+ * on the command line), a file of each size of file_sizes[] is created,
+ * then for reads and for writes, each request size of req_sizes[] and
+ * each queue depth of depths[], IO_BYTES bytes are transferred at random
+ * offsets (aligned on the request size) with:
+ *  - pread / pwrite, the synchronous baseline (the depth is always 1);
+ *  - aio_read / aio_write, with aio_suspend to wait for a completion and
+ *    a new request submitted as soon as one completes;
+ *  - lio_listio(LIO_WAIT) with batches of depth requests;
+ *  - lio_listio(LIO_NOWAIT) with batches of depth requests, and a signal
+ *    (SIGEV_SIGNAL) waited for with sigwaitinfo when a batch completes.
+ *
+ * The file is opened with O_DIRECT where the system and the file system
+ * accept it, so that the disk cases do not read from the page cache.
+ * Elsewhere (older tmpfs refuse O_DIRECT) the file is synchronized and its
+ * pages are dropped with posix_fadvise(POSIX_FADV_DONTNEED) before each
+ * case; a case may still hit the pages it has read or written itself.
+ *
+ * The requests per second, the bandwidth, and the p50/p99/max completion
+ * latency (from the submission of a request to the moment the program
+ * knows it is complete) are reported for each case. With lio_listio, the
+ * latency is that of a whole batch, from lio_listio to the completion of
+ * its last request.
+ *
+ * The test fails if a read does not return the data of the file.
+ */
+
+#define _XOPEN_SOURCE 600
+
+/* O_DIRECT is a Linux extension */
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <aio.h>
+
+#include "posixtest.h"
+#include "pts_bench.h"
+#include "pts_histogram.h"
+
+#define IO_BYTES	(16 * 1024 * 1024)	/* per case */
+#define MIN_REQS	64			/* per case */
+#define BLOCK		4096			/* unit of the data pattern */
+#define SIG		SIGRTMIN
+
+long file_sizes[] = { 4 * 1024 * 1024, 64 * 1024 * 1024 };
+long req_sizes[] = { 4096, 64 * 1024, 1024 * 1024 };
+int depths[] = { 1, 8, 32 };
+#define NFILES	(sizeof(file_sizes) / sizeof(file_sizes[0]))
+#define NREQS	(sizeof(req_sizes) / sizeof(req_sizes[0]))
+#define NDEPTHS	(sizeof(depths) / sizeof(depths[0]))
+#define DEPTH_MAX	32
+
+char *default_dirs[] = { "/dev/shm", "." };
+
+#define M_SYNC		0
+#define M_SUSPEND	1
+#define M_LIO_WAIT	2
+#define M_LIO_NOWAIT	3
+#define NMODES		4
+char *modes[] = { "pread/pwrite", "aio+aio_suspend", "lio_listio WAIT",
+	"lio_listio NOWAIT" };
+
+#define OP_READ		0
+#define OP_WRITE	1
+char *ops[] = { "read", "write" };
+
+/* The current case */
+int fd;
+int direct;			/* fd bypasses the page cache */
+long file_size;
+long size;
+int op;
+struct aiocb cbs[DEPTH_MAX];
+const struct aiocb *list[DEPTH_MAX];
+char *bufs[DEPTH_MAX];
+unsigned long long submitted[DEPTH_MAX];
+unsigned int seed;
+sigset_t sigmask;
+long listio_max;
+pts_hist_t *lat;
+
+/* The first byte of each block of the file tells its place */
+static char pattern(off_t off)
+{
+	return (char)((off / BLOCK) % 251);
+}
+
+static void stamp(char *buf, off_t off, long len)
+{
+	long i;
+
+	for (i = 0; i < len; i += BLOCK)
+		buf[i] = pattern(off + i);
+}
+
+static int verify(char *buf, off_t off, long len)
+{
+	long i;
+
+	for (i = 0; i < len; i += BLOCK)
+		if (buf[i] != pattern(off + i))
+			return -1;
+	return 0;
+}
+
+static off_t random_offset(void)
+{
+	return (off_t)(rand_r(&seed) % (file_size / size)) * size;
+}
+
+/* Prepare the request of slot i at a new offset */
+static void prepare(int i)
+{
+	memset(&cbs[i], 0, sizeof(struct aiocb));
+	cbs[i].aio_fildes = fd;
+	cbs[i].aio_offset = random_offset();
+	cbs[i].aio_buf = bufs[i];
+	cbs[i].aio_nbytes = size;
+	cbs[i].aio_lio_opcode = (op == OP_READ) ? LIO_READ : LIO_WRITE;
+	cbs[i].aio_sigevent.sigev_notify = SIGEV_NONE;
+	if (op == OP_WRITE)
+		stamp(bufs[i], cbs[i].aio_offset, size);
+	list[i] = &cbs[i];
+}
+
+/* Check the request of slot i, which is complete */
+static int complete(int i)
+{
+	int err;
+	ssize_t n;
+
+	err = aio_error(&cbs[i]);
+	n = aio_return(&cbs[i]);
+	if ((err != 0) || (n != size)) {
+		printf("A request returned %ld (error %d)\n", (long)n, err);
+		return PTS_UNRESOLVED;
+	}
+	if ((op == OP_READ) && (verify(bufs[i], cbs[i].aio_offset, size) != 0)) {
+		printf("A read at %ld did not return the data of the file\n",
+			(long)cbs[i].aio_offset);
+		return PTS_FAIL;
+	}
+	return PTS_PASS;
+}
+
+/* Before an error return: cancel the requests of the first n slots which
+ * are still in flight and wait for them, so that none of them outlives the
+ * case (and its buffers and file) */
+static void abort_requests(int n)
+{
+	int i;
+
+	aio_cancel(fd, NULL);
+	for (i = 0; i < n; i++) {
+		if (list[i] == NULL)
+			continue;
+		while (aio_error(&cbs[i]) == EINPROGRESS)
+			aio_suspend(&list[i], 1, NULL);
+		aio_return(&cbs[i]);
+		list[i] = NULL;
+	}
+}
+
+static int run_sync(long nreqs, pts_hist_t *lat)
+{
+	off_t off;
+	ssize_t n;
+	unsigned long long t0;
+	long r;
+
+	for (r = 0; r < nreqs; r++) {
+		off = random_offset();
+		if (op == OP_WRITE)
+			stamp(bufs[0], off, size);
+		t0 = pts_now_ns();
+		if (op == OP_READ)
+			n = pread(fd, bufs[0], size, off);
+		else
+			n = pwrite(fd, bufs[0], size, off);
+		pts_hist_record(lat, pts_now_ns() - t0);
+		if (n != size) {
+			perror("pread / pwrite didn't return success \n");
+			return PTS_UNRESOLVED;
+		}
+		if ((op == OP_READ) && (verify(bufs[0], off, size) != 0)) {
+			printf("A read at %ld did not return the data of the file\n",
+				(long)off);
+			return PTS_FAIL;
+		}
+	}
+	return PTS_PASS;
+}
+
+static int submit(int i)
+{
+	prepare(i);
+	submitted[i] = pts_now_ns();
+	if (op == OP_READ)
+		return aio_read(&cbs[i]);
+	return aio_write(&cbs[i]);
+}
+
+static int run_suspend(long nreqs, int depth, pts_hist_t *lat)
+{
+	long sent = 0, done = 0;
+	unsigned long long t;
+	int i, ret;
+
+	for (i = 0; (i < depth) && (sent < nreqs); i++, sent++) {
+		if (-1 == submit(i)) {
+			perror("aio_read / aio_write didn't return success \n");
+			list[i] = NULL;
+			abort_requests(i);
+			return PTS_UNRESOLVED;
+		}
+	}
+	for (; i < depth; i++)
+		list[i] = NULL;
+
+	while (done < nreqs) {
+		if ((-1 == aio_suspend(list, depth, NULL)) && (errno != EINTR)) {
+			perror("aio_suspend didn't return success \n");
+			abort_requests(depth);
+			return PTS_UNRESOLVED;
+		}
+		t = pts_now_ns();
+		for (i = 0; i < depth; i++) {
+			if ((list[i] == NULL) || (aio_error(&cbs[i]) == EINPROGRESS))
+				continue;
+			pts_hist_record(lat, t - submitted[i]);
+			ret = complete(i);
+			list[i] = NULL;
+			if (ret != PTS_PASS) {
+				abort_requests(depth);
+				return ret;
+			}
+			done++;
+			if (sent < nreqs) {
+				if (-1 == submit(i)) {
+					perror("aio_read / aio_write didn't return success \n");
+					list[i] = NULL;
+					abort_requests(depth);
+					return PTS_UNRESOLVED;
+				}
+				sent++;
+			}
+		}
+	}
+	return PTS_PASS;
+}
+
+static int run_lio(long nreqs, int depth, int wait, pts_hist_t *lat)
+{
+	struct sigevent sev;
+	siginfo_t info;
+	unsigned long long t0, t1;
+	long done = 0;
+	int i, k, ret;
+
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_SIGNAL;
+	sev.sigev_signo = SIG;
+	sev.sigev_value.sival_ptr = cbs;
+
+	while (done < nreqs) {
+		k = (nreqs - done < depth) ? nreqs - done : depth;
+		for (i = 0; i < k; i++)
+			prepare(i);
+
+		t0 = pts_now_ns();
+		if (wait) {
+			if (-1 == lio_listio(LIO_WAIT, (struct aiocb * const *)list, k, NULL)) {
+				perror("lio_listio didn't return success \n");
+				abort_requests(k);
+				return PTS_UNRESOLVED;
+			}
+		} else {
+			if (-1 == lio_listio(LIO_NOWAIT, (struct aiocb * const *)list, k, &sev)) {
+				perror("lio_listio didn't return success \n");
+				abort_requests(k);
+				return PTS_UNRESOLVED;
+			}
+			do {
+				ret = sigwaitinfo(&sigmask, &info);
+			} while ((ret == -1) && (errno == EINTR));
+			if (ret == -1) {
+				perror("sigwaitinfo didn't return success \n");
+				abort_requests(k);
+				return PTS_UNRESOLVED;
+			}
+			if (info.si_value.sival_ptr != cbs) {
+				printf("The notification of the list has a wrong value\n");
+				abort_requests(k);
+				return PTS_FAIL;
+			}
+		}
+		t1 = pts_now_ns();
+
+		/* The requests of a batch complete together */
+		pts_hist_record(lat, t1 - t0);
+		for (i = 0; i < k; i++) {
+			ret = complete(i);
+			list[i] = NULL;
+			if (ret != PTS_PASS) {
+				abort_requests(k);
+				return ret;
+			}
+		}
+		done += k;
+	}
+	return PTS_PASS;
+}
+
+/* Fill a new file of file_size bytes with the pattern */
+static int create_file(char *path)
+{
+	char *buf = bufs[0];	/* at least req_sizes[NREQS - 1] bytes */
+	long chunk = req_sizes[NREQS - 1];
+	off_t off;
+
+	direct = 0;
+#ifdef O_DIRECT
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_DIRECT, 0600);
+	if (fd != -1)
+		direct = 1;
+	else
+#endif
+		fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd == -1)
+		return -1;
+	unlink(path);
+
+	memset(buf, 0x5a, chunk);
+	for (off = 0; off < file_size; off += chunk) {
+		stamp(buf, off, chunk);
+		if (chunk != pwrite(fd, buf, chunk, off))
+			return -1;
+	}
+	if (-1 == fsync(fd))
+		return -1;
+	return 0;
+}
+
+/* Make the next case start without the file in the page cache */
+static int drop_cache(void)
+{
+	if (direct)
+		return 0;
+	if (-1 == fsync(fd))
+		return -1;
+	errno = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	return (errno == 0) ? 0 : -1;
+}
+
+static void report(char *dir, int mode, int depth, long nreqs,
+	unsigned long long elapsed, pts_hist_t *lat)
+{
+	printf("%-10s %6ld %-5s %-17s %7ld %5d %10.0f %9.1f %9llu %9llu %9llu\n",
+		dir, file_size / (1024 * 1024), ops[op], modes[mode], size / 1024,
+		depth, (double)nreqs * 1000000000.0 / elapsed,
+		(double)nreqs * size * 1000000000.0 / elapsed / (1024 * 1024),
+		pts_hist_percentile(lat, 50.0), pts_hist_percentile(lat, 99.0),
+		lat->max);
+}
+
+/* All the cases on the current file */
+static int run_file(char *dir)
+{
+	unsigned long long t0, elapsed;
+	unsigned int s, q;
+	long nreqs;
+	int mode, depth, ret = PTS_PASS;
+
+	for (op = OP_READ; op <= OP_WRITE; op++) {
+		for (s = 0; s < NREQS; s++) {
+			size = req_sizes[s];
+			if (size > file_size)
+				continue;
+			nreqs = IO_BYTES / size;
+			if (nreqs < MIN_REQS)
+				nreqs = MIN_REQS;
+
+			for (mode = M_SYNC; mode < NMODES; mode++) {
+				for (q = 0; q < NDEPTHS; q++) {
+					depth = depths[q];
+					if ((mode == M_SYNC) && (q > 0))
+						continue;
+					if ((mode >= M_LIO_WAIT) && (listio_max > 0)
+					 && (depth > listio_max))
+						continue;
+
+					seed = s * 1000 + q;
+					pts_hist_init(lat);
+					if (-1 == drop_cache()) {
+						perror("posix_fadvise didn't return success \n");
+						return PTS_UNRESOLVED;
+					}
+
+					t0 = pts_now_ns();
+					switch (mode) {
+					case M_SYNC:
+						ret = run_sync(nreqs, lat);
+						break;
+					case M_SUSPEND:
+						ret = run_suspend(nreqs, depth, lat);
+						break;
+					default:
+						ret = run_lio(nreqs, depth, mode == M_LIO_WAIT, lat);
+						break;
+					}
+					elapsed = pts_now_ns() - t0;
+
+					if (ret != PTS_PASS)
+						return ret;
+					report(dir, mode, depth, nreqs, elapsed, lat);
+				}
+			}
+		}
+	}
+	return PTS_PASS;
+}
+
+int main(int argc, char *argv[])
+{
+	char **dirs = default_dirs;
+	int ndirs = 2;
+	char path[1024];
+	unsigned int d, f;
+	int i, ret = PTS_PASS;
+
+#if !defined(_POSIX_ASYNCHRONOUS_IO) || (_POSIX_ASYNCHRONOUS_IO == -1)
+	printf("_POSIX_ASYNCHRONOUS_IO is not supported\n");
+	return PTS_UNSUPPORTED;
+#endif
+
+	if (argc > 1) {
+		dirs = &argv[1];
+		ndirs = argc - 1;
+	}
+
+	listio_max = sysconf(_SC_AIO_LISTIO_MAX);
+
+	/* The list notifications are taken with sigwaitinfo */
+	sigemptyset(&sigmask);
+	sigaddset(&sigmask, SIG);
+	if (-1 == sigprocmask(SIG_BLOCK, &sigmask, NULL)) {
+		perror("sigprocmask didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	lat = malloc(sizeof(pts_hist_t));
+	if (lat == NULL) {
+		perror("malloc didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	for (i = 0; i < DEPTH_MAX; i++) {
+		if (0 != posix_memalign((void **)&bufs[i], BLOCK, req_sizes[NREQS - 1])) {
+			printf("posix_memalign didn't return success\n");
+			return PTS_UNRESOLVED;
+		}
+		memset(bufs[i], 0x5a, req_sizes[NREQS - 1]);
+	}
+
+	printf("%d MB per case, latency in ns (of a batch for lio_listio)\n",
+		IO_BYTES / (1024 * 1024));
+	printf("%-10s %6s %-5s %-17s %7s %5s %10s %9s %9s %9s %9s\n", "Directory",
+		"FileMB", "Op", "Mode", "ReqKB", "Depth", "Req/s", "MB/s", "p50",
+		"p99", "max");
+
+	for (d = 0; (d < ndirs) && (ret == PTS_PASS); d++) {
+		for (f = 0; (f < NFILES) && (ret == PTS_PASS); f++) {
+			file_size = file_sizes[f];
+			snprintf(path, sizeof(path), "%s/aio_bench.%d", dirs[d], (int)getpid());
+			if (-1 == create_file(path)) {
+				printf("Unable to create a %ld MB file in %s: %s\n",
+					file_size / (1024 * 1024), dirs[d], strerror(errno));
+				if (fd != -1)
+					close(fd);
+				break;
+			}
+
+			if (!direct)
+				printf("%s: O_DIRECT refused, the page cache is dropped before each case\n",
+					dirs[d]);
+			ret = run_file(dirs[d]);
+			close(fd);
+		}
+	}
+
+	for (i = 0; i < DEPTH_MAX; i++)
+		free(bufs[i]);
+	free(lat);
+
+	if (ret == PTS_PASS)
+		printf("Test PASSED\n");
+	else
+		printf("Test %s\n", (ret == PTS_FAIL) ? "FAILED" : "UNRESOLVED");
+	return ret;
+}
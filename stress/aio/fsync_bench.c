@@ -0,0 +1,281 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * This is a latency benchmark of the synchronization of written data to
+ * the storage, in a file of the current directory (or of the directory
+ * given on the command line; on a tmpfs the synchronization is a no-op).
+ * Each round writes a block with pwrite, then waits for it to be
+ * synchronized with:
+ *  - fsync;
+ *  - fdatasync;
+ *  - aio_fsync(O_SYNC), completion waited for with aio_suspend;
+ *  - aio_fsync(O_DSYNC), completion waited for with aio_suspend.
+ *
+ * 1. Write size: one thread, ROUNDS rounds, for each size of sizes[].
+ * 2. Concurrency: 2, 4, ... THREADS_MAX threads write CONC_SIZE bytes
+ *    in their own part of the same file and synchronize it at the same
+ *    time, ROUNDS rounds each, so that the synchronizations overlap and
+ *    the file system can commit several of them at once (the single
+ *    thread case is the CONC_SIZE case of the first step).
+ *
+ * The file is written and synchronized in full before the first case, so
+ * that all the methods overwrite blocks which already exist: none of
+ * them pays for the block allocation or the growth of the file.
+ *
+ * The synchronizations per second and the p50/p99/max latency of the
+ * synchronization (from the call to fsync, fdatasync or aio_fsync to
+ * the moment it is complete) are reported for each case.
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <aio.h>
+
+#include "posixtest.h"
+#include "pts_bench.h"
+#include "pts_histogram.h"
+
+#define ROUNDS		100
+#define THREADS_MAX	8
+#define CONC_SIZE	4096
+#define AREA		(4 * 1024 * 1024)	/* part of the file of a thread */
+
+long sizes[] = { 512, 4096, 64 * 1024, 1024 * 1024 };
+#define NSIZES	(sizeof(sizes) / sizeof(sizes[0]))
+
+#define S_FSYNC		0
+#define S_FDATASYNC	1
+#define S_AIO_SYNC	2
+#define S_AIO_DSYNC	3
+#define NSYNCS		4
+char *syncs[] = { "fsync", "fdatasync", "aio_fsync(O_SYNC)", "aio_fsync(O_DSYNC)" };
+
+/* The data of each thread */
+typedef struct {
+	pthread_t th;
+	int index;
+	int error;
+	pts_hist_t lat;
+} worker_t;
+
+/* The current case */
+int fd;
+int method;
+long size;
+pts_gate_t gate;
+
+/* Synchronize the file; returns -1 on error */
+static int sync_file(void)
+{
+	struct aiocb cb;
+	const struct aiocb *list[1];
+	int ret;
+
+	switch (method) {
+	case S_FSYNC:
+		return fsync(fd);
+	case S_FDATASYNC:
+		return fdatasync(fd);
+	default:
+		memset(&cb, 0, sizeof(cb));
+		cb.aio_fildes = fd;
+		cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+		if (-1 == aio_fsync((method == S_AIO_SYNC) ? O_SYNC : O_DSYNC, &cb))
+			return -1;
+		list[0] = &cb;
+		while ((ret = aio_error(&cb)) == EINPROGRESS) {
+			if ((-1 == aio_suspend(list, 1, NULL)) && (errno != EINTR))
+				return -1;
+		}
+		if ((ret != 0) || (aio_return(&cb) != 0))
+			return -1;
+		return 0;
+	}
+}
+
+/* Write and synchronize the parts of all the threads; returns -1 on error */
+static int prefill(void)
+{
+	char *buf;
+	off_t off;
+
+	buf = malloc(AREA);
+	if (buf == NULL)
+		return -1;
+	memset(buf, 0x5a, AREA);
+	for (off = 0; off < (off_t)THREADS_MAX * AREA; off += AREA) {
+		if (AREA != pwrite(fd, buf, AREA, off)) {
+			free(buf);
+			return -1;
+		}
+	}
+	free(buf);
+	return fsync(fd);
+}
+
+static void *writer(void *arg)
+{
+	worker_t *w = (worker_t *)arg;
+	off_t base = (off_t)w->index * AREA, off = 0;
+	unsigned long long t0;
+	char *buf;
+	int i;
+
+	buf = malloc(size);
+	if (buf == NULL) {
+		w->error = 1;
+		pts_gate_ready(&gate);
+		return NULL;
+	}
+	memset(buf, 0x5a + w->index, size);
+
+	if (0 != pts_gate_ready(&gate))
+		w->error = 1;
+
+	for (i = 0; (i < ROUNDS) && !w->error; i++) {
+		if (size != pwrite(fd, buf, size, base + off)) {
+			w->error = 1;
+			break;
+		}
+		off = (off + size) % AREA;
+
+		t0 = pts_now_ns();
+		if (-1 == sync_file())
+			w->error = 1;
+		pts_hist_record(&w->lat, pts_now_ns() - t0);
+	}
+
+	free(buf);
+	return NULL;
+}
+
+/* Run n writers; returns -1 if one of them failed */
+static int run(int n, worker_t *w, pts_hist_t *all, unsigned long long *elapsed)
+{
+	unsigned long long t0;
+	int i, ret = 0;
+
+	if (0 != pts_gate_init(&gate)) {
+		perror("pts_gate_init didn't return success \n");
+		return -1;
+	}
+	for (i = 0; i < n; i++) {
+		memset(&w[i], 0, sizeof(worker_t));
+		w[i].index = i;
+		pts_hist_init(&w[i].lat);
+		if (0 != pthread_create(&w[i].th, NULL, writer, &w[i])) {
+			perror("pthread_create didn't return success \n");
+			return -1;
+		}
+	}
+	t0 = pts_now_ns();
+	if (0 != pts_gate_open(&gate, n)) {
+		perror("pts_gate_open didn't return success \n");
+		return -1;
+	}
+	pts_hist_init(all);
+	for (i = 0; i < n; i++) {
+		if (0 != pthread_join(w[i].th, NULL)) {
+			perror("pthread_join didn't return success \n");
+			return -1;
+		}
+		if (w[i].error)
+			ret = -1;
+		pts_hist_merge(all, &w[i].lat);
+	}
+	*elapsed = pts_now_ns() - t0;
+	pts_gate_destroy(&gate);
+	return ret;
+}
+
+static int run_case(int n, worker_t *w, pts_hist_t *all)
+{
+	unsigned long long elapsed;
+
+	if (-1 == run(n, w, all, &elapsed)) {
+		printf("%s failed with %ld bytes and %d threads\n", syncs[method], size, n);
+		return PTS_UNRESOLVED;
+	}
+	printf("%-19s %8ld %7d %9.0f %10llu %10llu %10llu\n", syncs[method], size, n,
+		(double)all->count * 1000000000.0 / elapsed,
+		pts_hist_percentile(all, 50.0), pts_hist_percentile(all, 99.0),
+		all->max);
+	return PTS_PASS;
+}
+
+int main(int argc, char *argv[])
+{
+	char *dir = ".";
+	char path[1024];
+	worker_t *w;
+	pts_hist_t *all;
+	unsigned int s;
+	int n, ret = PTS_PASS;
+
+#if !defined(_POSIX_ASYNCHRONOUS_IO) || (_POSIX_ASYNCHRONOUS_IO == -1)
+	printf("_POSIX_ASYNCHRONOUS_IO is not supported\n");
+	return PTS_UNSUPPORTED;
+#endif
+
+	if (argc > 1)
+		dir = argv[1];
+
+	snprintf(path, sizeof(path), "%s/fsync_bench.%d", dir, (int)getpid());
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd == -1) {
+		perror("open didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	unlink(path);
+
+	if (-1 == prefill()) {
+		perror("Unable to fill the file \n");
+		close(fd);
+		return PTS_UNRESOLVED;
+	}
+
+	w = calloc(THREADS_MAX, sizeof(worker_t));
+	all = malloc(sizeof(pts_hist_t));
+	if ((w == NULL) || (all == NULL)) {
+		perror("malloc didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	printf("%d rounds per thread in %s, latency of the synchronization in ns\n",
+		ROUNDS, dir);
+	printf("%-19s %8s %7s %9s %10s %10s %10s\n", "Method", "Bytes", "Threads",
+		"Syncs/s", "p50", "p99", "max");
+
+	/* 1. Write size */
+	for (method = 0; (method < NSYNCS) && (ret == PTS_PASS); method++) {
+		for (s = 0; (s < NSIZES) && (ret == PTS_PASS); s++) {
+			size = sizes[s];
+			ret = run_case(1, w, all);
+		}
+	}
+
+	/* 2. Concurrency */
+	size = CONC_SIZE;
+	for (method = 0; (method < NSYNCS) && (ret == PTS_PASS); method++)
+		for (n = 2; (n != 0) && (ret == PTS_PASS); n = pts_next_count(n, THREADS_MAX))
+			ret = run_case(n, w, all);
+
+	close(fd);
+	free(all);
+	free(w);
+
+	if (ret == PTS_PASS)
+		printf("Test PASSED\n");
+	else
+		printf("Test %s\n", (ret == PTS_FAIL) ? "FAILED" : "UNRESOLVED");
+	return ret;
+}
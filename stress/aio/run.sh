@@ -0,0 +1,42 @@
+#!/bin/sh
+# This file is licensed under the GPL license.  For the full content
+# of this license, see the COPYING file at the top level of this
+# source tree.
+#
+# Run all the tests in the AIO stress area.
+
+# Helper functions
+RunTest()
+{
+	echo "TEST: " $1 $2
+	TOTAL=$TOTAL+1
+	./$1 $2
+	if [ $? == 0 ]; then
+		PASS=$PASS+1
+		echo -ne "\t\t\t***TEST PASSED***\n\n"
+	else
+		FAIL=$FAIL+1
+		echo -ne "\t\t\t***TEST FAILED***\n\n"
+	fi
+}
+
+# Main program
+
+declare -i TOTAL=0
+declare -i PASS=0
+declare -i FAIL=0
+
+echo "Run the AIO stress tests"
+echo "=========================================="
+
+RunTest aio_bench.test
+RunTest fsync_bench.test
+
+echo
+echo -ne "\t\t****************\n"
+echo -ne "\t\t* TOTAL:  " $TOTAL "\n"
+echo -ne "\t\t* PASSED: " $PASS "\n"
+echo -ne "\t\t* FAILED: " $FAIL "\n"
+echo -ne "\t\t****************\n"
+
+exit 0
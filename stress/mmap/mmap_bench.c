@@ -0,0 +1,331 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * This is a benchmark of the cost of the mappings.
+ *
+ * 1. First touch: for each kind of mapping (anonymous MAP_PRIVATE,
+ *    anonymous MAP_SHARED, and MAP_SHARED / MAP_PRIVATE of a file of the
+ *    current directory) and each size of sizes[], a region is mapped,
+ *    each of its pages is written once, then it is unmapped. This is
+ *    done without prefault, then with the region locked by mlock before
+ *    it is touched (mlock faults all the pages in). The mmap, mlock and
+ *    munmap durations and the cost of the first write per page are
+ *    reported (mean of ROUNDS rounds). The pages of the file stay in
+ *    the page cache from a round to the next one.
+ *
+ * 2. Churn: for each size of churn_sizes[] and for 1, 2, 4, ... N threads
+ *    (N is the # of CPUs, at least 2, pinned one per CPU when the system
+ *    allows it), each thread maps an anonymous private region, writes
+ *    each of its pages and unmaps it, in a loop for DURATION ms. Unmapping
+ *    touched pages while other threads of the process run on other CPUs
+ *    requires TLB shootdowns. The total # of mmap / munmap pairs per
+ *    second is reported.
+ *
+ * The test fails if a page does not read back the value written in it.
+ */
+
+/* The threads are pinned with the Linux affinity API */
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "posixtest.h"
+#include "pts_bench.h"
+#include "pts_placement.h"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS	MAP_ANON
+#endif
+
+#define ROUNDS		5
+#define DURATION	500	/* ms per churn case */
+#define MB		(1024 * 1024)
+
+long sizes[] = { 64 * 1024, 1 * MB, 16 * MB, 64 * MB };
+long churn_sizes[] = { 4096, 64 * 1024, 1 * MB };
+#define NSIZES		(sizeof(sizes) / sizeof(sizes[0]))
+#define NCHURN		(sizeof(churn_sizes) / sizeof(churn_sizes[0]))
+#define FILE_SIZE	(64 * MB)	/* the largest of sizes[] */
+
+#define K_ANON_PRIVATE	0
+#define K_ANON_SHARED	1
+#define K_FILE_SHARED	2
+#define K_FILE_PRIVATE	3
+#define NKINDS		4
+char *kinds[] = { "anon MAP_PRIVATE", "anon MAP_SHARED", "file MAP_SHARED",
+	"file MAP_PRIVATE" };
+
+/* The data of each churn thread */
+typedef struct {
+	pthread_t th;
+	int index;
+	int error;
+	unsigned long long pairs;
+} worker_t;
+
+long pagesize;
+int fd;
+long size;
+pts_gate_t gate;
+int pinned;
+
+static char *map(int kind, long len)
+{
+	switch (kind) {
+	case K_ANON_PRIVATE:
+		return mmap(NULL, len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	case K_ANON_SHARED:
+		return mmap(NULL, len, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	case K_FILE_SHARED:
+		return mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	default:
+		return mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	}
+}
+
+/* Write one byte in each page */
+static void touch(char *p, long len)
+{
+	long i;
+
+	for (i = 0; i < len; i += pagesize)
+		p[i] = (char)(i / pagesize);
+}
+
+static int check(char *p, long len)
+{
+	long i;
+
+	for (i = 0; i < len; i += pagesize)
+		if (p[i] != (char)(i / pagesize))
+			return -1;
+	return 0;
+}
+
+/* One first touch case; returns a PTS_ code, or -1 if mlock is refused */
+static int first_touch(int kind, long len, int lock)
+{
+	unsigned long long t0, t_map = 0, t_lock = 0, t_touch = 0, t_unmap = 0;
+	char *p;
+	int r, err;
+
+	for (r = 0; r < ROUNDS; r++) {
+		t0 = pts_now_ns();
+		p = map(kind, len);
+		t_map += pts_now_ns() - t0;
+		if (p == MAP_FAILED) {
+			perror("mmap didn't return success \n");
+			return PTS_UNRESOLVED;
+		}
+
+		if (lock) {
+			t0 = pts_now_ns();
+			if (-1 == mlock(p, len)) {
+				err = errno;
+				munmap(p, len);
+				errno = err;
+				return -1;
+			}
+			t_lock += pts_now_ns() - t0;
+		}
+
+		t0 = pts_now_ns();
+		touch(p, len);
+		t_touch += pts_now_ns() - t0;
+
+		if (0 != check(p, len)) {
+			printf("A page of a %s mapping lost its value\n", kinds[kind]);
+			munmap(p, len);
+			return PTS_FAIL;
+		}
+
+		t0 = pts_now_ns();
+		if (-1 == munmap(p, len)) {
+			perror("munmap didn't return success \n");
+			return PTS_UNRESOLVED;
+		}
+		t_unmap += pts_now_ns() - t0;
+	}
+
+	printf("%-17s %8ld %-5s %10.1f %10.1f %10.1f %10.1f\n", kinds[kind],
+		len / 1024, lock ? "mlock" : "none",
+		(double)t_map / ROUNDS / 1000.0, (double)t_lock / ROUNDS / 1000.0,
+		(double)t_touch / ((double)ROUNDS * (len / pagesize)),
+		(double)t_unmap / ROUNDS / 1000.0);
+	return PTS_PASS;
+}
+
+static void *churn(void *arg)
+{
+	worker_t *w = (worker_t *)arg;
+	unsigned long long pairs = 0;
+	char *p;
+
+	if (pinned && (0 != pts_place_thread(w->index)))
+		w->error = 1;
+	if (0 != pts_gate_ready(&gate))
+		w->error = 1;
+	if (w->error)
+		return NULL;
+
+	while (!pts_gate_closed(&gate)) {
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			w->error = 1;
+			break;
+		}
+		touch(p, size);
+		if (0 != check(p, size))
+			w->error = 2;
+		if (-1 == munmap(p, size)) {
+			w->error = 1;
+			break;
+		}
+		pairs++;
+	}
+	w->pairs = pairs;
+	return NULL;
+}
+
+/* Run n churn threads; returns a PTS_ code */
+static int run_churn(int n, worker_t *w)
+{
+	int i, ret = PTS_PASS;
+
+	if (0 != pts_gate_init(&gate)) {
+		perror("pts_gate_init didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	for (i = 0; i < n; i++) {
+		memset(&w[i], 0, sizeof(worker_t));
+		w[i].index = i;
+		if (0 != pthread_create(&w[i].th, NULL, churn, &w[i])) {
+			perror("pthread_create didn't return success \n");
+			return PTS_UNRESOLVED;
+		}
+	}
+	if (0 != pts_gate_open(&gate, n)) {
+		perror("pts_gate_open didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	pts_sleep_ms(DURATION);
+	pts_gate_close(&gate);
+	for (i = 0; i < n; i++) {
+		if (0 != pthread_join(w[i].th, NULL)) {
+			perror("pthread_join didn't return success \n");
+			return PTS_UNRESOLVED;
+		}
+		if (w[i].error == 2) {
+			printf("A page of a churned mapping lost its value\n");
+			ret = PTS_FAIL;
+		} else if (w[i].error && (ret == PTS_PASS)) {
+			printf("A churn thread failed\n");
+			ret = PTS_UNRESOLVED;
+		}
+	}
+	pts_gate_destroy(&gate);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	char path[64];
+	worker_t *w;
+	unsigned long long pairs;
+	unsigned int s;
+	long refused;		/* smallest size mlock refused, for the kind */
+	int i, k, n, max, npin, lock, ret = PTS_PASS;
+
+	pagesize = sysconf(_SC_PAGESIZE);
+
+	snprintf(path, sizeof(path), "mmap_bench.%d", (int)getpid());
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd == -1) {
+		perror("open didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	unlink(path);
+	if (-1 == ftruncate(fd, FILE_SIZE)) {
+		perror("ftruncate didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	max = pts_max_threads(1);
+	npin = pts_placement_init();
+	if (npin > 0)
+		pts_placement = PTS_PLACE_COMPACT;
+	pinned = (npin > 0);
+
+	w = calloc(max, sizeof(worker_t));
+	if (w == NULL) {
+		perror("calloc didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	/* 1. First touch */
+	printf("First touch, %d rounds per case, page size %ld\n", ROUNDS, pagesize);
+	printf("%-17s %8s %-5s %10s %10s %10s %10s\n", "Mapping", "KB", "Fault",
+		"mmap(us)", "mlock(us)", "ns/page", "munmap(us)");
+
+	for (k = 0; (k < NKINDS) && (ret == PTS_PASS); k++) {
+		refused = 0;
+		for (s = 0; (s < NSIZES) && (ret == PTS_PASS); s++) {
+			for (lock = 0; (lock <= 1) && (ret == PTS_PASS); lock++) {
+				/* The limit of the locked memory refuses a size
+				 * and the larger ones */
+				if (lock && refused && (sizes[s] >= refused))
+					continue;
+				ret = first_touch(k, sizes[s], lock);
+				if (ret == -1) {
+					printf("mlock of %ld KB is refused (%s); the larger prefault cases are skipped\n",
+						sizes[s] / 1024, strerror(errno));
+					refused = sizes[s];
+					ret = PTS_PASS;
+				}
+			}
+		}
+	}
+
+	/* 2. Churn */
+	if (ret == PTS_PASS) {
+		printf("\nChurn, %d ms per case, up to %d threads%s\n", DURATION, max,
+			pinned ? "" : " (not pinned)");
+		printf("%8s %7s %12s\n", "KB", "Threads", "Pairs/s");
+	}
+	for (s = 0; (s < NCHURN) && (ret == PTS_PASS); s++) {
+		size = churn_sizes[s];
+		for (n = 1; (n != 0) && (ret == PTS_PASS); n = pts_next_count(n, max)) {
+			ret = run_churn(n, w);
+			if (ret != PTS_PASS)
+				break;
+			pairs = 0;
+			for (i = 0; i < n; i++)
+				pairs += w[i].pairs;
+			printf("%8ld %7d %12.0f\n", size / 1024, n,
+				(double)pairs * 1000.0 / DURATION);
+		}
+	}
+
+	close(fd);
+	free(w);
+
+	if (ret == PTS_PASS)
+		printf("Test PASSED\n");
+	else
+		printf("Test %s\n", (ret == PTS_FAIL) ? "FAILED" : "UNRESOLVED");
+	return ret;
+}
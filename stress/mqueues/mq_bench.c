@@ -0,0 +1,444 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * This is a throughput and latency benchmark of mq_send / mq_receive.
+ * Producers send MSGS messages through one queue, consumers receive them.
+ * Each message carries its send time, so the latency is the time from
+ * mq_send to the return of mq_receive, including the time spent in the
+ * queue.
+ *
+ * Each case of cases[] sets:
+ * - the message size, from 16 bytes up to the largest mq_msgsize which
+ *   mq_open accepts (at most MSGSIZE_MAX);
+ * - the queue depth (mq_maxmsg), up to the largest which mq_open
+ *   accepts for the message size, starting from the depth given on the
+ *   command line, or else from /proc/sys/fs/mqueue/msg_max (MAXMSG_MAX
+ *   where it cannot be read);
+ * - the priority mix: all messages at priority 0, or spread over
+ *   PRIO_LEVELS priorities;
+ * - the # of producers and consumers.
+ * Each case runs with threads, then with processes.
+ *
+ * The messages per second, bytes per second and p50/p99/max latency
+ * are reported for each case.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <mqueue.h>
+
+#include "posixtest.h"
+#include "pts_bench.h"
+#include "pts_histogram.h"
+
+#define MSGS		20000
+#define MSGSIZE_MAX	8192
+#define MAXMSG_MAX	10	/* when msg_max cannot be read */
+#define MSG_MAX_PATH	"/proc/sys/fs/mqueue/msg_max"
+#define PRIO_LEVELS	8
+#define MAX_AGENTS	4
+
+/* A size or depth of 0 means the largest one */
+typedef struct {
+	long size;
+	long depth;
+	int prio;		/* 0: single priority, 1: mixed priorities */
+	int producers;
+	int consumers;
+} bench_case;
+
+bench_case cases[] = {
+	{ 16,   0, 0, 1, 1 },
+	{ 256,  0, 0, 1, 1 },
+	{ 4096, 0, 0, 1, 1 },
+	{ 0,    0, 0, 1, 1 },
+	{ 64,   1, 0, 1, 1 },
+	{ 64,   4, 0, 1, 1 },
+	{ 64,   0, 0, 1, 1 },
+	{ 64,   0, 1, 1, 1 },
+	{ 64,   0, 0, 1, 4 },
+	{ 64,   0, 0, 4, 1 },
+	{ 64,   0, 0, 4, 4 },
+	{ 64,   0, 1, 4, 4 },
+};
+#define NCASES	(sizeof(cases) / sizeof(cases[0]))
+
+char *modes[] = { "thread", "process" };
+
+/* The queue name, with the pid of the bench */
+char mq_name[64];
+
+/* What a consumer reports; in shared memory for the process mode */
+typedef struct {
+	unsigned long long msgs;
+	unsigned long long bytes;
+	int error;
+	pts_hist_t lat;
+} result_t;
+
+/* Arguments of a producer or consumer */
+typedef struct {
+	mqd_t mq;
+	bench_case *c;
+	long size;
+	int id;
+	result_t *res;
+} agent_t;
+
+static int producer(agent_t *a)
+{
+	char *buf;
+	unsigned long long ts;
+	int i, n;
+
+	buf = malloc(a->size);
+	if (buf == NULL) {
+		perror("malloc didn't return success \n");
+		return -1;
+	}
+	memset(buf, 'm', a->size);
+
+	/* The first producer sends the remainder too */
+	n = MSGS / a->c->producers;
+	if (a->id == 0)
+		n += MSGS % a->c->producers;
+
+	for (i = 0; i < n; i++) {
+		ts = pts_now_ns();
+		memcpy(buf, &ts, sizeof(ts));
+		if (-1 == mq_send(a->mq, buf, a->size,
+				a->c->prio ? (i * 7) % PRIO_LEVELS : 0)) {
+			perror("mq_send doesn't return success \n");
+			free(buf);
+			return -1;
+		}
+	}
+	free(buf);
+	return 0;
+}
+
+/* Receives until a message shorter than a timestamp, which means stop */
+static int consumer(agent_t *a)
+{
+	char *buf;
+	unsigned long long ts;
+	ssize_t len;
+
+	buf = malloc(a->size);
+	if (buf == NULL) {
+		perror("malloc didn't return success \n");
+		return -1;
+	}
+
+	for (;;) {
+		len = mq_receive(a->mq, buf, a->size, NULL);
+		if (len == -1) {
+			if (errno == EINTR)
+				continue;
+			perror("mq_receive doesn't return success \n");
+			free(buf);
+			return -1;
+		}
+		if (len < (ssize_t)sizeof(ts))
+			break;
+		memcpy(&ts, buf, sizeof(ts));
+		pts_hist_record(&a->res->lat, pts_now_ns() - ts);
+		a->res->msgs++;
+		a->res->bytes += len;
+	}
+	free(buf);
+	return 0;
+}
+
+static void *producer_thread(void *arg)
+{
+	return (-1 == producer((agent_t *)arg)) ? (void *)1 : NULL;
+}
+
+static void *consumer_thread(void *arg)
+{
+	return (-1 == consumer((agent_t *)arg)) ? (void *)1 : NULL;
+}
+
+/* The agents of a case; threads or child processes */
+typedef struct {
+	pthread_t th;
+	pid_t pid;
+	agent_t arg;
+} runner_t;
+
+static int start(runner_t *r, int process, int prod)
+{
+	if (!process)
+		return pthread_create(&r->th, NULL,
+			prod ? producer_thread : consumer_thread, &r->arg);
+
+	fflush(stdout);
+	r->pid = fork();
+	if (r->pid == -1)
+		return -1;
+	if (r->pid == 0)
+		_exit((-1 == (prod ? producer(&r->arg) : consumer(&r->arg)))
+			? PTS_UNRESOLVED : PTS_PASS);
+	return 0;
+}
+
+static int finish(runner_t *r, int process)
+{
+	void *thret;
+	int status;
+
+	if (!process)
+		return ((0 != pthread_join(r->th, &thret)) || (thret != NULL)) ? -1 : 0;
+
+	if ((r->pid != waitpid(r->pid, &status, 0)) || !WIFEXITED(status)
+	 || (WEXITSTATUS(status) != PTS_PASS))
+		return -1;
+	return 0;
+}
+
+/* Opens the queue; returns -1 if the attributes are not accepted */
+static mqd_t open_queue(long size, long depth)
+{
+	struct mq_attr mqstat;
+	mqd_t mq;
+
+	memset(&mqstat, 0, sizeof(mqstat));
+	mqstat.mq_maxmsg = depth;
+	mqstat.mq_msgsize = size;
+	mq = mq_open(mq_name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR, &mqstat);
+	if (mq != (mqd_t)-1)
+		mq_unlink(mq_name);
+	return mq;
+}
+
+/* Whether mq_open accepts the value: a message size if size is 0, else a depth */
+static int accepted(long value, long size)
+{
+	mqd_t mq;
+
+	mq = size ? open_queue(size, value) : open_queue(value, 1);
+	if (mq == (mqd_t)-1)
+		return 0;
+	mq_close(mq);
+	return 1;
+}
+
+/*
+ * The largest value up to max which mq_open accepts: the message size if
+ * size is 0, else the depth of a queue of size bytes messages
+ */
+static long probe(long max, long size)
+{
+	long lo = 1, mid;
+
+	if (accepted(max, size))
+		return max;
+	/* lo is accepted (or 1), max is not */
+	while (max - lo > 1) {
+		mid = lo + (max - lo) / 2;
+		if (accepted(mid, size))
+			lo = mid;
+		else
+			max = mid;
+	}
+	return lo;
+}
+
+/* The depth limit of the system, or MAXMSG_MAX if it is unknown */
+static long msg_max(void)
+{
+	FILE *f;
+	long max;
+
+	f = fopen(MSG_MAX_PATH, "r");
+	if (f == NULL)
+		return MAXMSG_MAX;
+	if ((1 != fscanf(f, "%ld", &max)) || (max < 1))
+		max = MAXMSG_MAX;
+	fclose(f);
+	return max;
+}
+
+/* Kill and reap the agents started in processes, which wait for ever */
+static void abandon(runner_t *r, int n, int process)
+{
+	int i;
+
+	if (!process)
+		return;
+	for (i = 0; i < n; i++) {
+		kill(r[i].pid, SIGKILL);
+		waitpid(r[i].pid, NULL, 0);
+	}
+}
+
+/* Run one case; returns a PTS_* status */
+static int run(bench_case *c, int process, long size, long depth, result_t *res)
+{
+	runner_t prod[MAX_AGENTS], cons[MAX_AGENTS];
+	unsigned long long t0, t1, msgs = 0, bytes = 0;
+	pts_hist_t *lat;
+	char stop = 0;
+	mqd_t mq;
+	int i, ret = PTS_PASS;
+
+	mq = open_queue(size, depth);
+	if (mq == (mqd_t)-1) {
+		perror("mq_open doesn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	for (i = 0; i < c->consumers; i++)
+		memset(&res[i], 0, sizeof(result_t));
+
+	t0 = pts_now_ns();
+	for (i = 0; i < c->consumers; i++) {
+		cons[i].arg.mq = mq;
+		cons[i].arg.c = c;
+		cons[i].arg.size = size;
+		cons[i].arg.id = i;
+		cons[i].arg.res = &res[i];
+		pts_hist_init(&res[i].lat);
+		if (0 != start(&cons[i], process, 0)) {
+			perror("Failed to start a consumer \n");
+			abandon(cons, i, process);
+			mq_close(mq);
+			return PTS_UNRESOLVED;
+		}
+	}
+	for (i = 0; i < c->producers; i++) {
+		prod[i].arg.mq = mq;
+		prod[i].arg.c = c;
+		prod[i].arg.size = size;
+		prod[i].arg.id = i;
+		prod[i].arg.res = NULL;
+		if (0 != start(&prod[i], process, 1)) {
+			perror("Failed to start a producer \n");
+			abandon(prod, i, process);
+			abandon(cons, c->consumers, process);
+			mq_close(mq);
+			return PTS_UNRESOLVED;
+		}
+	}
+
+	for (i = 0; i < c->producers; i++)
+		if (-1 == finish(&prod[i], process))
+			ret = PTS_UNRESOLVED;
+
+	/* All the data is queued; one stop message per consumer */
+	for (i = 0; i < c->consumers; i++) {
+		if (-1 == mq_send(mq, &stop, 1, 0)) {
+			perror("mq_send doesn't return success \n");
+			abandon(cons, c->consumers, process);
+			mq_close(mq);
+			return PTS_UNRESOLVED;
+		}
+	}
+	for (i = 0; i < c->consumers; i++)
+		if (-1 == finish(&cons[i], process))
+			ret = PTS_UNRESOLVED;
+	t1 = pts_now_ns();
+
+	mq_close(mq);
+	if (ret != PTS_PASS)
+		return ret;
+
+	lat = malloc(sizeof(pts_hist_t));
+	if (lat == NULL) {
+		perror("malloc didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	pts_hist_init(lat);
+	for (i = 0; i < c->consumers; i++) {
+		msgs += res[i].msgs;
+		bytes += res[i].bytes;
+		pts_hist_merge(lat, &res[i].lat);
+	}
+
+	if (msgs != MSGS) {
+		printf("%llu messages received out of %d\n", msgs, MSGS);
+		free(lat);
+		return PTS_FAIL;
+	}
+
+	printf("%-7s %6ld %5ld %-6s %2d/%-2d %10.0f %12.0f %9llu %9llu %9llu\n",
+		modes[process], size, depth, c->prio ? "mixed" : "single",
+		c->producers, c->consumers,
+		(double)msgs * 1000000000.0 / (double)(t1 - t0),
+		(double)bytes * 1000000000.0 / (double)(t1 - t0),
+		pts_hist_percentile(lat, 50.0), pts_hist_percentile(lat, 99.0),
+		lat->max);
+
+	free(lat);
+	return PTS_PASS;
+}
+
+int main(int argc, char *argv[])
+{
+	result_t *res;
+	long maxsize, maxdepth, size, depth;
+	unsigned int i;
+	int process, ret;
+
+	/* The results of the consumers, shared with the child processes */
+	res = mmap(NULL, MAX_AGENTS * sizeof(result_t), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (res == MAP_FAILED) {
+		perror("mmap didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	sprintf(mq_name, "/mq_bench_%ld", (long)getpid());
+
+	if (argc > 1)
+		maxdepth = atol(argv[1]);
+	else
+		maxdepth = msg_max();
+	if (maxdepth < 1) {
+		printf("Usage: %s [largest queue depth]\n", argv[0]);
+		return PTS_UNRESOLVED;
+	}
+
+	maxsize = probe(MSGSIZE_MAX, 0);
+	maxdepth = probe(maxdepth, 16);
+
+	printf("%d messages per case, largest size %ld, largest depth %ld\n",
+		MSGS, maxsize, maxdepth);
+	printf("Latency in ns from mq_send to the return of mq_receive\n");
+	printf("%-7s %6s %5s %-6s %5s %10s %12s %9s %9s %9s\n", "Mode", "Size",
+		"Depth", "Prio", "P/C", "Msgs/s", "Bytes/s", "p50", "p99", "max");
+
+	for (process = 0; process <= 1; process++) {
+		for (i = 0; i < NCASES; i++) {
+			size = (cases[i].size == 0) ? maxsize : cases[i].size;
+			depth = (cases[i].depth == 0) ? maxdepth : cases[i].depth;
+			if ((size > maxsize) || (depth > maxdepth))
+				continue;
+			/* The memory limit of the queues may refuse the largest
+			 * depth for the larger messages */
+			if (cases[i].depth == 0)
+				depth = probe(depth, size);
+			ret = run(&cases[i], process, size, depth, res);
+			if (ret != PTS_PASS) {
+				printf("Test %s\n", (ret == PTS_FAIL) ? "FAILED" : "UNRESOLVED");
+				return ret;
+			}
+		}
+	}
+
+	munmap(res, MAX_AGENTS * sizeof(result_t));
+
+	printf("Test PASSED\n");
+	return PTS_PASS;
+}
@@ -36,6 +36,7 @@ echo "=========================================="
 
 RunTest multi_send_rev_1.test 10
 RunTest multi_send_rev_2.test 100
+RunTest mq_bench.test
  
 
 echo
@@ -35,6 +35,7 @@ echo "Run the semaphore stress tests"
 echo "=========================================="
 
 RunTest $TESTS 100
+RunTest sem_pingpong.test
 
 echo
 echo -ne "\t\t****************\n"
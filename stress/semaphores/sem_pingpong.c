@@ -0,0 +1,313 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * This is a benchmark of the sem_post -> sem_wait round trip. Two
+ * semaphores are bounced between a pinger and a ponger:
+ *	pinger: sem_post(ping); sem_wait(pong);
+ *	ponger: sem_wait(ping); sem_post(pong);
+ * The pinger times each round trip.
+ *
+ * The ponger runs in three configurations:
+ * - thread:  a thread of this process, sem_init(pshared = 0);
+ * - process: a child process, sem_init(pshared = 1) in mmap'ed memory;
+ * - named:   a child process which opens the semaphores with sem_open.
+ * Each one runs with blocking waits, then with sem_trywait spinning
+ * up to SPIN_TRIES times before blocking.
+ *
+ * The round trips per second and the p50/p99/max round trip times are
+ * reported for each case.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include <semaphore.h>
+#include "posixtest.h"
+#include "pts_bench.h"
+#include "pts_histogram.h"
+
+#define ROUNDS		20000
+#define SPIN_TRIES	1000
+
+typedef struct {
+	sem_t ping;
+	sem_t pong;
+} pair_t;
+
+/* Arguments of the ponger thread */
+typedef struct {
+	sem_t *ping;
+	sem_t *pong;
+	int spin;
+} ponger_t;
+
+char *configs[] = { "thread", "process", "named" };
+
+static int sem_get(sem_t *sem, int spin)
+{
+	int i;
+
+	if (spin) {
+		for (i = 0; i < SPIN_TRIES; i++) {
+			if (0 == sem_trywait(sem))
+				return 0;
+			if (errno != EAGAIN)
+				return -1;
+		}
+	}
+
+	while (-1 == sem_wait(sem)) {
+		if (errno != EINTR)
+			return -1;
+	}
+	return 0;
+}
+
+static int ponger(sem_t *ping, sem_t *pong, int spin)
+{
+	int i;
+
+	for (i = 0; i < ROUNDS; i++) {
+		if (-1 == sem_get(ping, spin)) {
+			perror("sem_wait didn't return success \n");
+			return -1;
+		}
+		if (-1 == sem_post(pong)) {
+			perror("sem_post didn't return success \n");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void *ponger_thread(void *arg)
+{
+	ponger_t *p = (ponger_t *)arg;
+
+	if (-1 == ponger(p->ping, p->pong, p->spin))
+		return (void *)1;
+	return NULL;
+}
+
+static int pinger(sem_t *ping, sem_t *pong, int spin, pts_hist_t *h)
+{
+	int i;
+	unsigned long long t0;
+
+	for (i = 0; i < ROUNDS; i++) {
+		t0 = pts_now_ns();
+		if (-1 == sem_post(ping)) {
+			perror("sem_post didn't return success \n");
+			return -1;
+		}
+		if (-1 == sem_get(pong, spin)) {
+			perror("sem_wait didn't return success \n");
+			return -1;
+		}
+		pts_hist_record(h, pts_now_ns() - t0);
+	}
+	return 0;
+}
+
+/* Release the semaphores of a case */
+static void release(int config, sem_t *ping, sem_t *pong, char *ping_name,
+	char *pong_name)
+{
+	if (config == 2) {
+		sem_close(ping);
+		sem_close(pong);
+		sem_unlink(ping_name);
+		sem_unlink(pong_name);
+	} else {
+		sem_destroy(ping);
+		sem_destroy(pong);
+	}
+}
+
+/* Run one case; returns a PTS_* status */
+static int run(int config, int spin, pair_t *shm)
+{
+	pair_t local;
+	ponger_t arg;
+	pthread_t th;
+	pid_t pid = 0;
+	sem_t *ping, *pong;
+	char ping_name[64], pong_name[64];
+	unsigned long long start, end;
+	pts_hist_t *h;
+	void *thret;
+	int status, ret = 0;
+
+	h = malloc(sizeof(pts_hist_t));
+	if (h == NULL) {
+		perror("malloc didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	pts_hist_init(h);
+
+	switch (config) {
+	case 0:
+		ping = &local.ping;
+		pong = &local.pong;
+		if ((-1 == sem_init(ping, 0, 0)) || (-1 == sem_init(pong, 0, 0))) {
+			perror("sem_init didn't return success \n");
+			free(h);
+			return PTS_UNRESOLVED;
+		}
+		break;
+	case 1:
+		ping = &shm->ping;
+		pong = &shm->pong;
+		if ((-1 == sem_init(ping, 1, 0)) || (-1 == sem_init(pong, 1, 0))) {
+			perror("sem_init didn't return success \n");
+			free(h);
+			return PTS_UNRESOLVED;
+		}
+		break;
+	default:
+		sprintf(ping_name, "/sem_pingpong_ping_%ld", (long)getpid());
+		sprintf(pong_name, "/sem_pingpong_pong_%ld", (long)getpid());
+		ping = sem_open(ping_name, O_CREAT | O_EXCL, S_IRUSR | S_IWUSR, 0);
+		pong = sem_open(pong_name, O_CREAT | O_EXCL, S_IRUSR | S_IWUSR, 0);
+		if ((ping == SEM_FAILED) || (pong == SEM_FAILED)) {
+			perror("sem_open didn't return success \n");
+			if (ping != SEM_FAILED)
+				sem_close(ping);
+			if (pong != SEM_FAILED)
+				sem_close(pong);
+			sem_unlink(ping_name);
+			sem_unlink(pong_name);
+			free(h);
+			return PTS_UNRESOLVED;
+		}
+		break;
+	}
+
+	/* Start the ponger */
+	if (config == 0) {
+		arg.ping = ping;
+		arg.pong = pong;
+		arg.spin = spin;
+		if (0 != pthread_create(&th, NULL, ponger_thread, &arg)) {
+			perror("pthread_create didn't return success \n");
+			release(config, ping, pong, ping_name, pong_name);
+			free(h);
+			return PTS_UNRESOLVED;
+		}
+	} else {
+		fflush(stdout);
+		pid = fork();
+		if (pid == -1) {
+			perror("fork didn't return success \n");
+			release(config, ping, pong, ping_name, pong_name);
+			free(h);
+			return PTS_UNRESOLVED;
+		}
+		if (pid == 0) {
+			if (config == 2) {
+				/* Open the semaphores by their names */
+				ping = sem_open(ping_name, 0);
+				pong = sem_open(pong_name, 0);
+				if ((ping == SEM_FAILED) || (pong == SEM_FAILED)) {
+					perror("sem_open didn't return success \n");
+					_exit(PTS_UNRESOLVED);
+				}
+			}
+			_exit((-1 == ponger(ping, pong, spin)) ? PTS_UNRESOLVED : PTS_PASS);
+		}
+	}
+
+	start = pts_now_ns();
+	if (-1 == pinger(ping, pong, spin, h)) {
+		ret = PTS_UNRESOLVED;
+		/* The ponger waits for ever for the rounds not run */
+		if (config == 0)
+			pthread_cancel(th);
+		else
+			kill(pid, SIGKILL);
+	}
+	end = pts_now_ns();
+
+	/* Stop the ponger */
+	if (config == 0) {
+		if ((0 != pthread_join(th, &thret)) || (thret != NULL))
+			ret = PTS_UNRESOLVED;
+	} else {
+		if ((pid != waitpid(pid, &status, 0)) || !WIFEXITED(status)
+		 || (WEXITSTATUS(status) != PTS_PASS))
+			ret = PTS_UNRESOLVED;
+	}
+
+	release(config, ping, pong, ping_name, pong_name);
+
+	if (ret == 0)
+		printf("%-8s %-6s %12.0f %10llu %10llu %10llu\n",
+			configs[config], spin ? "spin" : "block",
+			(double)ROUNDS * 1000000000.0 / (double)(end - start),
+			pts_hist_percentile(h, 50.0), pts_hist_percentile(h, 99.0),
+			h->max);
+
+	free(h);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	char name[64];
+	pair_t *shm;
+	int fd, config, spin, ret;
+
+#ifndef	_POSIX_SEMAPHORES
+	printf("_POSIX_SEMAPHORES is not defined \n");
+	return PTS_UNRESOLVED;
+#endif
+
+	/* The memory shared with the child process */
+	sprintf(name, "/sem_pingpong_%ld", (long)getpid());
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if (fd == -1) {
+		perror("shm_open didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	shm_unlink(name);
+	if (-1 == ftruncate(fd, sizeof(pair_t))) {
+		perror("ftruncate didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	shm = mmap(NULL, sizeof(pair_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (shm == MAP_FAILED) {
+		perror("mmap didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	close(fd);
+
+	printf("%d round trips per case, round trip times in ns\n", ROUNDS);
+	printf("%-8s %-6s %12s %10s %10s %10s\n", "Config", "Wait", "Trips/s",
+		"p50", "p99", "max");
+
+	for (config = 0; config < 3; config++) {
+		for (spin = 0; spin <= 1; spin++) {
+			ret = run(config, spin, shm);
+			if (ret != PTS_PASS) {
+				printf("Test UNRESOLVED\n");
+				return ret;
+			}
+		}
+	}
+
+	munmap(shm, sizeof(pair_t));
+
+	printf("Test PASSED\n");
+	return PTS_PASS;
+}
@@ -0,0 +1,416 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * This is a benchmark of the delivery of a realtime signal.
+ *
+ * 1. Latency: for each way to send the signal (kill, raise, pthread_kill,
+ *    sigqueue) and each way to receive it (a SA_SIGINFO handler run from
+ *    sigsuspend, sigwaitinfo, sigtimedwait), the main thread sends ROUNDS
+ *    signals to a receiver thread, one at a time. raise sends the signal
+ *    to the calling thread, so the receiver sends it to itself in this
+ *    case. The delay from the send to the handler or to the return of the
+ *    wait is reported (p50, p99 and max).
+ * 2. Blocked threads: the kill latency is measured again while more and
+ *    more other threads have the signal blocked.
+ * 3. Queue: the main thread queues the signal to the process with
+ *    sigqueue until it fails with EAGAIN (SIGQUEUE_MAX is reached, or
+ *    QUEUE_CAP signals are queued), then fetches them with sigtimedwait,
+ *    QROUNDS times. The # of queued signals and the rates of both
+ *    operations are reported.
+ *
+ * The signal is blocked in all the threads; the receiver only unblocks it
+ * in sigsuspend.
+ *
+ * The test fails if a queued signal is lost, if the queued signals are
+ * not received in the order they were sent, or if the signal is still
+ * pending once all of them were received.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <semaphore.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "posixtest.h"
+#include "pts_bench.h"
+#include "pts_histogram.h"
+
+#define ROUNDS		5000	/* signals per latency case */
+#define QROUNDS		5	/* fills and drains of the queue */
+#define QUEUE_CAP	65536	/* if SIGQUEUE_MAX is not limited */
+
+#define SEND_KILL		0
+#define SEND_RAISE		1
+#define SEND_PTHREAD_KILL	2
+#define SEND_SIGQUEUE		3
+#define NSENDERS		4
+char *senders[] = { "kill", "raise", "pthread_kill", "sigqueue" };
+
+#define RECV_HANDLER		0
+#define RECV_SIGWAITINFO	1
+#define RECV_SIGTIMEDWAIT	2
+#define NRECEIVERS		3
+char *receivers[] = { "handler", "sigwaitinfo", "sigtimedwait" };
+
+/* The # of other threads with the signal blocked */
+int nblocked[] = { 0, 16, 64, 256 };
+#define NBLOCKED	(sizeof(nblocked) / sizeof(nblocked[0]))
+
+int sig;
+sigset_t sigset;		/* contains sig only */
+sigset_t waitmask;		/* the mask of the receiver, without sig */
+
+/* The current latency case */
+int sender;
+int receiver;
+volatile unsigned long long t_sent;
+volatile int failed;		/* set by the receiver */
+pts_hist_t *lat;
+sem_t ack;
+
+/* The blocked threads wait for this */
+pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cnd = PTHREAD_COND_INITIALIZER;
+int release;
+
+static void handler(int signo, siginfo_t *info, void *context)
+{
+	pts_hist_record(lat, pts_now_ns() - t_sent);
+	sem_post(&ack);
+}
+
+/* Wait for one signal; returns -1 on error */
+static int receive_one(void)
+{
+	siginfo_t info;
+	struct timespec ts;
+	int ret;
+
+	switch (receiver) {
+	case RECV_HANDLER:
+		/* The handler records the latency and posts ack */
+		if ((-1 == sigsuspend(&waitmask)) && (errno == EINTR))
+			return 0;
+		perror("sigsuspend didn't return EINTR \n");
+		return -1;
+
+	case RECV_SIGWAITINFO:
+		do {
+			ret = sigwaitinfo(&sigset, &info);
+		} while ((ret == -1) && (errno == EINTR));
+		if (ret == -1) {
+			perror("sigwaitinfo didn't return success \n");
+			return -1;
+		}
+		break;
+
+	default:
+		ts.tv_sec = 1;
+		ts.tv_nsec = 0;
+		do {
+			ret = sigtimedwait(&sigset, &info, &ts);
+		} while ((ret == -1) && (errno == EINTR));
+		if (ret == -1) {
+			perror("sigtimedwait didn't return success \n");
+			return -1;
+		}
+		break;
+	}
+
+	pts_hist_record(lat, pts_now_ns() - t_sent);
+	if (-1 == sem_post(&ack)) {
+		perror("sem_post didn't return success \n");
+		return -1;
+	}
+	return 0;
+}
+
+static void *recv_thread(void *arg)
+{
+	int i;
+
+	for (i = 0; i < ROUNDS; i++) {
+		if (sender == SEND_RAISE) {
+			t_sent = pts_now_ns();
+			if (0 != raise(sig)) {
+				perror("raise didn't return success \n");
+				break;
+			}
+		}
+		if (-1 == receive_one())
+			break;
+	}
+	if (i == ROUNDS)
+		return NULL;
+
+	/* Do not leave the main thread waiting for ack */
+	failed = 1;
+	sem_post(&ack);
+	return (void *)1;
+}
+
+static void *blocked_thread(void *arg)
+{
+	if (0 != pthread_sigmask(SIG_BLOCK, &sigset, NULL))
+		return (void *)1;
+
+	pthread_mutex_lock(&mtx);
+	while (!release)
+		pthread_cond_wait(&cnd, &mtx);
+	pthread_mutex_unlock(&mtx);
+	return NULL;
+}
+
+/* Release and join the n first blocked threads; returns -1 on error */
+static int release_blocked(pthread_t *blk, int n)
+{
+	void *thret;
+	int i, ret = 0;
+
+	pthread_mutex_lock(&mtx);
+	release = 1;
+	pthread_cond_broadcast(&cnd);
+	pthread_mutex_unlock(&mtx);
+
+	for (i = 0; i < n; i++)
+		if ((0 != pthread_join(blk[i], &thret)) || (thret != NULL))
+			ret = -1;
+	return ret;
+}
+
+static int send_one(pthread_t th, int i)
+{
+	union sigval sv;
+	int ret;
+
+	t_sent = pts_now_ns();
+	switch (sender) {
+	case SEND_KILL:
+		return kill(getpid(), sig);
+	case SEND_PTHREAD_KILL:
+		ret = pthread_kill(th, sig);
+		if (ret != 0) {
+			errno = ret;
+			return -1;
+		}
+		return 0;
+	default:
+		sv.sival_int = i;
+		return sigqueue(getpid(), sig, sv);
+	}
+}
+
+/* One latency case; returns a PTS_* status */
+static int latency(int snd, int rcv, int nblk)
+{
+	pthread_t th, *blk = NULL;
+	void *thret;
+	int i, ret = PTS_PASS;
+
+	sender = snd;
+	receiver = rcv;
+	failed = 0;
+	pts_hist_init(lat);
+
+	if (-1 == sem_init(&ack, 0, 0)) {
+		perror("sem_init didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	if (nblk > 0) {
+		blk = calloc(nblk, sizeof(pthread_t));
+		if (blk == NULL) {
+			perror("calloc didn't return success \n");
+			sem_destroy(&ack);
+			return PTS_UNRESOLVED;
+		}
+		release = 0;
+		for (i = 0; i < nblk; i++) {
+			if (0 != pthread_create(&blk[i], NULL, blocked_thread, NULL)) {
+				perror("pthread_create didn't return success \n");
+				release_blocked(blk, i);
+				free(blk);
+				sem_destroy(&ack);
+				return PTS_UNRESOLVED;
+			}
+		}
+	}
+
+	if (0 != pthread_create(&th, NULL, recv_thread, NULL)) {
+		perror("pthread_create didn't return success \n");
+		ret = PTS_UNRESOLVED;
+	} else {
+		if (sender != SEND_RAISE) {
+			for (i = 0; (i < ROUNDS) && !failed; i++) {
+				if (-1 == send_one(th, i)) {
+					perror("Failed to send the signal \n");
+					ret = PTS_UNRESOLVED;
+					/* The receiver waits for ever otherwise */
+					pthread_cancel(th);
+					break;
+				}
+				while ((-1 == sem_wait(&ack)) && (errno == EINTR))
+					;
+			}
+		}
+		if ((0 != pthread_join(th, &thret)) || (failed))
+			ret = PTS_UNRESOLVED;
+	}
+
+	if ((nblk > 0) && (-1 == release_blocked(blk, nblk)))
+		ret = PTS_UNRESOLVED;
+	free(blk);
+	sem_destroy(&ack);
+
+	if (ret == PTS_PASS)
+		printf("%-12s %-12s %7d %10llu %10llu %10llu\n", senders[snd],
+			receivers[rcv], nblk, pts_hist_percentile(lat, 50.0),
+			pts_hist_percentile(lat, 99.0), lat->max);
+	else
+		printf("%s to %s failed with %d blocked threads\n", senders[snd],
+			receivers[rcv], nblk);
+	return ret;
+}
+
+/* Fill and drain the signal queue; returns a PTS_* status */
+static int queue(void)
+{
+	union sigval sv;
+	siginfo_t info;
+	sigset_t pending;
+	struct timespec ts;
+	unsigned long long t0, t1, t2, tq = 0, td = 0, total = 0;
+	long qmax, sent, i;
+	int r, ret;
+
+	ts.tv_sec = 1;
+	ts.tv_nsec = 0;
+
+	qmax = sysconf(_SC_SIGQUEUE_MAX);
+	if ((qmax <= 0) || (qmax > QUEUE_CAP))
+		qmax = QUEUE_CAP;
+
+	for (r = 0; r < QROUNDS; r++) {
+		sent = 0;
+		t0 = pts_now_ns();
+		while (sent < qmax) {
+			sv.sival_int = sent;
+			if (-1 == sigqueue(getpid(), sig, sv)) {
+				if (errno == EAGAIN)
+					break;
+				perror("sigqueue didn't return success \n");
+				return PTS_UNRESOLVED;
+			}
+			sent++;
+		}
+		t1 = pts_now_ns();
+
+		for (i = 0; i < sent; i++) {
+			do {
+				ret = sigtimedwait(&sigset, &info, &ts);
+			} while ((ret == -1) && (errno == EINTR));
+			if ((ret == -1) && (errno == EAGAIN)) {
+				printf("Only %ld signals received out of %ld queued\n",
+					i, sent);
+				return PTS_FAIL;
+			}
+			if (ret == -1) {
+				perror("sigtimedwait didn't return success \n");
+				return PTS_UNRESOLVED;
+			}
+			if (info.si_value.sival_int != i) {
+				printf("Received the signal #%d instead of #%ld\n",
+					info.si_value.sival_int, i);
+				return PTS_FAIL;
+			}
+		}
+		t2 = pts_now_ns();
+
+		if (-1 == sigpending(&pending)) {
+			perror("sigpending didn't return success \n");
+			return PTS_UNRESOLVED;
+		}
+		if (sigismember(&pending, sig)) {
+			printf("The signal is still pending after the %ld queued ones were received\n",
+				sent);
+			return PTS_FAIL;
+		}
+
+		tq += t1 - t0;
+		td += t2 - t1;
+		total += sent;
+	}
+
+	printf("\nSIGQUEUE_MAX %ld: %ld signals queued, %.0f sigqueue/s, %.0f sigtimedwait/s\n",
+		qmax, (long)(total / QROUNDS),
+		(double)total * 1000000000.0 / (double)tq,
+		(double)total * 1000000000.0 / (double)td);
+	return PTS_PASS;
+}
+
+int main(int argc, char *argv[])
+{
+	struct sigaction sa;
+	unsigned int b;
+	int s, r, ret = PTS_PASS;
+
+	sig = SIGRTMIN;
+	sigemptyset(&sigset);
+	sigaddset(&sigset, sig);
+
+	/* Blocked before any thread is created, so that all inherit it */
+	if ((0 != pthread_sigmask(SIG_BLOCK, &sigset, NULL))
+	 || (0 != pthread_sigmask(SIG_BLOCK, NULL, &waitmask))) {
+		perror("pthread_sigmask didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	sigdelset(&waitmask, sig);
+
+	sa.sa_sigaction = handler;
+	sa.sa_flags = SA_SIGINFO;
+	sigemptyset(&sa.sa_mask);
+	if (-1 == sigaction(sig, &sa, NULL)) {
+		perror("sigaction didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	lat = malloc(sizeof(pts_hist_t));
+	if (lat == NULL) {
+		perror("malloc didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	printf("%d signals per case, latency from the send in ns\n", ROUNDS);
+	printf("%-12s %-12s %7s %10s %10s %10s\n", "Sender", "Receiver",
+		"Blocked", "p50", "p99", "max");
+
+	for (s = 0; (s < NSENDERS) && (ret == PTS_PASS); s++)
+		for (r = 0; (r < NRECEIVERS) && (ret == PTS_PASS); r++)
+			ret = latency(s, r, 0);
+
+	for (b = 1; (b < NBLOCKED) && (ret == PTS_PASS); b++) {
+		ret = latency(SEND_KILL, RECV_HANDLER, nblocked[b]);
+		if (ret == PTS_PASS)
+			ret = latency(SEND_KILL, RECV_SIGWAITINFO, nblocked[b]);
+	}
+
+	if (ret == PTS_PASS)
+		ret = queue();
+
+	free(lat);
+
+	if (ret == PTS_PASS)
+		printf("Test PASSED\n");
+	else
+		printf("Test %s\n", (ret == PTS_FAIL) ? "FAILED" : "UNRESOLVED");
+	return ret;
+}
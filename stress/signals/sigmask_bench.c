@@ -0,0 +1,357 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * This is a benchmark of the signal mask operations, as found in the
+ * critical sections which block the signals around their work.
+ *
+ * For each operation of ops[] and for 1, 2, 4, ... N threads (N is the
+ * # of CPUs, at least 2, pinned one per CPU when the system allows it),
+ * each thread runs LOOPS iterations of:
+ *  - a pthread_sigmask SIG_BLOCK / SIG_UNBLOCK pair on one signal;
+ *  - a pthread_sigmask SIG_SETMASK pair, full set then the saved mask;
+ *  - a pthread_sigmask query of the current mask;
+ *  - a sigprocmask SIG_BLOCK / SIG_UNBLOCK pair on one signal;
+ *  - a sighold / sigrelse pair on one signal;
+ *  - sigemptyset, sigfillset;
+ *  - sigaddset, sigdelset, sigismember over every valid signal number
+ *    (one iteration is a pass over the full set).
+ * The mean cost of an iteration and the total # of iterations per
+ * second are reported.
+ *
+ * The test fails if the mask of a thread is not restored after the
+ * iterations of an operation.
+ */
+
+/* sighold and sigrelse are XSI */
+#define _XOPEN_SOURCE 600
+
+/* The threads are pinned with the Linux affinity API */
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "posixtest.h"
+#include "pts_bench.h"
+#include "pts_placement.h"
+
+#define LOOPS		100000
+#define SIG		SIGUSR1
+
+/* The signal numbers accepted by sigaddset */
+int sigs[128];
+int nsigs;
+
+typedef struct {
+	char *name;
+	int (*fn)(int loops);
+} op_t;
+
+/* The data of each thread */
+typedef struct {
+	pthread_t th;
+	int index;
+	int error;
+	int changed;		/* the mask was not restored */
+	unsigned long long elapsed;	/* ns for the LOOPS iterations */
+} worker_t;
+
+op_t *op;
+pts_gate_t gate;
+int pinned;
+volatile int sink;
+
+static int mask_pair(int loops)
+{
+	sigset_t set;
+	int i;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIG);
+	for (i = 0; i < loops; i++) {
+		if (0 != pthread_sigmask(SIG_BLOCK, &set, NULL))
+			return -1;
+		if (0 != pthread_sigmask(SIG_UNBLOCK, &set, NULL))
+			return -1;
+	}
+	return 0;
+}
+
+static int mask_setmask(int loops)
+{
+	sigset_t full, old;
+	int i;
+
+	sigfillset(&full);
+	for (i = 0; i < loops; i++) {
+		if (0 != pthread_sigmask(SIG_SETMASK, &full, &old))
+			return -1;
+		if (0 != pthread_sigmask(SIG_SETMASK, &old, NULL))
+			return -1;
+	}
+	return 0;
+}
+
+static int mask_query(int loops)
+{
+	sigset_t cur;
+	int i;
+
+	for (i = 0; i < loops; i++)
+		if (0 != pthread_sigmask(SIG_BLOCK, NULL, &cur))
+			return -1;
+	return 0;
+}
+
+static int procmask_pair(int loops)
+{
+	sigset_t set;
+	int i;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIG);
+	for (i = 0; i < loops; i++) {
+		if (-1 == sigprocmask(SIG_BLOCK, &set, NULL))
+			return -1;
+		if (-1 == sigprocmask(SIG_UNBLOCK, &set, NULL))
+			return -1;
+	}
+	return 0;
+}
+
+/* sighold and sigrelse are marked obsolescent by some C libraries */
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+static int hold_pair(int loops)
+{
+	int i;
+
+	for (i = 0; i < loops; i++) {
+		if (-1 == sighold(SIG))
+			return -1;
+		if (-1 == sigrelse(SIG))
+			return -1;
+	}
+	return 0;
+}
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+static int set_empty(int loops)
+{
+	sigset_t set;
+	int i;
+
+	for (i = 0; i < loops; i++)
+		if (-1 == sigemptyset(&set))
+			return -1;
+	return 0;
+}
+
+static int set_fill(int loops)
+{
+	sigset_t set;
+	int i;
+
+	for (i = 0; i < loops; i++)
+		if (-1 == sigfillset(&set))
+			return -1;
+	return 0;
+}
+
+static int set_add(int loops)
+{
+	sigset_t set;
+	int i, s;
+
+	sigemptyset(&set);
+	for (i = 0; i < loops; i++)
+		for (s = 0; s < nsigs; s++)
+			if (-1 == sigaddset(&set, sigs[s]))
+				return -1;
+	return 0;
+}
+
+static int set_del(int loops)
+{
+	sigset_t set;
+	int i, s;
+
+	sigfillset(&set);
+	for (i = 0; i < loops; i++)
+		for (s = 0; s < nsigs; s++)
+			if (-1 == sigdelset(&set, sigs[s]))
+				return -1;
+	return 0;
+}
+
+static int set_ismember(int loops)
+{
+	sigset_t set;
+	int i, s, r, n = 0;
+
+	sigfillset(&set);
+	for (i = 0; i < loops; i++)
+		for (s = 0; s < nsigs; s++) {
+			r = sigismember(&set, sigs[s]);
+			if (r == -1)
+				return -1;
+			n += r;
+		}
+	sink = n;
+	return 0;
+}
+
+op_t ops[] = {
+	{ "pthread_sigmask block+unblock",	mask_pair },
+	{ "pthread_sigmask setmask full+old",	mask_setmask },
+	{ "pthread_sigmask query",		mask_query },
+	{ "sigprocmask block+unblock",		procmask_pair },
+	{ "sighold+sigrelse",			hold_pair },
+	{ "sigemptyset",			set_empty },
+	{ "sigfillset",				set_fill },
+	{ "sigaddset (full set)",		set_add },
+	{ "sigdelset (full set)",		set_del },
+	{ "sigismember (full set)",		set_ismember },
+};
+#define NOPS	(sizeof(ops) / sizeof(ops[0]))
+
+static void *worker(void *arg)
+{
+	worker_t *w = (worker_t *)arg;
+	sigset_t before, after;
+	unsigned long long t0;
+	int s;
+
+	if (pinned && (0 != pts_place_thread(w->index)))
+		w->error = 1;
+	if (0 != pthread_sigmask(SIG_BLOCK, NULL, &before))
+		w->error = 1;
+	if (0 != pts_gate_ready(&gate))
+		w->error = 1;
+	if (w->error)
+		return NULL;
+
+	t0 = pts_now_ns();
+	if (0 != op->fn(LOOPS))
+		w->error = 1;
+	w->elapsed = pts_now_ns() - t0;
+
+	if (0 != pthread_sigmask(SIG_BLOCK, NULL, &after))
+		w->error = 1;
+	for (s = 0; s < nsigs; s++)
+		if (sigismember(&before, sigs[s]) != sigismember(&after, sigs[s]))
+			w->changed = 1;
+	return NULL;
+}
+
+/* Run n threads of the current operation; returns -1 if a thread failed */
+static int run(int n, worker_t *w)
+{
+	int i, ret = 0;
+
+	if (0 != pts_gate_init(&gate)) {
+		perror("pts_gate_init didn't return success \n");
+		return -1;
+	}
+	for (i = 0; i < n; i++) {
+		memset(&w[i], 0, sizeof(worker_t));
+		w[i].index = i;
+		if (0 != pthread_create(&w[i].th, NULL, worker, &w[i])) {
+			perror("pthread_create didn't return success \n");
+			return -1;
+		}
+	}
+	if (0 != pts_gate_open(&gate, n)) {
+		perror("pts_gate_open didn't return success \n");
+		return -1;
+	}
+	for (i = 0; i < n; i++) {
+		if (0 != pthread_join(w[i].th, NULL)) {
+			perror("pthread_join didn't return success \n");
+			return -1;
+		}
+		if (w[i].error)
+			ret = -1;
+	}
+	pts_gate_destroy(&gate);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	worker_t *w;
+	sigset_t set;
+	unsigned long long sum;
+	unsigned int o;
+	int i, n, s, max, npin, changed, ret = PTS_PASS;
+
+	for (s = 1; (s < SIGRTMAX + 1) && (nsigs < 128); s++) {
+		sigemptyset(&set);
+		if (0 == sigaddset(&set, s))
+			sigs[nsigs++] = s;
+	}
+
+	max = pts_max_threads(1);
+
+	npin = pts_placement_init();
+	if (npin > 0)
+		pts_placement = PTS_PLACE_COMPACT;
+	pinned = (npin > 0);
+
+	w = calloc(max, sizeof(worker_t));
+	if (w == NULL) {
+		perror("calloc didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	printf("%d iterations per thread, up to %d threads%s, %d signals per full set\n",
+		LOOPS, max, pinned ? "" : " (not pinned)", nsigs);
+	printf("%-34s %7s %9s %12s\n", "Operation", "Threads", "ns/iter", "Iter/s");
+
+	for (o = 0; o < NOPS; o++) {
+		op = &ops[o];
+		for (n = 1; n != 0; n = pts_next_count(n, max)) {
+			if (-1 == run(n, w)) {
+				printf("%s failed with %d threads\n", op->name, n);
+				ret = PTS_UNRESOLVED;
+				goto out;
+			}
+			sum = 0;
+			changed = 0;
+			for (i = 0; i < n; i++) {
+				sum += w[i].elapsed;
+				changed += w[i].changed;
+			}
+			printf("%-34s %7d %9.1f %12.0f\n", op->name, n,
+				(double)sum / ((double)n * LOOPS),
+				(double)n * LOOPS * 1000000000.0 / ((double)sum / n));
+			if (changed != 0) {
+				printf("%s did not restore the mask of %d threads\n",
+					op->name, changed);
+				ret = PTS_FAIL;
+			}
+		}
+	}
+
+out:
+	free(w);
+
+	if (ret == PTS_PASS)
+		printf("Test PASSED\n");
+	else
+		printf("Test %s\n", (ret == PTS_FAIL) ? "FAILED" : "UNRESOLVED");
+	return ret;
+}
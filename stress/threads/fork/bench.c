@@ -0,0 +1,286 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+
+
+ * This file is a benchmark for the fork function.
+ * It measures how the state of the parent process slows fork down.
+
+ * The steps are:
+ * -> The parent is configured with:
+ *    -> an amount of touched anonymous memory, mapped with mmap either
+ *       MAP_PRIVATE (it must be copied on write) or MAP_SHARED;
+ *    -> a # of other threads, blocked on a condition variable;
+ *    -> a # of pthread_atfork handler triples.
+ * -> Each parameter is swept in turn, the others keeping their base
+ *    value (the atfork handlers cannot be removed, so they are swept last).
+ * -> For each configuration the parent forks ROUNDS times; each child
+ *    sends its start time through a pipe and exits. We report:
+ *    -> the parent stall, i.e. the duration of the fork call in the parent;
+ *    -> the child start latency, i.e. the delay between the fork call
+ *       and the first instruction of the child after fork returns;
+ *    (p50, p99 and max of each).
+ */
+
+ /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
+ #define _POSIX_C_SOURCE 200112L
+
+ /* MAP_ANONYMOUS is not part of POSIX */
+#ifdef __linux__
+ #define _GNU_SOURCE
+#endif
+
+/********************************************************************************************/
+/****************************** standard includes *****************************************/
+/********************************************************************************************/
+ #include <pthread.h>
+ #include <stdarg.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+
+ #include <sys/mman.h>
+ #include <sys/wait.h>
+ #include <errno.h>
+
+/********************************************************************************************/
+/******************************   Test framework   *****************************************/
+/********************************************************************************************/
+ #include "testfrmw.h"
+ #include "testfrmw.c"
+ #include "pts_bench.h"
+ #include "pts_histogram.h"
+ /* testfrmw.h gives UNRESOLVED, FAILED and PASSED, which end the process,
+  * and output(); pts_bench.h gives the clock, start gate and run routines. */
+
+/********************************************************************************************/
+/********************************** Configuration ******************************************/
+/********************************************************************************************/
+#ifndef SCALABILITY_FACTOR
+#define SCALABILITY_FACTOR 1
+#endif
+#ifndef VERBOSE
+#define VERBOSE 1
+#endif
+
+/* # of forks for each configuration */
+#ifndef ROUNDS
+#define ROUNDS (50 * SCALABILITY_FACTOR)
+#endif
+
+/* Largest memory size, in MB */
+#ifndef MEM_MAX
+#define MEM_MAX (256 * SCALABILITY_FACTOR)
+#endif
+
+#ifdef PLOT_OUTPUT
+#undef VERBOSE
+#define VERBOSE 0
+#endif
+
+/********************************************************************************************/
+/***********************************    Test case   *****************************************/
+/********************************************************************************************/
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#define MEM_PRIVATE 0
+#define MEM_SHARED  1
+char * kinds[] = { "private", "shared" };
+
+/* Swept values; the first one of each list is the base value */
+int mem_mb[] = { 0, 16, 64, MEM_MAX };
+int nthreads[] = { 0, 1, 4, 16, 64 };
+int nhandlers[] = { 0, 1, 16, 256 };
+#define NMEM      (sizeof(mem_mb) / sizeof(mem_mb[0]))
+#define NTHREADS  (sizeof(nthreads) / sizeof(nthreads[0]))
+#define NHANDLERS (sizeof(nhandlers) / sizeof(nhandlers[0]))
+
+/* The other threads of the parent wait for this */
+pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cnd = PTHREAD_COND_INITIALIZER;
+int release;
+
+/* Updated by the atfork handlers */
+volatile unsigned long atfork_calls;
+
+void prepare(void)  {  atfork_calls++;  }
+void parent(void)   {  atfork_calls++;  }
+void child(void)    {  atfork_calls++;  }
+
+void * blocked(void * arg)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+	while (!release)
+	{
+		ret = pthread_cond_wait(&cnd, &mtx);
+		if (ret != 0)  {  UNRESOLVED(ret, "Cond wait failed");  }
+	}
+	ret = pthread_mutex_unlock(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+
+	return NULL;
+}
+
+/* Fork ROUNDS times in the current configuration, and report */
+void run(int mb, int kind, int nth, int nhdl)
+{
+	int ret, i, fds[2], status;
+	pid_t pid;
+	char * mem = NULL;
+	size_t size = (size_t) mb * 1024 * 1024;
+	pthread_t * th = NULL;
+	unsigned long long t0, t1, tchild;
+	pts_hist_t * stall, * start;
+
+	/* Configure the parent */
+	if (size > 0)
+	{
+		mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		           ((kind == MEM_SHARED) ? MAP_SHARED : MAP_PRIVATE) | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED)  {  UNRESOLVED(errno, "Unable to map the memory");  }
+		memset(mem, 1, size);
+	}
+
+	release = 0;
+	if (nth > 0)
+	{
+		th = (pthread_t *) calloc(nth, sizeof(pthread_t));
+		if (th == NULL)  {  UNRESOLVED(errno, "Unable to alloc memory for the threads");  }
+		for (i=0; i<nth; i++)
+		{
+			ret = pthread_create(&th[i], NULL, blocked, NULL);
+			if (ret != 0)  {  UNRESOLVED(ret, "Unable to create a thread");  }
+		}
+	}
+
+	stall = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+	start = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+	if ((stall == NULL) || (start == NULL))  {  UNRESOLVED(errno, "Unable to alloc memory for the histograms");  }
+	pts_hist_init(stall);
+	pts_hist_init(start);
+
+	ret = pipe(fds);
+	if (ret != 0)  {  UNRESOLVED(errno, "Unable to create a pipe");  }
+
+	fflush(stdout);
+	for (i=0; i<ROUNDS; i++)
+	{
+		t0 = pts_now_ns();
+		pid = fork();
+		if (pid == 0)
+		{
+			tchild = pts_now_ns();
+			if (write(fds[1], &tchild, sizeof(tchild)) != sizeof(tchild))
+				_exit(PTS_UNRESOLVED);
+			_exit(PTS_PASS);
+		}
+		t1 = pts_now_ns();
+		if (pid == -1)  {  UNRESOLVED(errno, "Fork failed");  }
+
+		if (read(fds[0], &tchild, sizeof(tchild)) != sizeof(tchild))
+		{  UNRESOLVED(errno, "Failed to read the child start time");  }
+
+		pid = waitpid(pid, &status, 0);
+		if (pid == -1)  {  UNRESOLVED(errno, "Waitpid failed");  }
+		if (!WIFEXITED(status) || (WEXITSTATUS(status) != PTS_PASS))
+		{  UNRESOLVED(status, "The child did not exit normally");  }
+
+		pts_hist_record(stall, t1 - t0);
+		pts_hist_record(start, (tchild > t0) ? tchild - t0 : 0);
+	}
+
+	close(fds[0]);
+	close(fds[1]);
+
+	#ifdef PLOT_OUTPUT
+	printf("%i %i %i %i %llu %llu %llu %llu %llu %llu\n", mb, kind, nth, nhdl,
+	       pts_hist_percentile(stall, 50.0), pts_hist_percentile(stall, 99.0), stall->max,
+	       pts_hist_percentile(start, 50.0), pts_hist_percentile(start, 99.0), start->max);
+	#endif
+	#if VERBOSE > 0
+	output("%6i %-7s %7i %8i %10llu %10llu %10llu %10llu %10llu %10llu\n", mb, kinds[kind], nth, nhdl,
+	       pts_hist_percentile(stall, 50.0), pts_hist_percentile(stall, 99.0), stall->max,
+	       pts_hist_percentile(start, 50.0), pts_hist_percentile(start, 99.0), start->max);
+	#endif
+
+	free(stall);
+	free(start);
+
+	/* Restore the parent */
+	if (nth > 0)
+	{
+		ret = pthread_mutex_lock(&mtx);
+		if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+		release = 1;
+		ret = pthread_cond_broadcast(&cnd);
+		if (ret != 0)  {  UNRESOLVED(ret, "Failed to broadcast the condition");  }
+		ret = pthread_mutex_unlock(&mtx);
+		if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+
+		for (i=0; i<nth; i++)
+		{
+			ret = pthread_join(th[i], NULL);
+			if (ret != 0)  {  UNRESOLVED(ret, "Unable to join a thread");  }
+		}
+		free(th);
+	}
+
+	if (mem != NULL)
+	{
+		ret = munmap(mem, size);
+		if (ret != 0)  {  UNRESOLVED(errno, "Unable to unmap the memory");  }
+	}
+}
+
+int main(int argc, char * argv[])
+{
+	int ret, kind, h;
+	unsigned int i;
+
+	output_init();
+
+	#ifdef PLOT_OUTPUT
+	printf("# COLUMNS 10 Memory(MB) Shared Threads Handlers Stall-p50(ns) Stall-p99(ns) Stall-max(ns) "
+	       "Start-p50(ns) Start-p99(ns) Start-max(ns)\n");
+	#endif
+	#if VERBOSE > 0
+	output("fork benchmark: %i forks per configuration\n", ROUNDS);
+	output("%6s %-7s %7s %8s %10s %10s %10s %10s %10s %10s\n", "MB", "Memory", "Threads", "Handlers",
+	       "Stall-p50", "Stall-p99", "Stall-max", "Start-p50", "Start-p99", "Start-max");
+	#endif
+
+	/* Memory sweep */
+	for (kind = MEM_PRIVATE; kind <= MEM_SHARED; kind++)
+		for (i=0; i<NMEM; i++)
+			run(mem_mb[i], kind, nthreads[0], nhandlers[0]);
+
+	/* Threads sweep */
+	for (i=1; i<NTHREADS; i++)
+		run(mem_mb[0], MEM_PRIVATE, nthreads[i], nhandlers[0]);
+
+	/* Atfork handlers sweep; the handlers add up */
+	h = 0;
+	for (i=1; i<NHANDLERS; i++)
+	{
+		for (; h<nhandlers[i]; h++)
+		{
+			ret = pthread_atfork(prepare, parent, child);
+			if (ret != 0)  {  UNRESOLVED(ret, "Unable to register the atfork handlers");  }
+		}
+		run(mem_mb[0], MEM_PRIVATE, nthreads[0], h);
+	}
+
+	#if VERBOSE > 0
+	output("fork benchmark done.\n");
+	#endif
+
+	PASSED;
+}
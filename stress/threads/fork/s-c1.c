@@ -30,6 +30,11 @@
 /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
 #define _POSIX_C_SOURCE 200112L
 
+/* CPU placement (see pts_placement.h) uses the Linux affinity API */
+#ifdef PLACEMENT_SWEEP
+#define _GNU_SOURCE
+#endif
+
 /* Some routines are part of the XSI Extensions */
 #ifndef WITHOUT_XOPEN
  #define _XOPEN_SOURCE	600
@@ -58,6 +63,9 @@
 /********************************************************************************************/
 #include "testfrmw.h"
  #include "testfrmw.c" 
+ #include "pts_placement.h"
+ #include "pts_scalability.h"
+ #include "pts_histogram.h"
 /* This header is responsible for defining the following macros:
  * UNRESOLVED(ret, descr);  
  *    where descr is a description of the error and ret is an int (error code for example)
@@ -117,6 +125,9 @@ int parse_measure( mes_t * measures );
 sem_t *sem_synchro;
 sem_t *sem_ending;
 
+/* Latency of every single fork */
+pts_hist_t lat;
+
 int main ( int argc, char *argv[] )
 {
 	int ret, status;
@@ -140,6 +151,11 @@ int main ( int argc, char *argv[] )
 	/* Initialize output routine */
 	output_init();
 
+#ifdef PLACEMENT_SWEEP
+	/* Run the following once per CPU placement */
+	pts_placement_sweep();
+#endif
+
 	if ( CHILD_MAX > 0 )
 		my_max = CHILD_MAX;
 
@@ -181,6 +197,7 @@ int main ( int argc, char *argv[] )
 
 	nprocesses = 0;
 	m_cur = &sentinel;
+	pts_hist_init( &lat );
 
 	while ( 1 )                                      /* we will break */
 	{
@@ -222,6 +239,14 @@ int main ( int argc, char *argv[] )
 		if ( pr[ nprocesses ] == 0 )
 		{
 			/* Child */
+			/* Pin this process according to the CPU placement */
+			ret = pts_place_thread( nprocesses + 1 );
+
+			if ( ret != 0 )
+			{
+				UNRESOLVED( ret, "Unable to place the process" );
+			}
+
 			/* Post the synchro semaphore*/
 
 			do
@@ -304,6 +329,8 @@ int main ( int argc, char *argv[] )
 			UNRESOLVED( errno, "Unable to read clock" );
 		}
 
+		pts_hist_record_ts( &lat, &ts_ref, &ts_fin );
+
 		/* add to the measure list if nprocesses % resolution == 0 */
 		if ( ( ( nprocesses % RESOLUTION ) == 0 ) && ( nprocesses != 0 ) )
 		{
@@ -381,6 +408,10 @@ int main ( int argc, char *argv[] )
 	/* Compute the results */
 	ret = parse_measure( &sentinel );
 
+#if VERBOSE > 0
+	pts_hist_report( "fork", &lat );
+
+#endif
 
 	/* Free the resources and output the results */
 
@@ -426,280 +457,52 @@ int main ( int argc, char *argv[] )
 
 
 /***
- * The next function will seek for the better model for each series of measurements.
- *
- * The tested models are: -- X = # threads; Y = latency
- * -> Y = a;      -- Error is r1 = avg( (Y - Yavg)² );
- * -> Y = aX + b; -- Error is r2 = avg( (Y -aX -b)² );
- *                -- where a = avg ( (X - Xavg)(Y - Yavg) ) / avg( ( X - Xavg)² )
- *                --         Note: We will call _q = sum( (X - Xavg) * (Y - Yavg) ); 
- *                --                       and  _d = sum( (X - Xavg)² );
- *                -- and   b = Yavg - a * Xavg
- * -> Y = c * X^a;-- Same as previous, but with log(Y) = a log(X) + b; and b = log(c). Error is r3
- * -> Y = exp(aX + b); -- log(Y) = aX + b. Error is r4
- *
- * We compute each error factor (r1, r2, r3, r4) then search which is the smallest (with ponderation).
- * The function returns 0 when r1 is the best for all cases (latency is constant) and !0 otherwise.
+ * The next function will seek for the better model for the series of measurements
+ * (see pts_scalability.h for the models and the verdict).
+ * The function returns 0 when the duration is constant and !0 otherwise.
  */
 
-struct row
-{
-	long X;  /* the X values -- copied from function argument */
-	long Y;  /* the Y values -- copied from function argument */
-	long _x; /* Value X - Xavg */
-	long _y; /* Value Y - Yavg */
-	double LnX; /* Natural logarithm of X values */
-	double LnY; /* Natural logarithm of Y values */
-	double _lnx; /* Value LnX - LnXavg */
-	double _lny; /* Value LnY - LnYavg */
-};
-
 int parse_measure( mes_t * measures )
 {
-	int ret, r;
+	int err;
 
 	mes_t *cur;
 
-	double Xavg, Yavg;
-	double LnXavg, LnYavg;
-
-	int N;
-
-	double r1, r2, r3, r4;
-
-	/* Some more intermediate vars */
-	long double _q[ 3 ];
-	long double _d[ 3 ];
-
-	long double t; /* temp value */
-
-	struct row *Table = NULL;
-
-	/* This array contains the last element of each serie */
-	int array_max;
-
-	/* Initialize the datas */
-
-	array_max = -1; /* means no data */
-	Xavg = 0.0;
-	LnXavg = 0.0;
-	Yavg = 0.0;
-	LnYavg = 0.0;
-	r1 = 0.0;
-	r2 = 0.0;
-	r3 = 0.0;
-	r4 = 0.0;
-	_q[ 0 ] = 0.0;
-	_q[ 1 ] = 0.0;
-	_q[ 2 ] = 0.0;
-	_d[ 0 ] = 0.0;
-	_d[ 1 ] = 0.0;
-	_d[ 2 ] = 0.0;
-
-	N = 0;
-	cur = measures;
+	pts_serie_t serie = PTS_SERIE_INITIALIZER;
+	pts_fit_t fit;
 
 #if VERBOSE > 1
 	output( "Data analysis starting\n" );
-#endif
 
-	/* We start with reading the list to find:
-	 * -> number of elements, to assign an array.
-	 * -> average values 
-	 */
+#endif
 
-	while ( cur->next != NULL )
+	for ( cur = measures->next; cur != NULL; cur = cur->next )
 	{
-		cur = cur->next;
-
-		N++;
-
 		if ( cur->_data != 0 )
 		{
-			array_max = N;
-			Xavg += ( double ) cur->nprocess;
-			LnXavg += log( ( double ) cur->nprocess );
-			Yavg += ( double ) cur->_data;
-			LnYavg += log( ( double ) cur->_data );
-		}
-	}
-
-	/* We have the sum; we can divide to obtain the average values */
-	if ( array_max != -1 )
-	{
-		Xavg /= array_max;
-		LnXavg /= array_max;
-		Yavg /= array_max;
-		LnYavg /= array_max;
-	}
-
-#if VERBOSE > 1
-	output( " Found %d rows\n", N );
-
-#endif
-
+			err = pts_serie_add( &serie, ( double ) cur->nprocess, ( double ) cur->_data );
 
-	/* We will now alloc the array ... */
-
-	Table = calloc( N, sizeof( struct row ) );
-
-	if ( Table == NULL )
-	{
-		UNRESOLVED( errno, "Unable to alloc space for results parsing" );
-	}
-
-	/* ... and fill it */
-	N = 0;
-
-	cur = measures;
-
-	while ( cur->next != NULL )
-	{
-		cur = cur->next;
-
-		Table[ N ].X = ( long ) cur->nprocess;
-		Table[ N ].LnX = log( ( double ) cur->nprocess );
-
-		if ( array_max > N )
-		{
-			Table[ N ]._x = Table[ N ].X - Xavg ;
-			Table[ N ]._lnx = Table[ N ].LnX - LnXavg;
-			Table[ N ].Y = cur->_data;
-			Table[ N ]._y = Table[ N ].Y - Yavg ;
-			Table[ N ].LnY = log( ( double ) cur->_data );
-			Table[ N ]._lny = Table[ N ].LnY - LnYavg;
+			if ( err != 0 )
+			{
+				UNRESOLVED( err, "Unable to alloc space for results parsing" );
+			}
 		}
-
-		N++;
 	}
 
-	/* We won't need the list anymore -- we'll work with the array which should be faster. */
-#if VERBOSE > 1
-	output( " Data was stored in an array.\n" );
+	err = pts_scal_fit( &serie, &fit );
 
-#endif
-
-	/* We need to read the full array at least twice to compute all the error factors */
-
-	/* In the first pass, we'll compute:
-	 * -> r1 for each scenar.
-	 * -> "a" factor for linear (0), power (1) and exponential (2) approximations -- with using the _d and _q vars.
-	 */
-#if VERBOSE > 1
-	output( "Starting first pass...\n" );
-
-#endif
-	for ( r = 0; r < array_max; r++ )
+	if ( err != 0 )
 	{
-		r1 += ( ( double ) Table[ r ]._y / array_max ) * ( double ) Table[ r ]._y;
-
-		_q[ 0 ] += Table[ r ]._y * Table[ r ]._x;
-		_d[ 0 ] += Table[ r ]._x * Table[ r ]._x;
-
-		_q[ 1 ] += Table[ r ]._lny * Table[ r ]._lnx;
-		_d[ 1 ] += Table[ r ]._lnx * Table[ r ]._lnx;
-
-		_q[ 2 ] += Table[ r ]._lny * Table[ r ]._x;
-		_d[ 2 ] += Table[ r ]._x * Table[ r ]._x;
+		UNRESOLVED( err, "Unable to alloc space for results parsing" );
 	}
 
-	/* First pass is terminated; a2 = _q[0]/_d[0]; a3 = _q[1]/_d[1]; a4 = _q[2]/_d[2] */
-
-	/* In the first pass, we'll compute:
-	 * -> r2, r3, r4 for each scenar.
-	 */
-
-#if VERBOSE > 1
-	output( "Starting second pass...\n" );
-
-#endif
-	for ( r = 0; r < array_max; r++ )
-	{
-		/* r2 = avg((y - ax -b)²);  t = (y - ax - b) = (y - yavg) - a (x - xavg); */
-		t = ( Table[ r ]._y - ( ( _q[ 0 ] * Table[ r ]._x ) / _d[ 0 ] ) );
-		r2 += t * t / array_max ;
-
-		/* r3 = avg(( y - c.x^a) ²);
-		    t = y - c * x ^ a 
-		      = y - log (LnYavg - (_q[1]/_d[1]) * LnXavg) * x ^ (_q[1]/_d[1])
-		*/
-		t = ( Table[ r ].Y
-		      - ( logl ( LnYavg - ( _q[ 1 ] / _d[ 1 ] ) * LnXavg )
-		          * powl( Table[ r ].X, ( _q[ 1 ] / _d[ 1 ] ) )
-		        ) );
-		r3 += t * t / array_max ;
-
-		/* r4 = avg(( y - exp(ax+b))²);
-		    t = y - exp(ax+b)
-		      = y - exp( _q[2]/_d[2] * x + ( LnYavg - (_q[2]/_d[2] * Xavg) ));
-		      = y - exp( _q[2]/_d[2] * (x - Xavg) + LnYavg );
-		*/
-		t = ( Table[ r ].Y
-		      - expl( ( _q[ 2 ] / _d[ 2 ] ) * Table[ r ]._x + LnYavg ) );
-		r4 += t * t / array_max ;
-
-	}
-
-#if VERBOSE > 1
-	output( "All computing terminated.\n" );
-
-#endif
-	ret = 0;
-
 #if VERBOSE > 1
-	output( " # of data: %i\n", array_max );
-
-	output( "  Model: Y = k\n" );
-
-	output( "       k = %g\n", Yavg );
-
-	output( "    Divergence %g\n", r1 );
-
-	output( "  Model: Y = a * X + b\n" );
-
-	output( "       a = %Lg\n", _q[ 0 ] / _d[ 0 ] );
-
-	output( "       b = %Lg\n", Yavg - ( ( _q[ 0 ] / _d[ 0 ] ) * Xavg ) );
-
-	output( "    Divergence %g\n", r2 );
-
-	output( "  Model: Y = c * X ^ a\n" );
-
-	output( "       a = %Lg\n", _q[ 1 ] / _d[ 1 ] );
-
-	output( "       c = %Lg\n", logl ( LnYavg - ( _q[ 1 ] / _d[ 1 ] ) * LnXavg ) );
-
-	output( "    Divergence %g\n", r2 );
-
-	output( "  Model: Y = exp(a * X + b)\n" );
-
-	output( "       a = %Lg\n", _q[ 2 ] / _d[ 2 ] );
-
-	output( "       b = %Lg\n", LnYavg - ( ( _q[ 2 ] / _d[ 2 ] ) * Xavg ) );
-
-	output( "    Divergence %g\n", r2 );
-
-#endif
-
-	if ( array_max != -1 )
-	{
-		/* Compare r1 to other values, with some ponderations */
-
-		if ( ( r1 > 1.1 * r2 ) || ( r1 > 1.2 * r3 ) || ( r1 > 1.3 * r4 ) )
-			ret++;
-
-#if VERBOSE > 1
-		else
-			output( " Sanction: OK\n" );
+	pts_scal_report( "fork", &fit );
 
 #endif
 
-	}
-
-	/* We need to free the array */
-	free( Table );
+	pts_serie_free( &serie );
 
 	/* We're done */
-	return ret;
+	return fit.grows;
 }
-
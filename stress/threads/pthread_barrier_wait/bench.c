@@ -0,0 +1,318 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+
+
+ * This file is a benchmark for the pthread_barrier_wait function.
+ * It measures how long a barrier takes to release its threads.
+
+ * The steps are:
+ * -> For each kind of barrier (pthread_barrier_t, and a barrier made of
+ *    a mutex and a condition variable as a reference),
+ *    for the threads not pinned, then pinned one per CPU,
+ *    and for 2, 4, ... N threads (N is the # of processors, at least 2),
+ *    -> each thread goes ROUNDS times through the barrier, and saves its
+ *       arrival and departure times for each phase.
+ * -> For each case we report:
+ *    -> the # of phases per second, from the release of the threads at a
+ *       start gate to the last departure of the last phase;
+ *    -> the phase latency, i.e. the delay between the last arrival and
+ *       the last departure of a phase (p50, p99 and max).
+ * -> The test fails if a thread leaves a phase before all the threads
+ *    have arrived, or if the serial thread is not unique.
+ */
+
+ /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
+ #define _POSIX_C_SOURCE 200112L
+
+ /* Pinning the threads (see pts_placement.h) uses the Linux affinity API */
+#ifdef __linux__
+ #define _GNU_SOURCE
+#endif
+
+/********************************************************************************************/
+/****************************** standard includes *****************************************/
+/********************************************************************************************/
+ #include <pthread.h>
+ #include <errno.h>
+ #include <unistd.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <stdarg.h>
+ #include <time.h>
+
+/********************************************************************************************/
+/******************************   Test framework   *****************************************/
+/********************************************************************************************/
+ #include "testfrmw.h"
+ #include "testfrmw.c"
+ #include "pts_bench.h"
+ #include "pts_histogram.h"
+ #include "pts_placement.h"
+ /* testfrmw.h gives UNRESOLVED, FAILED and PASSED, which end the process,
+  * and output(); pts_bench.h gives the clock, start gate and run routines. */
+
+/********************************************************************************************/
+/********************************** Configuration ******************************************/
+/********************************************************************************************/
+#ifndef SCALABILITY_FACTOR
+#define SCALABILITY_FACTOR 1
+#endif
+#ifndef VERBOSE
+#define VERBOSE 1
+#endif
+
+/* # of phases for each case */
+#ifndef ROUNDS
+#define ROUNDS (2000 * SCALABILITY_FACTOR)
+#endif
+
+#ifdef PLOT_OUTPUT
+#undef VERBOSE
+#define VERBOSE 0
+#endif
+
+/********************************************************************************************/
+/***********************************    Test case   *****************************************/
+/********************************************************************************************/
+
+#define BAR_PTHREAD 0
+#define BAR_COND    1
+char * names[] = { "pthread", "condvar" };
+
+/* The barrier made of a mutex and a condition variable */
+typedef struct
+{
+	pthread_mutex_t mtx;
+	pthread_cond_t cnd;
+	int count;    /* # of threads which have not arrived yet */
+	int n;
+	int gen;      /* incremented at each phase */
+} cbar_t;
+
+/* Returns 1 in the last thread to arrive, 0 in the others */
+int cbar_wait(cbar_t * b)
+{
+	int ret, gen, serial = 0;
+
+	ret = pthread_mutex_lock(&b->mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+
+	gen = b->gen;
+	if (--b->count == 0)
+	{
+		b->count = b->n;
+		b->gen++;
+		serial = 1;
+		ret = pthread_cond_broadcast(&b->cnd);
+		if (ret != 0)  {  UNRESOLVED(ret, "Failed to broadcast the condition");  }
+	}
+	else
+	{
+		while (b->gen == gen)
+		{
+			ret = pthread_cond_wait(&b->cnd, &b->mtx);
+			if (ret != 0)  {  UNRESOLVED(ret, "Cond wait failed");  }
+		}
+	}
+
+	ret = pthread_mutex_unlock(&b->mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+
+	return serial;
+}
+
+/* The data shared by the threads of a case */
+int kind;
+int nthreads;
+int pinned;
+pthread_barrier_t bar;
+cbar_t cbar;
+unsigned long long * arrive;   /* [phase * nthreads + thread] */
+unsigned long long * depart;
+volatile int * serials;        /* # of serial threads in each phase */
+pts_gate_t gate;               /* released once all the threads are started */
+
+void * worker(void * arg)
+{
+	int ret, i, serial;
+	long id = (long)arg;
+
+	if (pinned)
+	{
+		ret = pts_place_thread(id);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to pin the thread");  }
+	}
+
+	ret = pts_gate_ready(&gate);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to wait at the start gate");  }
+
+	for (i=0; i<ROUNDS; i++)
+	{
+		arrive[i * nthreads + id] = pts_now_ns();
+
+		if (kind == BAR_PTHREAD)
+		{
+			ret = pthread_barrier_wait(&bar);
+			if ((ret != 0) && (ret != PTHREAD_BARRIER_SERIAL_THREAD))
+			{  UNRESOLVED(ret, "Barrier wait failed");  }
+			serial = (ret == PTHREAD_BARRIER_SERIAL_THREAD);
+		}
+		else
+		{
+			serial = cbar_wait(&cbar);
+		}
+
+		depart[i * nthreads + id] = pts_now_ns();
+
+		/* Only the serial thread writes this value, in each phase */
+		if (serial)
+			serials[i]++;
+	}
+
+	return NULL;
+}
+
+void run(int n)
+{
+	int ret, i, j;
+	unsigned long long start, end, last_arr, last_dep, first_dep;
+	pts_hist_t * lat;
+
+	nthreads = n;
+
+	if (kind == BAR_PTHREAD)
+	{
+		ret = pthread_barrier_init(&bar, NULL, n);
+		if (ret != 0)  {  UNRESOLVED(ret, "Barrier init failed");  }
+	}
+	else
+	{
+		cbar.count = n;
+		cbar.n = n;
+		cbar.gen = 0;
+	}
+
+	for (i=0; i<ROUNDS; i++)
+		serials[i] = 0;
+
+	/* The phases are timed from the gate opening to the last departure */
+	ret = pts_bench_run(&gate, n, worker, NULL, 0, 0, &start, NULL);
+	if (ret != 0)  {  UNRESOLVED(ret, "Unable to run the threads");  }
+
+	end = start;
+	for (j=0; j<n; j++)
+		if (depart[(ROUNDS - 1) * n + j] > end)
+			end = depart[(ROUNDS - 1) * n + j];
+
+	if (kind == BAR_PTHREAD)
+	{
+		ret = pthread_barrier_destroy(&bar);
+		if (ret != 0)  {  UNRESOLVED(ret, "Barrier destroy failed");  }
+	}
+
+	lat = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+	if (lat == NULL)  {  UNRESOLVED(errno, "Unable to alloc memory for the histogram");  }
+	pts_hist_init(lat);
+
+	for (i=0; i<ROUNDS; i++)
+	{
+		if (serials[i] != 1)
+		{
+			output("Phase %i had %i serial threads\n", i, serials[i]);
+			FAILED("The serial thread of a barrier phase is not unique");
+		}
+
+		last_arr = 0;
+		last_dep = 0;
+		first_dep = ~0ULL;
+		for (j=0; j<n; j++)
+		{
+			if (arrive[i * n + j] > last_arr)
+				last_arr = arrive[i * n + j];
+			if (depart[i * n + j] > last_dep)
+				last_dep = depart[i * n + j];
+			if (depart[i * n + j] < first_dep)
+				first_dep = depart[i * n + j];
+		}
+
+		if (first_dep < last_arr)
+		{
+			output("Phase %i: a thread left %llu ns before the last arrival\n", i, last_arr - first_dep);
+			FAILED("A thread went through the barrier before all threads arrived");
+		}
+
+		pts_hist_record(lat, last_dep - last_arr);
+	}
+
+	#ifdef PLOT_OUTPUT
+	printf("%i %i %i %.0f %llu %llu %llu\n", kind, pinned, n,
+	       (double) ROUNDS * 1000000000.0 / (double) (end - start),
+	       pts_hist_percentile(lat, 50.0), pts_hist_percentile(lat, 99.0), lat->max);
+	#endif
+	#if VERBOSE > 0
+	output("%-8s %6s %7i %12.0f %10llu %10llu %10llu\n", names[kind], pinned ? "yes" : "no", n,
+	       (double) ROUNDS * 1000000000.0 / (double) (end - start),
+	       pts_hist_percentile(lat, 50.0), pts_hist_percentile(lat, 99.0), lat->max);
+	#endif
+
+	free(lat);
+}
+
+int main(int argc, char * argv[])
+{
+	int ret, max, n, npin;
+
+	output_init();
+
+	max = pts_max_threads(1);
+
+	/* Can we pin the threads? */
+	npin = pts_placement_init();
+
+	arrive = (unsigned long long *) calloc((size_t) ROUNDS * max, sizeof(unsigned long long));
+	depart = (unsigned long long *) calloc((size_t) ROUNDS * max, sizeof(unsigned long long));
+	serials = (volatile int *) calloc(ROUNDS, sizeof(int));
+	if ((arrive == NULL) || (depart == NULL) || (serials == NULL))
+	{  UNRESOLVED(errno, "Unable to alloc memory");  }
+
+	ret = pthread_mutex_init(&cbar.mtx, NULL);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex init failed");  }
+	ret = pthread_cond_init(&cbar.cnd, NULL);
+	if (ret != 0)  {  UNRESOLVED(ret, "Cond init failed");  }
+
+	#ifdef PLOT_OUTPUT
+	printf("# COLUMNS 7 Kind Pinned Threads Phases/s Latency-p50(ns) Latency-p99(ns) Latency-max(ns)\n");
+	#endif
+	#if VERBOSE > 0
+	output("Barrier benchmark: %i phases per case, up to %i threads\n", ROUNDS, max);
+	if (npin == 0)
+		output(" Threads cannot be pinned on this system; only the unpinned cases will run\n");
+	output("%-8s %6s %7s %12s %10s %10s %10s\n", "Barrier", "Pinned", "Threads", "Phases/s",
+	       "Lat-p50", "Lat-p99", "Lat-max");
+	#endif
+
+	for (pinned = 0; pinned <= ((npin > 0) ? 1 : 0); pinned++)
+	{
+		pts_placement = pinned ? PTS_PLACE_COMPACT : PTS_PLACE_NONE;
+		for (kind = BAR_PTHREAD; kind <= BAR_COND; kind++)
+			for (n = 2; n != 0; n = pts_next_count(n, max))
+				run(n);
+	}
+
+	ret = pthread_cond_destroy(&cbar.cnd);
+	if (ret != 0)  {  UNRESOLVED(ret, "Cond destroy failed");  }
+	ret = pthread_mutex_destroy(&cbar.mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex destroy failed");  }
+
+	free((void *) serials);
+	free(arrive);
+	free(depart);
+
+	#if VERBOSE > 0
+	output("pthread_barrier_wait benchmark done.\n");
+	#endif
+
+	PASSED;
+}
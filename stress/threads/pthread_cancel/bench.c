@@ -0,0 +1,356 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+
+
+ * This file is a benchmark for the pthread_cancel function.
+ * It measures how long a canceled thread takes to run its cleanup
+ * handlers and to terminate.
+
+ * The steps are:
+ * -> For each way of waiting for the cancellation:
+ *    -> asynchronous cancelability, in a busy loop;
+ *    -> deferred cancelability, in a busy loop calling pthread_testcancel;
+ *    -> deferred cancelability, blocked in pthread_cond_wait, sem_wait,
+ *       nanosleep or mq_receive;
+ *    and for 1, 16 and 256 cleanup handlers pushed with pthread_cleanup_push,
+ *    -> ROUNDS times, a thread is created, pushes the handlers and waits;
+ *       it is canceled once it is waiting, then joined.
+ * -> For each case we report (p50, p99 and max):
+ *    -> the delay between pthread_cancel and the entry of the first
+ *       cleanup handler;
+ *    -> the delay between pthread_cancel and the return of pthread_join.
+ * -> The test fails if the thread does not terminate with PTHREAD_CANCELED,
+ *    or if its cleanup handlers are not all called once.
+ */
+
+ /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
+ #define _POSIX_C_SOURCE 200112L
+
+/********************************************************************************************/
+/****************************** standard includes *****************************************/
+/********************************************************************************************/
+ #include <pthread.h>
+ #include <errno.h>
+ #include <unistd.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <stdarg.h>
+ #include <time.h>
+ #include <fcntl.h>
+
+ #include <semaphore.h>
+ #include <mqueue.h>
+
+/********************************************************************************************/
+/******************************   Test framework   *****************************************/
+/********************************************************************************************/
+ #include "testfrmw.h"
+ #include "testfrmw.c"
+ #include "pts_bench.h"
+ #include "pts_histogram.h"
+ #include "pts_rendezvous.h"
+ /* testfrmw.h gives UNRESOLVED, FAILED and PASSED, which end the process,
+  * and output(); pts_bench.h gives the clock, start gate and run routines. */
+
+/********************************************************************************************/
+/********************************** Configuration ******************************************/
+/********************************************************************************************/
+#ifndef SCALABILITY_FACTOR
+#define SCALABILITY_FACTOR 1
+#endif
+#ifndef VERBOSE
+#define VERBOSE 1
+#endif
+
+/* # of cancellations for each case */
+#ifndef ROUNDS
+#define ROUNDS (100 * SCALABILITY_FACTOR)
+#endif
+
+#ifdef PLOT_OUTPUT
+#undef VERBOSE
+#define VERBOSE 0
+#endif
+
+/********************************************************************************************/
+/***********************************    Test case   *****************************************/
+/********************************************************************************************/
+
+#define W_ASYNC      0
+#define W_TESTCANCEL 1
+#define W_COND       2
+#define W_SEM        3
+#define W_NANOSLEEP  4
+#define W_MQ         5
+#define NWAITS       6
+char * waits[] = { "async", "testcancel", "cond_wait", "sem_wait", "nanosleep", "mq_receive" };
+
+int handlers[] = { 1, 16, 256 };
+#define NHANDLERS (sizeof(handlers) / sizeof(handlers[0]))
+
+/* The current case */
+int wait_kind;
+int nhandlers;
+
+/* The objects the thread waits on */
+pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cnd = PTHREAD_COND_INITIALIZER;
+sem_t sem;
+mqd_t mq;
+
+/* Posted by the thread when it is about to wait */
+sem_t ready;
+pid_t victim_tid;
+
+/* Updated by the cleanup handlers; the thread is alone to run them */
+int called;
+unsigned long long first_handler;
+volatile unsigned long spins;
+
+/* Never cleared; the waits only end with the cancellation */
+volatile int forever = 1;
+
+void cleanup(void * arg)
+{
+	int ret;
+
+	if (called++ == 0)
+	{
+		first_handler = pts_now_ns();
+
+		/* pthread_cond_wait has locked the mutex again */
+		if (wait_kind == W_COND)
+		{
+			ret = pthread_mutex_unlock(&mtx);
+			if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+		}
+	}
+}
+
+/* Wait for the cancellation */
+void do_wait(void)
+{
+	int ret;
+	struct timespec ts;
+	char buf[64];
+
+	switch (wait_kind)
+	{
+		case W_ASYNC:
+			ret = pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
+			if (ret != 0)  {  UNRESOLVED(ret, "Unable to set the cancel type");  }
+			ret = sem_post(&ready);
+			if (ret != 0)  {  UNRESOLVED(errno, "Failed to post the semaphore");  }
+			while (forever)
+				spins++;
+			break;
+
+		case W_TESTCANCEL:
+			ret = sem_post(&ready);
+			if (ret != 0)  {  UNRESOLVED(errno, "Failed to post the semaphore");  }
+			while (forever)
+			{
+				spins++;
+				pthread_testcancel();
+			}
+			break;
+
+		case W_COND:
+			ret = pthread_mutex_lock(&mtx);
+			if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+			ret = sem_post(&ready);
+			if (ret != 0)  {  UNRESOLVED(errno, "Failed to post the semaphore");  }
+			while (forever)
+			{
+				ret = pthread_cond_wait(&cnd, &mtx);
+				if (ret != 0)  {  UNRESOLVED(ret, "Cond wait failed");  }
+			}
+			break;
+
+		case W_SEM:
+			ret = sem_post(&ready);
+			if (ret != 0)  {  UNRESOLVED(errno, "Failed to post the semaphore");  }
+			while (forever)
+			{
+				ret = sem_wait(&sem);
+				if ((ret != 0) && (errno != EINTR))  {  UNRESOLVED(errno, "Failed to wait for the semaphore");  }
+			}
+			break;
+
+		case W_NANOSLEEP:
+			ret = sem_post(&ready);
+			if (ret != 0)  {  UNRESOLVED(errno, "Failed to post the semaphore");  }
+			while (forever)
+			{
+				ts.tv_sec = 10;
+				ts.tv_nsec = 0;
+				nanosleep(&ts, NULL);
+			}
+			break;
+
+		case W_MQ:
+			ret = sem_post(&ready);
+			if (ret != 0)  {  UNRESOLVED(errno, "Failed to post the semaphore");  }
+			while (forever)
+			{
+				ret = mq_receive(mq, buf, sizeof(buf), NULL);
+				if ((ret == -1) && (errno != EINTR))  {  UNRESOLVED(errno, "Failed to receive a message");  }
+			}
+			break;
+
+		default:
+			UNRESOLVED(wait_kind, "Unknown wait kind");
+	}
+}
+
+/* Push n cleanup handlers, then wait */
+void push(int n)
+{
+	pthread_cleanup_push(cleanup, NULL);
+	if (n > 1)
+		push(n - 1);
+	else
+		do_wait();
+	pthread_cleanup_pop(0);
+}
+
+void * victim(void * arg)
+{
+	victim_tid = pts_gettid();
+	push(nhandlers);
+	return NULL;
+}
+
+void run(void)
+{
+	int ret, i;
+	pthread_t th;
+	void * thret;
+	unsigned long long t0, t1;
+	pts_hist_t * hdl, * join;
+
+	hdl = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+	join = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+	if ((hdl == NULL) || (join == NULL))  {  UNRESOLVED(errno, "Unable to alloc memory for the histograms");  }
+	pts_hist_init(hdl);
+	pts_hist_init(join);
+
+	for (i=0; i<ROUNDS; i++)
+	{
+		called = 0;
+
+		ret = pthread_create(&th, NULL, victim, NULL);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to create a thread");  }
+		do {  ret = sem_wait(&ready);  } while ((ret != 0) && (errno == EINTR));
+		if (ret != 0)  {  UNRESOLVED(errno, "Failed to wait for the semaphore");  }
+
+		/* Let the thread enter the cancellation point: it must be blocked
+		   there, or it would act on the cancel at the entry of the call */
+		switch (wait_kind)
+		{
+			case W_COND:
+			case W_SEM:
+				ret = pts_wait_blocked(victim_tid, 1000);
+				break;
+			case W_NANOSLEEP:
+			case W_MQ:
+				ret = pts_wait_sleeping(victim_tid, 1000);
+				break;
+			default:
+				/* The thread spins; it only has to reach its loop */
+				ret = ENOSYS;
+				break;
+		}
+		if (ret == ENOSYS)
+			pts_sleep_ms(1);
+		else if (ret != 0)  {  UNRESOLVED(ret, "The thread did not block in its wait");  }
+
+		t0 = pts_now_ns();
+		ret = pthread_cancel(th);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to cancel the thread");  }
+		ret = pthread_join(th, &thret);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to join a thread");  }
+		t1 = pts_now_ns();
+
+		if (thret != PTHREAD_CANCELED)  {  FAILED("The thread did not terminate with PTHREAD_CANCELED");  }
+		if (called != nhandlers)
+		{
+			output("%i cleanup handlers called out of %i (%s)\n", called, nhandlers, waits[wait_kind]);
+			FAILED("The cleanup handlers were not all called once");
+		}
+
+		pts_hist_record(hdl, (first_handler > t0) ? first_handler - t0 : 0);
+		pts_hist_record(join, t1 - t0);
+	}
+
+	#ifdef PLOT_OUTPUT
+	printf("%i %i %llu %llu %llu %llu %llu %llu\n", wait_kind, nhandlers,
+	       pts_hist_percentile(hdl, 50.0), pts_hist_percentile(hdl, 99.0), hdl->max,
+	       pts_hist_percentile(join, 50.0), pts_hist_percentile(join, 99.0), join->max);
+	#endif
+	#if VERBOSE > 0
+	output("%-10s %8i %10llu %10llu %10llu %10llu %10llu %10llu\n", waits[wait_kind], nhandlers,
+	       pts_hist_percentile(hdl, 50.0), pts_hist_percentile(hdl, 99.0), hdl->max,
+	       pts_hist_percentile(join, 50.0), pts_hist_percentile(join, 99.0), join->max);
+	#endif
+
+	free(hdl);
+	free(join);
+}
+
+int main(int argc, char * argv[])
+{
+	int ret;
+	unsigned int h;
+	char name[64];
+	struct mq_attr attr;
+
+	output_init();
+
+	ret = sem_init(&ready, 0, 0);
+	if (ret != 0)  {  UNRESOLVED(errno, "Unable to init a semaphore");  }
+	ret = sem_init(&sem, 0, 0);
+	if (ret != 0)  {  UNRESOLVED(errno, "Unable to init a semaphore");  }
+
+	sprintf(name, "/pts_cancel_bench_%d", (int) getpid());
+	attr.mq_flags = 0;
+	attr.mq_maxmsg = 1;
+	attr.mq_msgsize = 64;
+	attr.mq_curmsgs = 0;
+	mq = mq_open(name, O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+	if (mq == (mqd_t) -1)  {  UNRESOLVED(errno, "Unable to open a message queue");  }
+	ret = mq_unlink(name);
+	if (ret != 0)  {  UNRESOLVED(errno, "Unable to unlink the message queue");  }
+
+	#ifdef PLOT_OUTPUT
+	printf("# COLUMNS 8 Wait Handlers Handler-p50(ns) Handler-p99(ns) Handler-max(ns) "
+	       "Join-p50(ns) Join-p99(ns) Join-max(ns)\n");
+	#endif
+	#if VERBOSE > 0
+	output("pthread_cancel benchmark: %i cancellations per case, delays from pthread_cancel (ns)\n", ROUNDS);
+	output("%-10s %8s %10s %10s %10s %10s %10s %10s\n", "Wait", "Handlers",
+	       "Hdl-p50", "Hdl-p99", "Hdl-max", "Join-p50", "Join-p99", "Join-max");
+	#endif
+
+	for (wait_kind = 0; wait_kind < NWAITS; wait_kind++)
+		for (h = 0; h < NHANDLERS; h++)
+		{
+			nhandlers = handlers[h];
+			run();
+		}
+
+	ret = mq_close(mq);
+	if (ret != 0)  {  UNRESOLVED(errno, "Unable to close the message queue");  }
+	ret = sem_destroy(&sem);
+	if (ret != 0)  {  UNRESOLVED(errno, "Unable to destroy a semaphore");  }
+	ret = sem_destroy(&ready);
+	if (ret != 0)  {  UNRESOLVED(errno, "Unable to destroy a semaphore");  }
+
+	#if VERBOSE > 0
+	output("pthread_cancel benchmark done.\n");
+	#endif
+
+	PASSED;
+}
@@ -0,0 +1,372 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+
+
+ * This file is a benchmark for the pthread_cond_signal and
+ * pthread_cond_broadcast functions, with threads waiting in
+ * pthread_cond_timedwait.
+
+ * The steps are:
+ * -> For each clock of the condition variable (default, and MONOTONIC
+ *    set with pthread_condattr_setclock when supported),
+ *    and for 1, 2, 4, ... NWAITERS waiting threads:
+ *    -> ROUNDS times: once every thread is waiting, post one work item
+ *       and call pthread_cond_signal. We measure the delay until a
+ *       waiter owns the mutex again (signal-to-wakeup latency).
+ *    -> ROUNDS times: once every thread is waiting, post one work item
+ *       and call pthread_cond_broadcast. We measure the delay until all
+ *       waiters have owned the mutex again (broadcast completion time).
+ *       Only one of them finds the work item (thundering herd).
+ * -> For each case we report the latency percentiles, and the # of
+ *    wakeups which found no work per round (spurious wakeups included).
+ */
+
+ /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
+ #define _POSIX_C_SOURCE 200112L
+
+/********************************************************************************************/
+/****************************** standard includes *****************************************/
+/********************************************************************************************/
+ #include <pthread.h>
+ #include <errno.h>
+ #include <unistd.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <stdarg.h>
+ #include <time.h>
+
+/********************************************************************************************/
+/******************************   Test framework   *****************************************/
+/********************************************************************************************/
+ #include "testfrmw.h"
+ #include "testfrmw.c"
+ #include "pts_bench.h"
+ #include "pts_histogram.h"
+ /* testfrmw.h gives UNRESOLVED, FAILED and PASSED, which end the process,
+  * and output(); pts_bench.h gives the clock, start gate and run routines. */
+
+/********************************************************************************************/
+/********************************** Configuration ******************************************/
+/********************************************************************************************/
+#ifndef SCALABILITY_FACTOR
+#define SCALABILITY_FACTOR 1
+#endif
+#ifndef VERBOSE
+#define VERBOSE 1
+#endif
+
+/* # of signal and of broadcast rounds for each case */
+#ifndef ROUNDS
+#define ROUNDS (500 * SCALABILITY_FACTOR)
+#endif
+
+/* Maximum # of waiting threads */
+#ifndef NWAITERS
+#define NWAITERS (64 * SCALABILITY_FACTOR)
+#endif
+
+#ifndef WITHOUT_ALTCLK
+#define USE_ALTCLK  /* make tests with MONOTONIC CLOCK if supported */
+#endif
+
+#ifdef PLOT_OUTPUT
+#undef VERBOSE
+#define VERBOSE 0
+#endif
+
+/********************************************************************************************/
+/***********************************    Test case   *****************************************/
+/********************************************************************************************/
+
+/* The waiters wait for this long before reporting a lost wakeup */
+#define WAIT_TIMEOUT 60 /* seconds */
+
+/* The data shared by the main thread and the waiters; all fields are protected by mtx */
+struct
+{
+	pthread_mutex_t mtx;
+	pthread_cond_t cnd;     /* the waiters wait on this one */
+	pthread_cond_t cnd_main;/* the main thread waits on this one */
+	clockid_t cid;          /* clock of cnd */
+	int nwaiters;           /* # of threads of this case */
+	int waiting;            /* # of threads currently in pthread_cond_timedwait */
+	int gen;                /* incremented on each signal / broadcast */
+	int work;               /* # of work items */
+	int woken;              /* # of waiters which saw the current generation */
+	int target;             /* # of waiters to be woken in the current round */
+	int stop;
+	unsigned long long posted;   /* time of the signal / broadcast */
+	unsigned long long empty;    /* # of wakeups which found no work */
+	pts_hist_t * wake;           /* signal-to-wakeup latencies */
+	pts_hist_t * complete;       /* broadcast completion times */
+	int broadcast;               /* !0 during the broadcast rounds */
+} data;
+
+void * waiter(void * arg)
+{
+	int ret, mygen;
+	struct timespec ts;
+	unsigned long long now;
+
+	ret = pthread_mutex_lock(&data.mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed in waiter");  }
+
+	mygen = data.gen;
+
+	while (!data.stop)
+	{
+		ret = clock_gettime(data.cid, &ts);
+		if (ret != 0)  {  UNRESOLVED(errno, "Unable to read clock");  }
+		ts.tv_sec += WAIT_TIMEOUT;
+
+		data.waiting++;
+		if (data.waiting == data.nwaiters)
+		{
+			ret = pthread_cond_signal(&data.cnd_main);
+			if (ret != 0)  {  UNRESOLVED(ret, "Failed to signal the main thread");  }
+		}
+
+		ret = pthread_cond_timedwait(&data.cnd, &data.mtx, &ts);
+		now = pts_now_ns();
+		data.waiting--;
+
+		if (ret == ETIMEDOUT)
+		{  FAILED("A waiter was not woken up by the signal or broadcast");  }
+		if (ret != 0)  {  UNRESOLVED(ret, "Cond timedwait failed");  }
+
+		if (data.gen == mygen)
+		{
+			/* Spurious wakeup */
+			data.empty++;
+			continue;
+		}
+		mygen = data.gen;
+
+		if (data.stop)
+			break;
+
+		if (data.work > 0)
+		{
+			data.work--;
+			if (!data.broadcast)
+				pts_hist_record(data.wake, now - data.posted);
+		}
+		else
+		{
+			data.empty++;
+		}
+
+		data.woken++;
+		if (data.broadcast && (data.woken == data.nwaiters))
+			pts_hist_record(data.complete, now - data.posted);
+	}
+
+	ret = pthread_mutex_unlock(&data.mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed in waiter");  }
+
+	return NULL;
+}
+
+/* Wait until the current round is over and every waiter is back in
+ * pthread_cond_timedwait. Called with mtx locked */
+void wait_all(void)
+{
+	int ret;
+
+	while ((data.woken < data.target) || (data.waiting < data.nwaiters))
+	{
+		ret = pthread_cond_wait(&data.cnd_main, &data.mtx);
+		if (ret != 0)  {  UNRESOLVED(ret, "Cond wait failed in main thread");  }
+	}
+}
+
+/* Post one work item once every waiter is waiting */
+void post(int broadcast)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(&data.mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+
+	wait_all();
+
+	data.broadcast = broadcast;
+	data.work = 1;
+	data.woken = 0;
+	data.target = broadcast ? data.nwaiters : 1;
+	data.gen++;
+	data.posted = pts_now_ns();
+
+	if (broadcast)
+		ret = pthread_cond_broadcast(&data.cnd);
+	else
+		ret = pthread_cond_signal(&data.cnd);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to signal or broadcast the condition");  }
+
+	ret = pthread_mutex_unlock(&data.mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+}
+
+void run(int altclk, int n, pthread_t * th)
+{
+	int ret, i;
+	pthread_condattr_t ca;
+	unsigned long long sig_empty, bc_empty;
+
+	ret = pthread_condattr_init(&ca);
+	if (ret != 0)  {  UNRESOLVED(ret, "Unable to initialize cond attribute object");  }
+
+	data.cid = CLOCK_REALTIME;
+	#ifdef USE_ALTCLK
+	if (altclk)
+	{
+		ret = pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to set the clock of the condition");  }
+		data.cid = CLOCK_MONOTONIC;
+	}
+	#endif
+
+	ret = pthread_cond_init(&data.cnd, &ca);
+	if (ret != 0)  {  UNRESOLVED(ret, "Cond init failed");  }
+
+	ret = pthread_condattr_destroy(&ca);
+	if (ret != 0)  {  UNRESOLVED(ret, "Unable to destroy cond attribute object");  }
+
+	data.nwaiters = n;
+	data.waiting = 0;
+	data.gen = 0;
+	data.work = 0;
+	data.woken = 0;
+	data.target = 0;
+	data.stop = 0;
+	data.empty = 0;
+	pts_hist_init(data.wake);
+	pts_hist_init(data.complete);
+
+	for (i=0; i<n; i++)
+	{
+		ret = pthread_create(&th[i], NULL, waiter, NULL);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to create a waiter thread");  }
+	}
+
+	for (i=0; i<ROUNDS; i++)
+		post(0);
+
+	ret = pthread_mutex_lock(&data.mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+	wait_all();
+	sig_empty = data.empty;
+	ret = pthread_mutex_unlock(&data.mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+
+	for (i=0; i<ROUNDS; i++)
+		post(1);
+
+	/* Stop the waiters */
+	ret = pthread_mutex_lock(&data.mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+	wait_all();
+	bc_empty = data.empty - sig_empty;
+	data.stop = 1;
+	data.gen++;
+	ret = pthread_cond_broadcast(&data.cnd);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to broadcast the condition");  }
+	ret = pthread_mutex_unlock(&data.mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+
+	for (i=0; i<n; i++)
+	{
+		ret = pthread_join(th[i], NULL);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to join a thread");  }
+	}
+
+	ret = pthread_cond_destroy(&data.cnd);
+	if (ret != 0)  {  UNRESOLVED(ret, "Cond destroy failed");  }
+
+	#ifdef PLOT_OUTPUT
+	printf("%i %i %llu %llu %llu %.2f %llu %llu %llu %.2f\n", altclk, n,
+	       pts_hist_percentile(data.wake, 50.0),
+	       pts_hist_percentile(data.wake, 99.0),
+	       data.wake->max,
+	       (double) sig_empty / ROUNDS,
+	       pts_hist_percentile(data.complete, 50.0),
+	       pts_hist_percentile(data.complete, 99.0),
+	       data.complete->max,
+	       (double) bc_empty / ROUNDS);
+	#endif
+	#if VERBOSE > 0
+	output("%-9s %7i | %9llu %9llu %9llu %6.2f | %9llu %9llu %9llu %7.2f\n",
+	       altclk ? "Monotonic" : "Default", n,
+	       pts_hist_percentile(data.wake, 50.0),
+	       pts_hist_percentile(data.wake, 99.0),
+	       data.wake->max,
+	       (double) sig_empty / ROUNDS,
+	       pts_hist_percentile(data.complete, 50.0),
+	       pts_hist_percentile(data.complete, 99.0),
+	       data.complete->max,
+	       (double) bc_empty / ROUNDS);
+	#endif
+}
+
+int main(int argc, char * argv[])
+{
+	int ret, n, altclk;
+	long altclk_ok;
+	pthread_t * th;
+
+	output_init();
+
+	/* Test machine capabilities */
+	altclk_ok = sysconf(_SC_CLOCK_SELECTION);
+	if (altclk_ok > 0)
+		altclk_ok = sysconf(_SC_MONOTONIC_CLOCK);
+	#ifndef USE_ALTCLK
+	if (altclk_ok > 0)
+		output("Implementation supports the MONOTONIC CLOCK but option is disabled in test.\n");
+	altclk_ok = 0;
+	#endif
+
+	th = (pthread_t *) calloc(NWAITERS, sizeof(pthread_t));
+	data.wake = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+	data.complete = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+	if ((th == NULL) || (data.wake == NULL) || (data.complete == NULL))
+	{  UNRESOLVED(errno, "Unable to alloc memory");  }
+
+	ret = pthread_mutex_init(&data.mtx, NULL);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex init failed");  }
+	ret = pthread_cond_init(&data.cnd_main, NULL);
+	if (ret != 0)  {  UNRESOLVED(ret, "Cond init failed");  }
+
+	#ifdef PLOT_OUTPUT
+	printf("# COLUMNS 10 Monotonic Waiters Signal-p50(ns) Signal-p99(ns) Signal-max(ns) Signal-empty"
+	       " Broadcast-p50(ns) Broadcast-p99(ns) Broadcast-max(ns) Broadcast-empty\n");
+	#endif
+	#if VERBOSE > 0
+	output("Condvar benchmark: %i rounds per case, up to %i waiters\n", ROUNDS, NWAITERS);
+	output(" Alternative clock for cond %s be tested\n", (altclk_ok>0)?"will":"won't");
+	output("%-9s %7s | %9s %9s %9s %6s | %9s %9s %9s %7s\n", "Clock", "Waiters",
+	       "Sig-p50", "Sig-p99", "Sig-max", "Empty",
+	       "Bc-p50", "Bc-p99", "Bc-max", "Empty");
+	#endif
+
+	for (altclk = 0; altclk <= ((altclk_ok > 0) ? 1 : 0); altclk++)
+		for (n = 1; n != 0; n = pts_next_count(n, NWAITERS))
+			run(altclk, n, th);
+
+	ret = pthread_cond_destroy(&data.cnd_main);
+	if (ret != 0)  {  UNRESOLVED(ret, "Cond destroy failed");  }
+	ret = pthread_mutex_destroy(&data.mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex destroy failed");  }
+
+	free(data.wake);
+	free(data.complete);
+	free(th);
+
+	#if VERBOSE > 0
+	output("pthread_cond_signal / broadcast benchmark done.\n");
+	#endif
+
+	PASSED;
+}
@@ -35,6 +35,11 @@
 
  /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
  #define _POSIX_C_SOURCE 200112L
+
+ /* CPU placement (see pts_placement.h) uses the Linux affinity API */
+#ifdef PLACEMENT_SWEEP
+ #define _GNU_SOURCE
+#endif
  
  #ifndef WITHOUT_XOPEN
  #define _XOPEN_SOURCE 600
@@ -58,6 +63,9 @@
 /********************************************************************************************/
  #include "testfrmw.h"
  #include "testfrmw.c"
+ #include "pts_placement.h"
+ #include "pts_scalability.h"
+ #include "pts_histogram.h"
  /* This header is responsible for defining the following macros:
   * UNRESOLVED(ret, descr);  
   *    where descr is a description of the error and ret is an int (error code for example)
@@ -113,6 +121,10 @@ typedef struct
 	int * tnum;
 } test_t;
 
+/* Numbering of the waiters for the CPU placement */
+pthread_mutex_t place_mtx = PTHREAD_MUTEX_INITIALIZER;
+int nplaced;
+
 struct {
 	int mutex_type;
 	int pshared;
@@ -147,6 +159,9 @@ struct {
 
 pthread_attr_t  ta;
 
+/* The wakeup delays past the timeout, for each scenario */
+pts_hist_t lat[ NSCENAR ];
+
 /* The next structure is used to save the tests measures */
 typedef struct __mes_t
 {
@@ -218,7 +233,17 @@ void * waiter(void * arg)
 {
 	test_t * dt = (test_t *) arg;
 	
-	int ret;
+	int ret, idx;
+	
+	/* Pin this thread according to the CPU placement, before it uses the mutex */
+	ret = pthread_mutex_lock(&place_mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed in waiter");  }
+	idx = ++nplaced;
+	ret = pthread_mutex_unlock(&place_mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed in waiter");  }
+	
+	ret = pts_place_thread(idx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Unable to place the thread");  }
 	
 	ret = pthread_mutex_lock(dt->mtx);
 	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed in waiter");  }
@@ -336,6 +361,7 @@ long do_threads_test( int nthreads, mes_t * measure )
 			
 			predicate = 0;
 			tnum = 0;
+			nplaced = 0;
 			
 			/* Create the waiter threads */
 			for (i=0; i< nthreads; i++)
@@ -396,6 +422,7 @@ long do_threads_test( int nthreads, mes_t * measure )
 			#endif
 			
 			do_measure(&mtx, &cnd, test_scenar[s].cid, &ts);
+			pts_hist_record(&lat[s], ts.tv_sec * 1000000000ULL + ts.tv_nsec);
 			
 			#if VERBOSE > 5
 			output("Measure for %s returned %d.%09d\n", test_scenar[s].desc, ts.tv_sec, ts.tv_nsec);
@@ -483,6 +510,11 @@ int main (int argc, char *argv[])
 	
 	/* Initialize the output */
 	output_init();
+
+#ifdef PLACEMENT_SWEEP
+	/* Run the following once per CPU placement */
+	pts_placement_sweep();
+#endif
 	
 	/* Test machine capabilities */
 	/* -> clockid_t; pshared; ... */
@@ -510,6 +542,9 @@ int main (int argc, char *argv[])
 	if (ret != 0)
 	{  UNRESOLVED(ret, "Unable to set stack size to minimum value");  }
 	
+	for (nth=0; nth<NSCENAR; nth++)
+		pts_hist_init(&lat[nth]);
+	
 	#ifdef PLOT_OUTPUT
 	output("# COLUMNS %d #threads", NSCENAR + 1);
 	for (nth=0; nth<NSCENAR; nth++) 
@@ -550,6 +585,13 @@ int main (int argc, char *argv[])
 	
 	ret = parse_measure(&sentinel);
 	
+	#if VERBOSE > 0
+	output("-----\n");
+	for (nth=0; nth<NSCENAR; nth++)
+		if (lat[nth].count != 0)
+			pts_hist_report(test_scenar[nth].desc, &lat[nth]);
+	#endif
+	
 	/* Free the memory from the list */
 	m_cur = sentinel.next;
 	while (m_cur != NULL)
@@ -574,253 +616,57 @@ int main (int argc, char *argv[])
 
 
 /***
- * The next function will seek for the better model for each series of measurements.
- *
- * The tested models are: -- X = # threads; Y = latency
- * -> Y = a;      -- Error is r1 = avg( (Y - Yavg)² );
- * -> Y = aX + b; -- Error is r2 = avg( (Y -aX -b)² );
- *                -- where a = avg ( (X - Xavg)(Y - Yavg) ) / avg( ( X - Xavg)² )
- *                --         Note: We will call _q = sum( (X - Xavg) * (Y - Yavg) ); 
- *                --                       and  _d = sum( (X - Xavg)² );
- *                -- and   b = Yavg - a * Xavg
- * -> Y = c * X^a;-- Same as previous, but with log(Y) = a log(X) + b; and b = log(c). Error is r3
- * -> Y = exp(aX + b); -- log(Y) = aX + b. Error is r4
- *
- * We compute each error factor (r1, r2, r3, r4) then search which is the smallest (with ponderation).
- * The function returns 0 when r1 is the best for all cases (latency is constant) and !0 otherwise.
+ * The next function will seek for the better model for each series of measurements
+ * (see pts_scalability.h for the models and the verdict).
+ * The function returns 0 when the latency is constant for all cases and !0 otherwise.
  */
 
-struct row
-{
-	long X;  /* the X values -- copied from function argument */
-	long Y[NSCENAR];  /* the Y values -- copied from function argument */
-	long _x; /* Value X - Xavg */
-	long _y[NSCENAR]; /* Value Y - Yavg */
-	double LnX; /* Natural logarithm of X values */
-	double LnY[NSCENAR]; /* Natural logarithm of Y values */
-	double _lnx; /* Value LnX - LnXavg */
-	double _lny[NSCENAR]; /* Value LnY - LnYavg */
-};
-
 int parse_measure(mes_t * measures)
 {
-	int ret, i, r;
+	int ret, i, err;
 	
 	mes_t *cur;
 	
-	double Xavg, Yavg[NSCENAR];
-	double LnXavg, LnYavg[NSCENAR];
-	
-	int N; 
-	
-	double r1[NSCENAR], r2[NSCENAR], r3[NSCENAR], r4[NSCENAR];
-	
-	/* Some more intermediate vars */
-	long double _q[3][NSCENAR];
-	long double _d[3][NSCENAR];
-	
-	long double t; /* temp value */
+	pts_serie_t series[NSCENAR];
+	pts_fit_t fit;
 	
-	struct row *Table = NULL;
-	
-	/* Initialize the datas */
-	Xavg = 0.0;
-	LnXavg = 0.0;
-	for (i=0; i<NSCENAR; i++)
-	{
-		Yavg[i] = 0.0;
-		LnYavg[i] = 0.0;
-		r1[i] = 0.0;
-		r2[i] = 0.0;
-		r3[i] = 0.0;
-		r4[i] = 0.0;
-		_q[0][i]=0.0;
-		_q[1][i]=0.0;
-		_q[2][i]=0.0;
-		_d[0][i]=0.0;
-		_d[1][i]=0.0;
-		_d[2][i]=0.0;
-	}
-	N=0;
-	cur = measures;
+	memset(series, 0, sizeof(series));
 	
 	#if VERBOSE > 1
 	output("Data analysis starting\n");
 	#endif
 	
-	/* We start with reading the list to find:
-	 * -> number of elements, to assign an array
-	 * -> average values 
-	 */
-	while (cur->next != NULL)
+	for (cur = measures->next; cur != NULL; cur = cur->next)
 	{
-		cur = cur->next;
-		
-		N++;
-		
-		Xavg += (double) cur->nthreads;
-		LnXavg += log( (double) cur->nthreads);
-		
 		for (i=0; i<NSCENAR; i++)
 		{
-			Yavg[i] += (double) cur->_data[i];
-			LnYavg[i] += log( (double) cur->_data[i] );
-		}
-	}
-	
-	/* We have the sum; we can divide to obtain the average values */
-	Xavg /= N;
-	LnXavg /= N;
-	
-	for (i=0; i<NSCENAR; i++)
-	{
-		Yavg[i] /= N;
-		LnYavg[i] /= N;
-	}
-	
-	#if VERBOSE > 1
-	output(" Found %d rows and %d columns\n", N, NSCENAR);
-	#endif
-	
-	
-	/* We will now alloc the array ... */
-	Table = calloc(N, sizeof( struct row ));
-	if (Table == NULL)  {  UNRESOLVED(errno, "Unable to alloc space for results parsing");  }
-	
-	/* ... and fill it */
-	N = 0;
-	cur = measures;
-	
-	while (cur->next != NULL)
-	{
-		cur = cur->next;
-		
-		Table[N].X = (long) cur->nthreads;
-		Table[N]._x = Table[N].X - Xavg ;
-		Table[N].LnX = log((double) cur->nthreads);
-		Table[N]._lnx = Table[N].LnX - LnXavg;
-		for (i=0; i<NSCENAR; i++)
-		{
-			Table[N].Y[i] = cur->_data[i];
-			Table[N]._y[i] = Table[N].Y[i] - Yavg[i] ;
-			Table[N].LnY[i] = log((double) cur->_data[i]);
-			Table[N]._lny[i] = Table[N].LnY[i] - LnYavg[i];
-		}
-		
-		N++;
-	}
-	
-	/* We won't need the list anymore -- we'll work with the array which should be faster. */
-	#if VERBOSE > 1
-	output(" Data was stored in an array.\n");
-	#endif
-	
-	/* We need to read the full array at least twice to compute all the error factors */
-	
-	/* In the first pass, we'll compute:
-	 * -> r1 for each scenar.
-	 * -> "a" factor for linear (0), power (1) and exponential (2) approximations -- with using the _d and _q vars.
-	 */
-	#if VERBOSE > 1
-	output("Starting first pass...\n");
-	#endif
-	for (r=0; r<N; r++)
-	{
-		for (i=0; i<NSCENAR; i++)
-		{
-			r1[i] += ((double)Table[r]._y[i] / N) * (double)Table[r]._y[i];
-			
-			_q[0][i] += Table[r]._y[i] * Table[r]._x;
-			_d[0][i] += Table[r]._x * Table[r]._x;
-			
-			_q[1][i] += Table[r]._lny[i] * Table[r]._lnx;
-			_d[1][i] += Table[r]._lnx * Table[r]._lnx;
-			
-			_q[2][i] += Table[r]._lny[i] * Table[r]._x;
-			_d[2][i] += Table[r]._x * Table[r]._x;
+			if (cur->_data[i] != 0)
+			{
+				err = pts_serie_add(&series[i], (double) cur->nthreads, (double) cur->_data[i]);
+				if (err != 0)  {  UNRESOLVED(err, "Unable to alloc space for results parsing");  }
+			}
 		}
 	}
 	
-	/* First pass is terminated; a2 = _q[0]/_d[0]; a3 = _q[1]/_d[1]; a4 = _q[2]/_d[2] */
-
-	/* In the first pass, we'll compute:
-	 * -> r2, r3, r4 for each scenar.
-	 */
-	
-	#if VERBOSE > 1
-	output("Starting second pass...\n");
-	#endif
-	for (r=0; r<N; r++)
-	{
-		for (i=0; i<NSCENAR; i++)
-		{
-			/* r2 = avg((y - ax -b)²);  t = (y - ax - b) = (y - yavg) - a (x - xavg); */
-			t = ( Table[r]._y[i] - ((_q[0][i] * Table[r]._x) / _d[0][i]));
-			r2[i] += t * t / N  ;
-			
-			/* r3 = avg(( y - c.x^a) ²);  
-			    t = y - c * x ^ a 
-			      = y - log (LnYavg - (_q[1]/_d[1]) * LnXavg) * x ^ (_q[1]/_d[1])
-			*/
-			t = (   Table[r].Y[i]
-			      - ( logl ( LnYavg[i] - (_q[1][i] / _d[1][i] ) * LnXavg)
-			        * powl( Table[r].X,  (_q[1][i] / _d[1][i] ))
-			    )   );
-			r3[i] += t * t / N  ;
-			
-			/* r4 = avg(( y - exp(ax+b))²);
-			    t = y - exp(ax+b)
-			      = y - exp( _q[2]/_d[2] * x + ( LnYavg - (_q[2]/_d[2] * Xavg) ));
-			      = y - exp( _q[2]/_d[2] * (x - Xavg) + LnYavg );
-			*/
-			t = (   Table[r].Y[i]
-			      - expl( ( _q[2][i] / _d[2][i] ) * Table[r]._x + LnYavg[i] ) );
-			r4[i] += t * t / N  ;
-			
-		}
-	}
-
-	#if VERBOSE > 1
-	output("All computing terminated.\n");
-	#endif
 	ret = 0;
 	for (i=0; i<NSCENAR; i++)
 	{
-		#if VERBOSE > 1
-		output("\nScenario: %s\n", test_scenar[i].desc);
-		
-		output("  Model: Y = k\n");
-		output("       k = %g\n", Yavg[i]);
-		output("    Divergence %g\n", r1[i]);
-		
-		output("  Model: Y = a * X + b\n");
-		output("       a = %Lg\n", _q[0][i] / _d[0][i]);
-		output("       b = %Lg\n", Yavg[i] - ((_q[0][i] / _d[0][i]) * Xavg));
-		output("    Divergence %g\n", r2[i]);
+		if (series[i].n == 0)
+			continue;
 		
-		output("  Model: Y = c * X ^ a\n");
-		output("       a = %Lg\n", _q[1][i] / _d[1][i]);
-		output("       c = %Lg\n", logl ( LnYavg[i] - (_q[1][i] / _d[1][i] ) * LnXavg));
-		output("    Divergence %g\n", r2[i]);
+		err = pts_scal_fit(&series[i], &fit);
+		if (err != 0)  {  UNRESOLVED(err, "Unable to alloc space for results parsing");  }
 		
-		output("  Model: Y = exp(a * X + b)\n");
-		output("       a = %Lg\n", _q[2][i] / _d[2][i]);
-		output("       b = %Lg\n", LnYavg[i] - ((_q[2][i] / _d[2][i]) * Xavg));
-		output("    Divergence %g\n", r2[i]);
-		#endif
-		/* Compare r1 to other values, with some ponderations */
-		if ((r1[i] > 1.1 * r2[i]) || (r1[i] > 1.2 * r3[i]) || (r1[i] > 1.3 * r4[i]))
-			ret++;
 		#if VERBOSE > 1
-		else
-			output(" Sanction: OK\n");
+		pts_scal_report(test_scenar[i].desc, &fit);
 		#endif
+		
+		if (fit.grows)
+			ret++;
+		
+		pts_serie_free(&series[i]);
 	}
 	
-	/* We need to free the array */
-	free(Table);
-	
 	/* We're done */
 	return ret;
 }
-
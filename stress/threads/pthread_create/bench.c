@@ -0,0 +1,422 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+
+
+ * This file is a benchmark for the pthread_create function.
+ * It measures the thread churn throughput and the memory cost of a thread.
+
+ * The steps are:
+ * -> For each scenario of threads_scenarii.c:
+ *    -> Churn: during DURATION ms, create a thread and wait for its
+ *       end (pthread_join, or a semaphore for the detached threads),
+ *       one thread at a time.
+ *    -> Footprint: create NFOOT threads which block until released, and
+ *       read the memory of the process before and after, from /proc/self.
+ *       The threads of the scenarii with an alternative stack each get
+ *       their own stack of _SC_THREAD_STACK_MIN bytes (pthread_attr_setstack).
+ * -> The detached threads with an alternative stack are skipped: we cannot
+ *    know when such a thread stops using its stack.
+ * -> For each scenario we report:
+ *    -> the # of create + join per second, and the mean duration of one;
+ *    -> the resident memory (RSS), the virtual memory and the # of memory
+ *       mappings (VMA) added by each thread.
+ * -> The scenarii where the thread creation fails (e.g. because of the
+ *    user privileges) are reported as such.
+ * -> The memory figures are -1 if /proc/self is not available.
+ *    The alternative stacks are allocated before the first reading, so
+ *    only the memory added by the implementation is counted. The
+ *    implementation may also keep the stacks of the terminated threads
+ *    in a cache: a scenario which reuses them shows a lower footprint.
+ */
+
+ /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
+ #define _POSIX_C_SOURCE 200112L
+
+ /* Some routines are part of the XSI Extensions */
+#ifndef WITHOUT_XOPEN
+ #define _XOPEN_SOURCE	600
+#endif
+
+/********************************************************************************************/
+/****************************** standard includes *****************************************/
+/********************************************************************************************/
+ #include <pthread.h>
+ #include <stdarg.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <string.h>
+ #include <unistd.h>
+
+ #include <sched.h>
+ #include <semaphore.h>
+ #include <errno.h>
+
+/********************************************************************************************/
+/******************************   Test framework   *****************************************/
+/********************************************************************************************/
+ #include "testfrmw.h"
+ #include "testfrmw.c"
+ #include "pts_bench.h"
+ /* testfrmw.h gives UNRESOLVED, FAILED and PASSED, which end the process,
+  * and output(); pts_bench.h gives the clock, start gate and run routines. */
+
+/********************************************************************************************/
+/********************************** Configuration ******************************************/
+/********************************************************************************************/
+#ifndef SCALABILITY_FACTOR
+#define SCALABILITY_FACTOR 1
+#endif
+#ifndef VERBOSE
+#define VERBOSE 1
+#endif
+
+/* Duration of the churn for each scenario, in ms */
+#ifndef DURATION
+#define DURATION (200 * SCALABILITY_FACTOR)
+#endif
+
+/* # of threads alive at once for the footprint */
+#ifndef NFOOT
+#define NFOOT (100 * SCALABILITY_FACTOR)
+#endif
+
+#ifdef PLOT_OUTPUT
+#undef VERBOSE
+#define VERBOSE 0
+#endif
+
+/********************************************************************************************/
+/***********************************    Test cases  *****************************************/
+/********************************************************************************************/
+
+#include "threads_scenarii.c"
+
+/* This file will define the following objects:
+ * scenarii: array of struct __scenario type.
+ * NSCENAR : macro giving the total # of scenarii
+ * scenar_init(): function to call before use the scenarii array.
+ * scenar_fini(): function to call after end of use of the scenarii array.
+ */
+
+/********************************************************************************************/
+/***********************************    Real Test   *****************************************/
+/********************************************************************************************/
+
+/* The footprint threads wait for this */
+pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cnd = PTHREAD_COND_INITIALIZER;
+int nready;
+int release;
+
+/* The memory of the process */
+typedef struct
+{
+	long rss;   /* KB */
+	long vsz;   /* KB */
+	long vmas;
+} mem_t;
+
+void mem_read(mem_t * m)
+{
+	FILE * f;
+	long size, resident, kb;
+	int c;
+
+	m->rss = m->vsz = m->vmas = -1;
+	kb = sysconf(_SC_PAGESIZE) / 1024;
+
+	f = fopen("/proc/self/statm", "r");
+	if (f == NULL)
+		return;
+	if (fscanf(f, "%li %li", &size, &resident) == 2)
+	{
+		m->vsz = size * kb;
+		m->rss = resident * kb;
+	}
+	fclose(f);
+
+	f = fopen("/proc/self/maps", "r");
+	if (f == NULL)
+		return;
+	m->vmas = 0;
+	while ((c = fgetc(f)) != EOF)
+		if (c == '\n')
+			m->vmas++;
+	fclose(f);
+}
+
+/* arg is NULL for the churn, non NULL for the footprint */
+void * threaded(void * arg)
+{
+	int ret;
+
+	if (arg != NULL)
+	{
+		ret = pthread_mutex_lock(&mtx);
+		if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+		nready++;
+		ret = pthread_cond_broadcast(&cnd);
+		if (ret != 0)  {  UNRESOLVED(ret, "Failed to broadcast the condition");  }
+		while (!release)
+		{
+			ret = pthread_cond_wait(&cnd, &mtx);
+			if (ret != 0)  {  UNRESOLVED(ret, "Cond wait failed");  }
+		}
+		ret = pthread_mutex_unlock(&mtx);
+		if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+	}
+
+	if (scenarii[sc].detached != 0)
+	{
+		ret = sem_post(&scenarii[sc].sem);
+		if (ret == -1)  {  UNRESOLVED(errno, "Failed to post the semaphore");  }
+	}
+
+	return NULL;
+}
+
+/* Wait for the end of a thread of the current scenario */
+void wait_thread(pthread_t th)
+{
+	int ret;
+
+	if (scenarii[sc].detached == 0)
+	{
+		ret = pthread_join(th, NULL);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to join a thread");  }
+	}
+	else
+	{
+		do { ret = sem_wait(&scenarii[sc].sem); }
+		while ((ret == -1) && (errno == EINTR));
+		if (ret == -1)  {  UNRESOLVED(errno, "Failed to wait for the semaphore");  }
+	}
+}
+
+/* Returns the # of create + join done, or minus the error code if the creation fails */
+long churn(unsigned long long * elapsed)
+{
+	int ret;
+	long n = 0;
+	pthread_t th;
+	unsigned long long start, end;
+
+	start = pts_now_ns();
+	end = start + DURATION * 1000000ULL;
+	do
+	{
+		ret = pthread_create(&th, &scenarii[sc].ta, threaded, NULL);
+		if (ret != 0)
+			return -ret;
+		wait_thread(th);
+		n++;
+	}
+	while (pts_now_ns() < end);
+
+	*elapsed = pts_now_ns() - start;
+	return n;
+}
+
+/* Give dst the attributes of src, but for the stack */
+void copy_attr(pthread_attr_t * dst, pthread_attr_t * src)
+{
+	int ret, val;
+	struct sched_param sp;
+	#ifndef WITHOUT_XOPEN
+	size_t guard;
+	#endif
+
+	ret = pthread_attr_getdetachstate(src, &val);
+	if (ret == 0)  {  ret = pthread_attr_setdetachstate(dst, val);  }
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to copy the detach state");  }
+
+	ret = pthread_attr_getinheritsched(src, &val);
+	if (ret == 0)  {  ret = pthread_attr_setinheritsched(dst, val);  }
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to copy the sched inheritance");  }
+
+	ret = pthread_attr_getschedpolicy(src, &val);
+	if (ret == 0)  {  ret = pthread_attr_setschedpolicy(dst, val);  }
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to copy the sched policy");  }
+
+	ret = pthread_attr_getschedparam(src, &sp);
+	if (ret == 0)  {  ret = pthread_attr_setschedparam(dst, &sp);  }
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to copy the sched param");  }
+
+	ret = pthread_attr_getscope(src, &val);
+	if (ret == 0)  {  ret = pthread_attr_setscope(dst, val);  }
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to copy the contention scope");  }
+
+	#ifndef WITHOUT_XOPEN
+	ret = pthread_attr_getguardsize(src, &guard);
+	if (ret == 0)  {  ret = pthread_attr_setguardsize(dst, guard);  }
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to copy the guard size");  }
+	#endif
+}
+
+/* Returns the # of threads created at once (NFOOT unless a creation failed) */
+int footprint(mem_t * before, mem_t * after)
+{
+	int ret, i, n;
+	pthread_t * th;
+	pthread_attr_t * ta;
+	pthread_attr_t * own = NULL;
+	void ** stacks = NULL;
+	void * addr;
+	size_t stacksize;
+	long pagesize;
+
+	th = (pthread_t *) calloc(NFOOT, sizeof(pthread_t));
+	if (th == NULL)  {  UNRESOLVED(errno, "Unable to alloc memory for the threads");  }
+
+	/* The threads cannot share the alternative stack of the scenario:
+	 * each one gets the other attributes of the scenario, and its own
+	 * page aligned stack of the same size */
+	if (scenarii[sc].bottom != NULL)
+	{
+		pagesize = sysconf(_SC_PAGESIZE);
+		ret = pthread_attr_getstack(&scenarii[sc].ta, &addr, &stacksize);
+		if (ret != 0)  {  UNRESOLVED(ret, "Failed to read the alternate stack");  }
+		stacksize = ((stacksize + pagesize - 1) / pagesize) * pagesize;
+		own = (pthread_attr_t *) calloc(NFOOT, sizeof(pthread_attr_t));
+		stacks = (void **) calloc(NFOOT, sizeof(void *));
+		if ((own == NULL) || (stacks == NULL))  {  UNRESOLVED(errno, "Unable to alloc memory for the stacks");  }
+		for (i=0; i<NFOOT; i++)
+		{
+			ret = pthread_attr_init(&own[i]);
+			if (ret != 0)  {  UNRESOLVED(ret, "Failed to initialize a thread attribute object");  }
+			copy_attr(&own[i], &scenarii[sc].ta);
+			ret = posix_memalign(&stacks[i], pagesize, stacksize);
+			if (ret != 0)  {  UNRESOLVED(ret, "Unable to alloc memory for a stack");  }
+			ret = pthread_attr_setstack(&own[i], stacks[i], stacksize);
+			if (ret != 0)  {  UNRESOLVED(ret, "Failed to specify alternate stack");  }
+		}
+	}
+
+	nready = 0;
+	release = 0;
+
+	mem_read(before);
+	for (n=0; n<NFOOT; n++)
+	{
+		ta = (own != NULL) ? &own[n] : &scenarii[sc].ta;
+		ret = pthread_create(&th[n], ta, threaded, (void *)1);
+		if (ret != 0)
+			break;
+	}
+
+	ret = pthread_mutex_lock(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+	while (nready < n)
+	{
+		ret = pthread_cond_wait(&cnd, &mtx);
+		if (ret != 0)  {  UNRESOLVED(ret, "Cond wait failed");  }
+	}
+	ret = pthread_mutex_unlock(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+
+	/* All the threads are alive and blocked */
+	mem_read(after);
+
+	ret = pthread_mutex_lock(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+	release = 1;
+	ret = pthread_cond_broadcast(&cnd);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to broadcast the condition");  }
+	ret = pthread_mutex_unlock(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+
+	for (i=0; i<n; i++)
+		wait_thread(th[i]);
+
+	if (own != NULL)
+	{
+		for (i=0; i<NFOOT; i++)
+		{
+			ret = pthread_attr_destroy(&own[i]);
+			if (ret != 0)  {  UNRESOLVED(ret, "Failed to destroy a thread attribute object");  }
+			free(stacks[i]);
+		}
+		free(stacks);
+		free(own);
+	}
+	free(th);
+
+	return n;
+}
+
+/* The increase per thread, or -1 when unknown */
+double per_thread(long before, long after, int n)
+{
+	if ((before < 0) || (after < 0) || (n == 0))
+		return -1.0;
+	return (double) (after - before) / n;
+}
+
+int main(int argc, char * argv[])
+{
+	long n;
+	int nfoot;
+	unsigned long long elapsed;
+	mem_t before, after;
+	double rate, mean;
+
+	output_init();
+
+	scenar_init();
+
+	#ifdef PLOT_OUTPUT
+	printf("# COLUMNS 7 Scenario Create+join/s Mean(us) RSS(KB/thread) VSZ(KB/thread) VMA/thread Threads\n");
+	#endif
+	#if VERBOSE > 0
+	output("pthread_create benchmark: %i ms of churn, %i threads for the footprint\n", DURATION, NFOOT);
+	output("%-2s %-44s %12s %9s %9s %9s %6s\n", "#", "Scenario", "Create+join/s", "Mean(us)",
+	       "RSS(KB)", "VSZ(KB)", "VMAs");
+	#endif
+
+	for (sc=0; sc < NSCENAR; sc++)
+	{
+		/* The stack of a detached thread may still be in use after the semaphore is posted */
+		if ((scenarii[sc].detached != 0) && (scenarii[sc].bottom != NULL))
+		{
+			#if VERBOSE > 0
+			output("%-2i %-44s skipped (detached, alternative stack)\n", sc, scenarii[sc].descr);
+			#endif
+			continue;
+		}
+
+		n = churn(&elapsed);
+		if (n < 0)
+		{
+			#if VERBOSE > 0
+			output("%-2i %-44s thread creation failed: %s\n", sc, scenarii[sc].descr, strerror(-n));
+			#endif
+			continue;
+		}
+
+		rate = (double) n * 1000000000.0 / (double) elapsed;
+		mean = (double) elapsed / (1000.0 * n);
+
+		nfoot = footprint(&before, &after);
+
+		#ifdef PLOT_OUTPUT
+		printf("%i %.0f %.2f %.1f %.1f %.2f %i\n", sc, rate, mean,
+		       per_thread(before.rss, after.rss, nfoot), per_thread(before.vsz, after.vsz, nfoot),
+		       per_thread(before.vmas, after.vmas, nfoot), nfoot);
+		#endif
+		#if VERBOSE > 0
+		output("%-2i %-44s %12.0f %9.2f %9.1f %9.1f %6.2f%s\n", sc, scenarii[sc].descr, rate, mean,
+		       per_thread(before.rss, after.rss, nfoot), per_thread(before.vsz, after.vsz, nfoot),
+		       per_thread(before.vmas, after.vmas, nfoot), (nfoot < NFOOT) ? " (some creations failed)" : "");
+		#endif
+	}
+
+	scenar_fini();
+
+	#if VERBOSE > 0
+	output("pthread_create benchmark done.\n");
+	#endif
+
+	PASSED;
+}
@@ -29,6 +29,11 @@
  
  /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
  #define _POSIX_C_SOURCE 200112L
+
+ /* CPU placement (see pts_placement.h) uses the Linux affinity API */
+#ifdef PLACEMENT_SWEEP
+ #define _GNU_SOURCE
+#endif
  
  /* Some routines are part of the XSI Extensions */
 #ifndef WITHOUT_XOPEN
@@ -57,6 +62,9 @@
 /********************************************************************************************/
  #include "testfrmw.h"
  #include "testfrmw.c"
+ #include "pts_placement.h"
+ #include "pts_scalability.h"
+ #include "pts_histogram.h"
  /* This header is responsible for defining the following macros:
   * UNRESOLVED(ret, descr);  
   *    where descr is a description of the error and ret is an int (error code for example)
@@ -121,13 +129,30 @@ typedef struct __mes_t
 /* Forward declaration */
 int parse_measure(mes_t * measures);
 
+/* Latency of every single thread creation, per scenario */
+pts_hist_t lat[ NSCENAR ];
+
 
 
 pthread_mutex_t m_synchro=PTHREAD_MUTEX_INITIALIZER;
 
+/* Index of the last thread placed, for the CPU placement */
+pthread_mutex_t m_place=PTHREAD_MUTEX_INITIALIZER;
+int placed;
+
 void * threaded(void * arg)
 {
 	int ret=0;
+	int idx;
+	
+	/* Pin this thread according to the CPU placement */
+	ret = pthread_mutex_lock(&m_place);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+	idx = ++placed;
+	ret = pthread_mutex_unlock(&m_place);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+	ret = pts_place_thread(idx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Unable to place the thread");  }
 	
 	/* Signal we're done */
 	do { ret = sem_post(&scenarii[sc].sem); }
@@ -166,6 +191,11 @@ int main (int argc, char *argv[])
 
 	/* Initialize output routine */
 	output_init();
+
+#ifdef PLACEMENT_SWEEP
+	/* Run the following once per CPU placement */
+	pts_placement_sweep();
+#endif
 	
 	if (PTHREAD_THREADS_MAX > 0)
 		my_max = PTHREAD_THREADS_MAX;
@@ -176,6 +206,9 @@ int main (int argc, char *argv[])
 	/* Initialize thread attribute objects */
 	scenar_init();
 
+	for (sc=0; sc < NSCENAR; sc++)
+		pts_hist_init(&lat[sc]);
+
 	#ifdef PLOT_OUTPUT
 	printf("# COLUMNS %d #threads", NSCENAR + 1);
 	for (sc=0; sc<NSCENAR; sc++)
@@ -198,6 +231,7 @@ int main (int argc, char *argv[])
 			
 			ctl=0;
 			nthreads=0;
+			placed=0;
 			m_cur = &sentinel;
 
 			/* Create 1 thread for testing purpose */
@@ -269,6 +303,8 @@ if (ret == ENOMEM)  break;
 					ret = clock_gettime(CLOCK_REALTIME, &ts_fin);
 					if (ret != 0)  {  UNRESOLVED(errno, "Unable to read clock");  }
 					
+					pts_hist_record_ts(&lat[sc], &ts_ref, &ts_fin);
+					
 					/* add to the measure list if nthreads % resolution == 0 */
 					if ((nthreads % RESOLUTION) == 0)
 					{
@@ -339,6 +375,13 @@ if (ret == ENOMEM)  break;
 	/* Compute the results */
 	ret = parse_measure(&sentinel);
 	
+	#if VERBOSE > 0
+	output("-----\n");
+	for (sc=0; sc < NSCENAR; sc++)
+		if (lat[sc].count != 0)
+			pts_hist_report(scenarii[sc].descr, &lat[sc]);
+	#endif
+	
 	
 	/* Free the resources and output the results */
 	
@@ -378,271 +421,57 @@ if (ret == ENOMEM)  break;
 
 
 /***
- * The next function will seek for the better model for each series of measurements.
- *
- * The tested models are: -- X = # threads; Y = latency
- * -> Y = a;      -- Error is r1 = avg( (Y - Yavg)² );
- * -> Y = aX + b; -- Error is r2 = avg( (Y -aX -b)² );
- *                -- where a = avg ( (X - Xavg)(Y - Yavg) ) / avg( ( X - Xavg)² )
- *                --         Note: We will call _q = sum( (X - Xavg) * (Y - Yavg) ); 
- *                --                       and  _d = sum( (X - Xavg)² );
- *                -- and   b = Yavg - a * Xavg
- * -> Y = c * X^a;-- Same as previous, but with log(Y) = a log(X) + b; and b = log(c). Error is r3
- * -> Y = exp(aX + b); -- log(Y) = aX + b. Error is r4
- *
- * We compute each error factor (r1, r2, r3, r4) then search which is the smallest (with ponderation).
- * The function returns 0 when r1 is the best for all cases (latency is constant) and !0 otherwise.
+ * The next function will seek for the better model for each series of measurements
+ * (see pts_scalability.h for the models and the verdict).
+ * The function returns 0 when the latency is constant for all cases and !0 otherwise.
  */
 
-struct row
-{
-	long X;  /* the X values -- copied from function argument */
-	long Y[NSCENAR];  /* the Y values -- copied from function argument */
-	long _x[NSCENAR]; /* Value X - Xavg */
-	long _y[NSCENAR]; /* Value Y - Yavg */
-	double LnX; /* Natural logarithm of X values */
-	double LnY[NSCENAR]; /* Natural logarithm of Y values */
-	double _lnx[NSCENAR]; /* Value LnX - LnXavg */
-	double _lny[NSCENAR]; /* Value LnY - LnYavg */
-};
-
 int parse_measure(mes_t * measures)
 {
-	int ret, i, r;
+	int ret, i, err;
 	
 	mes_t *cur;
 	
-	double Xavg[NSCENAR], Yavg[NSCENAR];
-	double LnXavg[NSCENAR], LnYavg[NSCENAR];
-	
-	int N; 
-	
-	double r1[NSCENAR], r2[NSCENAR], r3[NSCENAR], r4[NSCENAR];
-	
-	/* Some more intermediate vars */
-	long double _q[3][NSCENAR];
-	long double _d[3][NSCENAR];
+	pts_serie_t series[NSCENAR];
+	pts_fit_t fit;
 	
-	long double t; /* temp value */
-	
-	struct row *Table = NULL;
-	
-	/* This array contains the last element of each serie */
-	int array_max[NSCENAR];
-	
-	/* Initialize the datas */
-	for (i=0; i<NSCENAR; i++)
-	{
-		array_max[i] = -1; /* means no data */
-		Xavg[i] = 0.0;
-		LnXavg[i] = 0.0;
-		Yavg[i] = 0.0;
-		LnYavg[i] = 0.0;
-		r1[i] = 0.0;
-		r2[i] = 0.0;
-		r3[i] = 0.0;
-		r4[i] = 0.0;
-		_q[0][i]=0.0;
-		_q[1][i]=0.0;
-		_q[2][i]=0.0;
-		_d[0][i]=0.0;
-		_d[1][i]=0.0;
-		_d[2][i]=0.0;
-	}
-	N=0;
-	cur = measures;
+	memset(series, 0, sizeof(series));
 	
 	#if VERBOSE > 1
 	output("Data analysis starting\n");
 	#endif
 	
-	/* We start with reading the list to find:
-	 * -> number of elements, to assign an array.
-	 * -> average values 
-	 */
-	while (cur->next != NULL)
+	for (cur = measures->next; cur != NULL; cur = cur->next)
 	{
-		cur = cur->next;
-		
-		N++;
-		
 		for (i=0; i<NSCENAR; i++)
 		{
 			if (cur->_data[i] != 0)
 			{
-				array_max[i]=N;
-				Xavg[i] += (double) cur->nthreads;
-				LnXavg[i] += log( (double) cur->nthreads);
-				Yavg[i] += (double) cur->_data[i];
-				LnYavg[i] += log( (double) cur->_data[i] );
+				err = pts_serie_add(&series[i], (double) cur->nthreads, (double) cur->_data[i]);
+				if (err != 0)  {  UNRESOLVED(err, "Unable to alloc space for results parsing");  }
 			}
 		}
 	}
 	
-	/* We have the sum; we can divide to obtain the average values */
-	for (i=0; i<NSCENAR; i++)
-	{
-		if (array_max[i] != -1)
-		{
-			Xavg[i] /= array_max[i];
-			LnXavg[i] /= array_max[i];
-			Yavg[i] /= array_max[i];
-			LnYavg[i] /= array_max[i];
-		}
-	}
-	
-	#if VERBOSE > 1
-	output(" Found %d rows and %d columns\n", N, NSCENAR);
-	#endif
-	
-	
-	/* We will now alloc the array ... */
-	Table = calloc(N, sizeof( struct row ));
-	if (Table == NULL)  {  UNRESOLVED(errno, "Unable to alloc space for results parsing");  }
-	
-	/* ... and fill it */
-	N = 0;
-	cur = measures;
-	
-	while (cur->next != NULL)
-	{
-		cur = cur->next;
-		
-		Table[N].X = (long) cur->nthreads;
-		Table[N].LnX = log((double) cur->nthreads);
-		for (i=0; i<NSCENAR; i++)
-		{
-			if (array_max[i] > N)
-			{
-				Table[N]._x[i] = Table[N].X - Xavg[i] ;
-				Table[N]._lnx[i] = Table[N].LnX - LnXavg[i];
-				Table[N].Y[i] = cur->_data[i];
-				Table[N]._y[i] = Table[N].Y[i] - Yavg[i] ;
-				Table[N].LnY[i] = log((double) cur->_data[i]);
-				Table[N]._lny[i] = Table[N].LnY[i] - LnYavg[i];
-			}
-		}
-		
-		N++;
-	}
-	
-	/* We won't need the list anymore -- we'll work with the array which should be faster. */
-	#if VERBOSE > 1
-	output(" Data was stored in an array.\n");
-	#endif
-	
-	/* We need to read the full array at least twice to compute all the error factors */
-	
-	/* In the first pass, we'll compute:
-	 * -> r1 for each scenar.
-	 * -> "a" factor for linear (0), power (1) and exponential (2) approximations -- with using the _d and _q vars.
-	 */
-	#if VERBOSE > 1
-	output("Starting first pass...\n");
-	#endif
-	for (i=0; i<NSCENAR; i++)
-	{
-		for (r=0; r<array_max[i]; r++)
-		{
-			r1[i] += ((double)Table[r]._y[i] / array_max[i]) * (double)Table[r]._y[i];
-			
-			_q[0][i] += Table[r]._y[i] * Table[r]._x[i];
-			_d[0][i] += Table[r]._x[i] * Table[r]._x[i];
-			
-			_q[1][i] += Table[r]._lny[i] * Table[r]._lnx[i];
-			_d[1][i] += Table[r]._lnx[i] * Table[r]._lnx[i];
-			
-			_q[2][i] += Table[r]._lny[i] * Table[r]._x[i];
-			_d[2][i] += Table[r]._x[i] * Table[r]._x[i];
-		}
-	}
-	
-	/* First pass is terminated; a2 = _q[0]/_d[0]; a3 = _q[1]/_d[1]; a4 = _q[2]/_d[2] */
-
-	/* In the first pass, we'll compute:
-	 * -> r2, r3, r4 for each scenar.
-	 */
-	
-	#if VERBOSE > 1
-	output("Starting second pass...\n");
-	#endif
-	for (i=0; i<NSCENAR; i++)
-	{
-		for (r=0; r<array_max[i]; r++)
-		{
-			/* r2 = avg((y - ax -b)²);  t = (y - ax - b) = (y - yavg) - a (x - xavg); */
-			t = ( Table[r]._y[i] - ((_q[0][i] * Table[r]._x[i]) / _d[0][i]));
-			r2[i] += t * t / array_max[i]  ;
-			
-			/* r3 = avg(( y - c.x^a) ²);  
-			    t = y - c * x ^ a 
-			      = y - log (LnYavg - (_q[1]/_d[1]) * LnXavg) * x ^ (_q[1]/_d[1])
-			*/
-			t = (   Table[r].Y[i]
-			      - ( logl ( LnYavg[i] - (_q[1][i] / _d[1][i] ) * LnXavg[i])
-			        * powl( Table[r].X,  (_q[1][i] / _d[1][i] ))
-			    )   );
-			r3[i] += t * t / array_max[i] ;
-			
-			/* r4 = avg(( y - exp(ax+b))²);
-			    t = y - exp(ax+b)
-			      = y - exp( _q[2]/_d[2] * x + ( LnYavg - (_q[2]/_d[2] * Xavg) ));
-			      = y - exp( _q[2]/_d[2] * (x - Xavg) + LnYavg );
-			*/
-			t = (   Table[r].Y[i]
-			      - expl( ( _q[2][i] / _d[2][i] ) * Table[r]._x[i] + LnYavg[i] ) );
-			r4[i] += t * t / array_max[i] ;
-			
-		}
-	}
-
-	#if VERBOSE > 1
-	output("All computing terminated.\n");
-	#endif
 	ret = 0;
 	for (i=0; i<NSCENAR; i++)
 	{
-		#if VERBOSE > 1
-		output("\nScenario: %s\n", scenarii[i].descr);
-		
-		output(" # of data: %i\n", array_max[i]);
-		
-		output("  Model: Y = k\n");
-		output("       k = %g\n", Yavg[i]);
-		output("    Divergence %g\n", r1[i]);
+		if (series[i].n == 0)
+			continue;
 		
-		output("  Model: Y = a * X + b\n");
-		output("       a = %Lg\n", _q[0][i] / _d[0][i]);
-		output("       b = %Lg\n", Yavg[i] - ((_q[0][i] / _d[0][i]) * Xavg[i]));
-		output("    Divergence %g\n", r2[i]);
+		err = pts_scal_fit(&series[i], &fit);
+		if (err != 0)  {  UNRESOLVED(err, "Unable to alloc space for results parsing");  }
 		
-		output("  Model: Y = c * X ^ a\n");
-		output("       a = %Lg\n", _q[1][i] / _d[1][i]);
-		output("       c = %Lg\n", logl ( LnYavg[i] - (_q[1][i] / _d[1][i] ) * LnXavg[i]));
-		output("    Divergence %g\n", r2[i]);
-		
-		output("  Model: Y = exp(a * X + b)\n");
-		output("       a = %Lg\n", _q[2][i] / _d[2][i]);
-		output("       b = %Lg\n", LnYavg[i] - ((_q[2][i] / _d[2][i]) * Xavg[i]));
-		output("    Divergence %g\n", r2[i]);
+		#if VERBOSE > 1
+		pts_scal_report(scenarii[i].descr, &fit);
 		#endif
 		
-		if (array_max[i] != -1)
-		{
-			/* Compare r1 to other values, with some ponderations */
-			if ((r1[i] > 1.1 * r2[i]) || (r1[i] > 1.2 * r3[i]) || (r1[i] > 1.3 * r4[i]))
-					ret++;
-			#if VERBOSE > 1
-			else
-				output(" Sanction: OK\n");
-			#endif
-		}
+		if (fit.grows)
+			ret++;
+		
+		pts_serie_free(&series[i]);
 	}
 	
-	/* We need to free the array */
-	free(Table);
-	
 	/* We're done */
 	return ret;
 }
-
@@ -0,0 +1,387 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+
+
+ * This file is a benchmark for the thread-specific data functions
+ * (pthread_getspecific, pthread_setspecific, pthread_key_create and
+ * pthread_key_delete).
+ * It measures how their cost evolves with the # of keys.
+
+ * The steps are:
+ * -> Keys are created, without destructor, until 1, 2, 4, ... K keys
+ *    exist (K is PTHREAD_KEYS_MAX, or less if the system runs out of keys).
+ *    For each # of keys and for 1, 2, ... N threads (N is the # of
+ *    processors, at least 2), each thread makes LOOPS calls of:
+ *    -> pthread_getspecific on the first key;
+ *    -> pthread_getspecific on the last created key;
+ *    -> pthread_setspecific on the last created key;
+ *    and we report the mean cost of each call.
+ * -> For 1, 2, 4, ... K keys, ROUNDS threads are created one after the
+ *    other; each one sets a value in the first keys and calls pthread_exit.
+ *    We report the delay between the call to pthread_exit and the return
+ *    of pthread_join (p50, p99 and max), with keys without destructor, then
+ *    with keys with a destructor.
+ * -> For 1, 2, ... N threads, each thread creates and deletes a key in
+ *    a loop for DURATION ms; we report the total # of pairs per second.
+ * -> The test fails if a thread does not read back the value it has set,
+ *    or if the destructors are not called once per key and per thread.
+ */
+
+ /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
+ #define _POSIX_C_SOURCE 200112L
+
+/********************************************************************************************/
+/****************************** standard includes *****************************************/
+/********************************************************************************************/
+ #include <pthread.h>
+ #include <errno.h>
+ #include <limits.h>
+ #include <unistd.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <stdarg.h>
+
+/********************************************************************************************/
+/******************************   Test framework   *****************************************/
+/********************************************************************************************/
+ #include "testfrmw.h"
+ #include "testfrmw.c"
+ #include "pts_bench.h"
+ #include "pts_histogram.h"
+ /* testfrmw.h gives UNRESOLVED, FAILED and PASSED, which end the process,
+  * and output(); pts_bench.h gives the clock, start gate and run routines. */
+
+/********************************************************************************************/
+/********************************** Configuration ******************************************/
+/********************************************************************************************/
+#ifndef SCALABILITY_FACTOR
+#define SCALABILITY_FACTOR 1
+#endif
+#ifndef VERBOSE
+#define VERBOSE 1
+#endif
+
+/* # of calls per thread for each get / set measure */
+#ifndef LOOPS
+#define LOOPS (200000 * SCALABILITY_FACTOR)
+#endif
+
+/* # of threads for each pthread_exit case */
+#ifndef ROUNDS
+#define ROUNDS (200 * SCALABILITY_FACTOR)
+#endif
+
+/* Duration of each key churn case, in ms */
+#ifndef DURATION
+#define DURATION (500 * SCALABILITY_FACTOR)
+#endif
+
+#ifdef PLOT_OUTPUT
+#undef VERBOSE
+#define VERBOSE 0
+#endif
+
+/********************************************************************************************/
+/***********************************    Test case   *****************************************/
+/********************************************************************************************/
+
+#ifndef PTHREAD_KEYS_MAX
+#define PTHREAD_KEYS_MAX 128
+#endif
+
+/* The keys */
+pthread_key_t * keys;
+int nkeys;      /* # of keys in use for the current case */
+
+pts_gate_t gate;
+
+/* The result of each thread */
+typedef struct
+{
+	unsigned long long get_first;   /* ns for LOOPS calls */
+	unsigned long long get_last;
+	unsigned long long set_last;
+	unsigned long long pairs;       /* # of key create / delete pairs */
+	unsigned long long exited;      /* time of the pthread_exit call */
+} result_t;
+
+result_t * res;
+
+/* # of calls of the destructor; only one thread runs it at a time */
+volatile long destructed;
+
+void destructor(void * value)
+{
+	destructed++;
+}
+
+void * volatile sink;
+
+void * getset(void * arg)
+{
+	int ret, i;
+	long id = (long)arg;
+	result_t * r = &res[id];
+	pthread_key_t first = keys[0], last = keys[nkeys - 1];
+	unsigned long long t0;
+	void * v, * expected;
+
+	ret = pthread_setspecific(first, r);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to set the thread-specific data");  }
+	ret = pthread_setspecific(last, r);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to set the thread-specific data");  }
+
+	ret = pts_gate_ready(&gate);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to wait for the start");  }
+
+	t0 = pts_now_ns();
+	for (i=0; i<LOOPS; i++)
+		sink = pthread_getspecific(first);
+	r->get_first = pts_now_ns() - t0;
+
+	t0 = pts_now_ns();
+	for (i=0; i<LOOPS; i++)
+		sink = pthread_getspecific(last);
+	r->get_last = pts_now_ns() - t0;
+
+	/* Alternate two distinct values, so that the last one can be checked */
+	t0 = pts_now_ns();
+	for (i=0; i<LOOPS; i++)
+	{
+		ret = pthread_setspecific(last, (i & 1) ? (void *) r : (void *) &r->get_first);
+		if (ret != 0)  {  UNRESOLVED(ret, "Failed to set the thread-specific data");  }
+	}
+	r->set_last = pts_now_ns() - t0;
+
+	/* With a single key, first is last and holds the last value set */
+	expected = ((LOOPS - 1) & 1) ? (void *) r : (void *) &r->get_first;
+	v = pthread_getspecific(first);
+	if (v != ((nkeys > 1) ? (void *) r : expected))
+	{  FAILED("pthread_getspecific did not return the value of the thread");  }
+	v = pthread_getspecific(last);
+	if (v != expected)  {  FAILED("pthread_getspecific did not return the last value set");  }
+
+	return NULL;
+}
+
+void * exiter(void * arg)
+{
+	int ret, i;
+
+	for (i=0; i<nkeys; i++)
+	{
+		ret = pthread_setspecific(keys[i], arg);
+		if (ret != 0)  {  UNRESOLVED(ret, "Failed to set the thread-specific data");  }
+	}
+
+	res[0].exited = pts_now_ns();
+	pthread_exit(NULL);
+	return NULL;
+}
+
+void * churn(void * arg)
+{
+	int ret;
+	long id = (long)arg;
+	unsigned long long pairs = 0;
+	pthread_key_t k;
+
+	ret = pts_gate_ready(&gate);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to wait for the start");  }
+
+	while (!pts_gate_closed(&gate))
+	{
+		ret = pthread_key_create(&k, destructor);
+		if (ret != 0)  {  UNRESOLVED(ret, "Failed to create a key");  }
+		ret = pthread_key_delete(k);
+		if (ret != 0)  {  UNRESOLVED(ret, "Failed to delete a key");  }
+		pairs++;
+	}
+	res[id].pairs = pairs;
+
+	return NULL;
+}
+
+/* Start n threads of fn, let them run (for DURATION ms if timed), and join them */
+void run(int n, void * (*fn)(void *), int timed)
+{
+	int ret;
+
+	ret = pts_bench_run(&gate, n, fn, NULL, 0, timed ? DURATION : 0, NULL, NULL);
+	if (ret != 0)  {  UNRESOLVED(ret, "Unable to run the threads");  }
+}
+
+/* Measure the pthread_exit cost with the first k keys set */
+void exit_case(int k, int destr)
+{
+	int ret, i;
+	pthread_t th;
+	unsigned long long t;
+	pts_hist_t * lat;
+
+	lat = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+	if (lat == NULL)  {  UNRESOLVED(errno, "Unable to alloc memory for the histogram");  }
+	pts_hist_init(lat);
+
+	nkeys = k;
+	destructed = 0;
+	for (i=0; i<ROUNDS; i++)
+	{
+		ret = pthread_create(&th, NULL, exiter, (void *) lat);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to create a thread");  }
+		ret = pthread_join(th, NULL);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to join a thread");  }
+		t = pts_now_ns();
+		pts_hist_record(lat, (t > res[0].exited) ? t - res[0].exited : 0);
+	}
+
+	if (destructed != (destr ? (long) k * ROUNDS : 0))
+	{
+		output("%li destructor calls for %i keys and %i threads\n", destructed, k, ROUNDS);
+		FAILED("The destructors were not called once per key and per thread");
+	}
+
+	#ifdef PLOT_OUTPUT
+	printf("# Exit %i %i %llu %llu %llu\n", destr, k,
+	       pts_hist_percentile(lat, 50.0), pts_hist_percentile(lat, 99.0), lat->max);
+	#endif
+	#if VERBOSE > 0
+	output("%-10s %6i %10llu %10llu %10llu\n", destr ? "yes" : "no", k,
+	       pts_hist_percentile(lat, 50.0), pts_hist_percentile(lat, 99.0), lat->max);
+	#endif
+
+	free(lat);
+}
+
+int main(int argc, char * argv[])
+{
+	int ret, max, n, k, i, kmax, destr;
+	long sc;
+	unsigned long long gf, gl, sl, pairs;
+
+	output_init();
+
+	max = pts_max_threads(1);
+
+	kmax = PTHREAD_KEYS_MAX;
+	sc = sysconf(_SC_THREAD_KEYS_MAX);
+	if (sc > kmax)
+		kmax = sc;
+
+	keys = (pthread_key_t *) calloc(kmax, sizeof(pthread_key_t));
+	res = (result_t *) calloc(max, sizeof(result_t));
+	if ((keys == NULL) || (res == NULL))  {  UNRESOLVED(errno, "Unable to alloc memory");  }
+
+	#ifdef PLOT_OUTPUT
+	printf("# COLUMNS 5 Keys Threads Get-first(ns) Get-last(ns) Set-last(ns)\n");
+	#endif
+	#if VERBOSE > 0
+	output("TSD benchmark: up to %i keys, up to %i threads\n", kmax, max);
+	output("%6s %7s %10s %10s %10s\n", "Keys", "Threads", "Get-first", "Get-last", "Set-last");
+	#endif
+
+	/* get / set cost; the keys are created as the sweep goes */
+	nkeys = 0;
+	for (k = 1; k != 0; k = pts_next_count(k, kmax))
+	{
+		for (; nkeys < k; nkeys++)
+		{
+			ret = pthread_key_create(&keys[nkeys], NULL);
+			if (ret == EAGAIN)
+				break;
+			if (ret != 0)  {  UNRESOLVED(ret, "Failed to create a key");  }
+		}
+		if (nkeys < k)
+		{
+			#if VERBOSE > 0
+			output(" The system ran out of keys after %i keys\n", nkeys);
+			#endif
+			kmax = nkeys;
+			k = nkeys;
+			if (k == 0)  {  UNRESOLVED(EAGAIN, "Unable to create any key");  }
+		}
+
+		for (n = 1; n != 0; n = pts_next_count(n, max))
+		{
+			run(n, getset, 0);
+
+			gf = gl = sl = 0;
+			for (i=0; i<n; i++)
+			{
+				gf += res[i].get_first;
+				gl += res[i].get_last;
+				sl += res[i].set_last;
+			}
+
+			#ifdef PLOT_OUTPUT
+			printf("%i %i %.2f %.2f %.2f\n", k, n,
+			       (double) gf / ((double) n * LOOPS), (double) gl / ((double) n * LOOPS),
+			       (double) sl / ((double) n * LOOPS));
+			#endif
+			#if VERBOSE > 0
+			output("%6i %7i %10.2f %10.2f %10.2f\n", k, n,
+			       (double) gf / ((double) n * LOOPS), (double) gl / ((double) n * LOOPS),
+			       (double) sl / ((double) n * LOOPS));
+			#endif
+		}
+	}
+
+	/* pthread_exit cost, without then with destructors */
+	#if VERBOSE > 0
+	output("\npthread_exit to pthread_join return delay (ns), %i threads per case\n", ROUNDS);
+	output("%-10s %6s %10s %10s %10s\n", "Destructor", "Keys", "Exit-p50", "Exit-p99", "Exit-max");
+	#endif
+	for (destr = 0; destr <= 1; destr++)
+	{
+		if (destr)
+		{
+			for (i=0; i<kmax; i++)
+			{
+				ret = pthread_key_delete(keys[i]);
+				if (ret != 0)  {  UNRESOLVED(ret, "Failed to delete a key");  }
+				ret = pthread_key_create(&keys[i], destructor);
+				if (ret != 0)  {  UNRESOLVED(ret, "Failed to create a key");  }
+			}
+		}
+		for (k = 1; k != 0; k = pts_next_count(k, kmax))
+			exit_case(k, destr);
+	}
+
+	for (i=0; i<kmax; i++)
+	{
+		ret = pthread_key_delete(keys[i]);
+		if (ret != 0)  {  UNRESOLVED(ret, "Failed to delete a key");  }
+	}
+
+	/* key create / delete churn */
+	#if VERBOSE > 0
+	output("\npthread_key_create / pthread_key_delete churn, %i ms per case\n", DURATION);
+	output("%7s %12s\n", "Threads", "Pairs/s");
+	#endif
+	for (n = 1; n != 0; n = pts_next_count(n, max))
+	{
+		run(n, churn, 1);
+
+		pairs = 0;
+		for (i=0; i<n; i++)
+			pairs += res[i].pairs;
+
+		#ifdef PLOT_OUTPUT
+		printf("# Churn %i %.0f\n", n, (double) pairs * 1000.0 / DURATION);
+		#endif
+		#if VERBOSE > 0
+		output("%7i %12.0f\n", n, (double) pairs * 1000.0 / DURATION);
+		#endif
+	}
+
+	free(res);
+	free(keys);
+
+	#if VERBOSE > 0
+	output("TSD benchmark done.\n");
+	#endif
+
+	PASSED;
+}
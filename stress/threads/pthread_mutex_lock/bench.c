@@ -0,0 +1,281 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+
+
+ * This file is a benchmark for the pthread_mutex_lock function.
+ * It measures the cost of the mutex under contention.
+
+ * The steps are:
+ * -> For each kind of mutex (default, NORMAL, ERRORCHECK, RECURSIVE),
+ *    for each critical section length in cs_len[],
+ *    and for 1, 2, 4, ... N threads (N is the # of processors, at least 2),
+ *    the threads loop during DURATION ms:
+ *          {
+ *               mutex_lock
+ *               check that no other thread is in the critical section
+ *               work for the critical section length
+ *               mutex_unlock
+ *          }
+ * -> For each run we report:
+ *    -> the # of lock / unlock per second;
+ *    -> the Jain fairness index of the # of acquisitions per thread
+ *       (1.0 when all threads got the mutex as often, 1/n when one thread
+ *       got it every time);
+ *    -> the handoff latency, i.e. the delay between the unlock by a
+ *       thread and the lock by another thread (p50, p99 and max).
+ * -> The test fails if two threads are ever in the critical section.
+ *
+ * The critical section always includes two clock reads, which give the
+ * handoff timestamps.
+ */
+
+ /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
+ #define _POSIX_C_SOURCE 200112L
+
+ /* We enable the following line to have mutex attributes defined */
+#ifndef WITHOUT_XOPEN
+ #define _XOPEN_SOURCE	600
+#endif
+
+/********************************************************************************************/
+/****************************** standard includes *****************************************/
+/********************************************************************************************/
+ #include <pthread.h>
+ #include <errno.h>
+ #include <unistd.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <stdarg.h>
+ #include <time.h>
+
+/********************************************************************************************/
+/******************************   Test framework   *****************************************/
+/********************************************************************************************/
+ #include "testfrmw.h"
+ #include "testfrmw.c"
+ #include "pts_bench.h"
+ #include "pts_histogram.h"
+ /* testfrmw.h gives UNRESOLVED, FAILED and PASSED, which end the process,
+  * and output(); pts_bench.h gives the clock, start gate and run routines. */
+
+/********************************************************************************************/
+/********************************** Configuration ******************************************/
+/********************************************************************************************/
+#ifndef SCALABILITY_FACTOR
+#define SCALABILITY_FACTOR 1
+#endif
+#ifndef VERBOSE
+#define VERBOSE 1
+#endif
+
+/* Duration of each run, in ms */
+#ifndef DURATION
+#define DURATION (250 * SCALABILITY_FACTOR)
+#endif
+
+#ifdef PLOT_OUTPUT
+#undef VERBOSE
+#define VERBOSE 0
+#endif
+
+/********************************************************************************************/
+/***********************************    Test case   *****************************************/
+/********************************************************************************************/
+
+/* Critical section lengths, in ns */
+unsigned long long cs_len[] = { 0, 100, 1000 };
+#define NCS (sizeof(cs_len) / sizeof(cs_len[0]))
+
+#ifndef WITHOUT_XOPEN
+int types[]={-1, /* default attributes */
+					PTHREAD_MUTEX_NORMAL,
+					PTHREAD_MUTEX_ERRORCHECK,
+					PTHREAD_MUTEX_RECURSIVE};
+char * names[]={"Default", "NORMAL", "ERRORCHECK", "RECURSIVE"};
+#else
+int types[]={-1};
+char * names[]={"Default"};
+#endif
+#define NTYPES (sizeof(types) / sizeof(types[0]))
+
+/* The data of each thread */
+typedef struct
+{
+	int id;
+	unsigned long long ops;   /* # of acquisitions */
+	pts_hist_t * handoff;     /* handoff latencies, when this thread got the mutex */
+	char pad[PTS_CACHE_LINE];
+} thread_t;
+
+/* The data shared by the threads of a run */
+pthread_mutex_t mtx;
+pts_gate_t gate;
+unsigned long long cs;                  /* current critical section length */
+volatile int inside;                    /* !0 while a thread is in the critical section */
+volatile int owner;                     /* last thread which owned the mutex */
+volatile unsigned long long released;   /* time when it released the mutex */
+
+void * worker(void * arg)
+{
+	int ret;
+	unsigned long long t0, now;
+	thread_t * me = (thread_t *)arg;
+
+	ret = pts_gate_ready(&gate);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to wait at the start gate");  }
+
+	while (!pts_gate_closed(&gate))
+	{
+		ret = pthread_mutex_lock(&mtx);
+		if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed in worker thread");  }
+
+		t0 = pts_now_ns();
+
+		if (inside != 0)
+		{  FAILED("Two threads are in the critical section");  }
+		inside = 1;
+
+		if ((owner != -1) && (owner != me->id))
+			pts_hist_record(me->handoff, t0 - released);
+		owner = me->id;
+
+		/* Work in the critical section */
+		do { now = pts_now_ns(); }
+		while (now < t0 + cs);
+
+		inside = 0;
+		released = now;
+
+		ret = pthread_mutex_unlock(&mtx);
+		if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed in worker thread");  }
+
+		me->ops++;
+	}
+
+	return NULL;
+}
+
+/* Run the n threads with the given mutex attributes, then output the results */
+void run(int type, int n, thread_t * th, pthread_mutexattr_t * pma)
+{
+	int ret, i;
+	unsigned long long start, end, total;
+	unsigned long long * ops;
+	pts_hist_t handoff;
+	double rate;
+
+	ret = pthread_mutex_init(&mtx, pma);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex init failed");  }
+
+	inside = 0;
+	owner = -1;
+	released = 0;
+
+	for (i=0; i<n; i++)
+	{
+		th[i].id = i;
+		th[i].ops = 0;
+		pts_hist_init(th[i].handoff);
+	}
+
+	ret = pts_bench_run(&gate, n, worker, th, sizeof(thread_t), DURATION, &start, &end);
+	if (ret != 0)  {  UNRESOLVED(ret, "Unable to run the worker threads");  }
+
+	ops = (unsigned long long *) calloc(n, sizeof(unsigned long long));
+	if (ops == NULL)  {  UNRESOLVED(errno, "Unable to alloc memory for the results");  }
+
+	pts_hist_init(&handoff);
+	total = 0;
+	for (i=0; i<n; i++)
+	{
+		ops[i] = th[i].ops;
+		total += th[i].ops;
+		pts_hist_merge(&handoff, th[i].handoff);
+	}
+
+	ret = pthread_mutex_destroy(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex destroy failed");  }
+
+	rate = (double) total * 1000000000.0 / (double) (end - start);
+
+	#ifdef PLOT_OUTPUT
+	printf("%i %i %llu %.0f %.4f %llu %llu %llu\n", type, n, cs, rate,
+	       pts_fairness(ops, n),
+	       pts_hist_percentile(&handoff, 50.0),
+	       pts_hist_percentile(&handoff, 99.0),
+	       handoff.max);
+	#endif
+	#if VERBOSE > 0
+	output("%-10s %7i %7llu %12.0f %8.4f %10llu %10llu %10llu\n", names[type], n, cs, rate,
+	       pts_fairness(ops, n),
+	       pts_hist_percentile(&handoff, 50.0),
+	       pts_hist_percentile(&handoff, 99.0),
+	       handoff.max);
+	#endif
+
+	free(ops);
+}
+
+int main(int argc, char * argv[])
+{
+	int ret, max, n;
+	unsigned int t, c, i;
+	pthread_mutexattr_t ma;
+	thread_t * th;
+
+	output_init();
+
+	max = pts_max_threads(1);
+
+	th = (thread_t *) calloc(max, sizeof(thread_t));
+	if (th == NULL)  {  UNRESOLVED(errno, "Unable to alloc memory for the threads");  }
+	for (i=0; i<(unsigned)max; i++)
+	{
+		th[i].handoff = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+		if (th[i].handoff == NULL)  {  UNRESOLVED(errno, "Unable to alloc memory for the histograms");  }
+	}
+
+	#ifdef PLOT_OUTPUT
+	printf("# COLUMNS 8 Type Threads CS(ns) Ops/s Fairness Handoff-p50(ns) Handoff-p99(ns) Handoff-max(ns)\n");
+	#endif
+	#if VERBOSE > 0
+	output("Mutex benchmark: %i ms per run, up to %i threads\n", DURATION, max);
+	output("%-10s %7s %7s %12s %8s %10s %10s %10s\n", "Type", "Threads", "CS(ns)", "Ops/s",
+	       "Fairness", "Hand-p50", "Hand-p99", "Hand-max");
+	#endif
+
+	for (t=0; t<NTYPES; t++)
+	{
+		ret = pthread_mutexattr_init(&ma);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to init a mutex attribute object");  }
+		#ifndef WITHOUT_XOPEN
+		if (types[t] != -1)
+		{
+			ret = pthread_mutexattr_settype(&ma, types[t]);
+			if (ret != 0)  {  UNRESOLVED(ret, "Unable to set type of a mutex attribute object");  }
+		}
+		#endif
+
+		for (c=0; c<NCS; c++)
+		{
+			cs = cs_len[c];
+			for (n = 1; n != 0; n = pts_next_count(n, max))
+				run(t, n, th, &ma);
+		}
+
+		ret = pthread_mutexattr_destroy(&ma);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to destroy a mutex attribute object");  }
+	}
+
+	for (i=0; i<(unsigned)max; i++)
+		free(th[i].handoff);
+	free(th);
+
+	#if VERBOSE > 0
+	output("pthread_mutex_lock benchmark done.\n");
+	#endif
+
+	PASSED;
+}
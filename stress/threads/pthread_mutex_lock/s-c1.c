@@ -33,6 +33,11 @@
 
  /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
  #define _POSIX_C_SOURCE 200112L
+
+ /* CPU placement (see pts_placement.h) uses the Linux affinity API */
+#ifdef PLACEMENT_SWEEP
+ #define _GNU_SOURCE
+#endif
  
  /* We enable the following line to have mutex attributes defined */
 #ifndef WITHOUT_XOPEN
@@ -54,6 +59,7 @@
 /********************************************************************************************/
  #include "testfrmw.h"
  #include "testfrmw.c"
+ #include "pts_placement.h"
  /* This header is responsible for defining the following macros:
   * UNRESOLVED(ret, descr);  
   *    where descr is a description of the error and ret is an int (error code for example)
@@ -117,6 +123,11 @@ void * threaded(void * arg)
 	int i;
 	int bool;
 	
+	/* Pin this thread according to the CPU placement */
+	ret = pts_place_thread((int)(long)arg);
+	if (ret != 0)
+	{  UNRESOLVED(ret, "Unable to place the thread");  }
+	
 	for (i=0; i<5; i++)
 	{
 		ret=pthread_mutex_lock(&mtx[i]);
@@ -180,6 +191,11 @@ int main(int argc, char * argv[])
 	
 	
 	output_init();
+
+#ifdef PLACEMENT_SWEEP
+	/* Run the following once per CPU placement */
+	pts_placement_sweep();
+#endif
 	
 	#if VERBOSE > 1
 	output("Test starting, initializing data\n");
@@ -251,7 +267,7 @@ int main(int argc, char * argv[])
 	#endif
 	do
 	{
-		ret = pthread_create(&th, &tha, threaded, NULL);
+		ret = pthread_create(&th, &tha, threaded, (void *)(long)(nbthTOT + 1));
 		if (ret == 0)
 			nbthTOT++;
 	} while (ret == 0);
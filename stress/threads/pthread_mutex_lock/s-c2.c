@@ -57,6 +57,9 @@
  #include <stdio.h>
  #include <stdlib.h>
  #include <stdarg.h>
+ #include <sched.h>
+
+ #include "pts_rendezvous.h"
  
 /********************************************************************************************/
 /******************************   Test framework   *****************************************/
@@ -122,6 +125,7 @@ pthread_mutexattr_t ma[5];
 typedef struct _td
 {
 	pthread_t child;
+	volatile pid_t tid; /* Kernel id of the child, published when it starts */
 	int id;
 	pthread_mutex_t mtx;
 	int error;
@@ -164,6 +168,8 @@ void * threaded(void * arg)
 	int ret_create;
 	pthread_t ch;
 	
+	td->tid = pts_gettid();
+	
 	ret = pthread_mutex_lock(&m);
 	if (ret != 0)
 	{  UNRESOLVED(ret, "Unable to lock 'm' in child");  }
@@ -307,6 +313,7 @@ int main(int argc, char * argv[])
 		}
 		
 		/* We have a new test data structure */
+		tmp->tid = 0;
 		ret = pthread_create(&(tmp->child), &ta, threaded, tmp);
 		if (ret != 0)
 		{
@@ -327,8 +334,10 @@ int main(int argc, char * argv[])
 			ret = pthread_mutex_unlock(&m);
 			if (ret != 0)
 			{  UNRESOLVED(ret, "Unlock 'm' failed in main loop");  }
-			/* Make sure the thread has a chance to run */
-			sched_yield();
+			/* Let the child run until it blocks (in the cond wait, hopefully),
+			   or at least give it a chance to run if we don't know its state */
+			if ((cur->tid <= 0) || (pts_wait_blocked(cur->tid, 1000) == ENOSYS))
+				sched_yield();
 			/* Get m back */
 			ret = pthread_mutex_lock(&m);
 			if (ret != 0)
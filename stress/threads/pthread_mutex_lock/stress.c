@@ -37,6 +37,10 @@
  * -> the whole process stop when receiving signal SIGUSR1. 
  *      This goal is achieved with a "do_it" variable.
  * 
+ * When built with -DLOCK_LATENCY, the time spent acquiring the mutex is
+ * recorded by each worker thread, and the latency percentiles are
+ * reported for each kind of mutex.
+ * 
  * NOTE: With gcc/linux, the flag "-lrt" must be specified at link time.
  */
 
@@ -80,6 +84,7 @@
 /********************************************************************************************/
  #include "testfrmw.h"
  #include "testfrmw.c"
+ #include "pts_histogram.h"
  /* This header is responsible for defining the following macros:
   * UNRESOLVED(ret, descr);  
   *    where descr is a description of the error and ret is an int (error code for example)
@@ -109,6 +114,9 @@
 #endif
 #define N 2  /* N * 10 * 6 * SCALABILITY_FACTOR threads will be created */ 
 
+/* Define LOCK_LATENCY to time each lock operation; this adds two clock
+   readings around every lock, so it is off by default */
+
 /********************************************************************************************/
 /***********************************    Test case   *****************************************/
 /********************************************************************************************/
@@ -118,6 +126,15 @@ int types[]={PTHREAD_MUTEX_NORMAL,
 					PTHREAD_MUTEX_ERRORCHECK,
 					PTHREAD_MUTEX_RECURSIVE,
 					PTHREAD_MUTEX_DEFAULT};
+char * names[]={"Default attributes",
+					"NORMAL",
+					"ERRORCHECK",
+					"RECURSIVE",
+					"DEFAULT",
+					"NULL attributes"};
+#else
+char * names[]={"Default attributes",
+					"NULL attributes"};
 #endif
 
 /* The following type represents the data
@@ -133,6 +150,9 @@ typedef struct
 	int tcnt;	 /* we need to make sure the threads are started before killing 'em */
 	pthread_mutex_t tmtx;
 	unsigned long long sigcnt, opcnt; /* We count every iteration */
+	#ifdef LOCK_LATENCY
+	pts_hist_t * lat;             /* Lock latencies, one histogram per worker thread */
+	#endif
 } cell_t;
 
 pthread_key_t  _c; /* this key will always contain a pointer to the thread's cell */
@@ -225,6 +245,10 @@ void * lockthr(void * arg)
 {
 	int ret;
 	char loc; /* Local value for control */
+	#ifdef LOCK_LATENCY
+	struct timespec ts_ref, ts_fin;
+	pts_hist_t * lat;
+	#endif
 	cell_t * c = (cell_t *)arg;
 	
 	/* Set the thread local data key value (used in the signal handler) */
@@ -232,9 +256,12 @@ void * lockthr(void * arg)
 	if (ret != 0)
 	{  UNRESOLVED(ret, "Unable to assign the thread-local-data key");  }
 	
-	/* Signal we're started */
+	/* Signal we're started, and pick our latency histogram */
 	ret = pthread_mutex_lock(&(c->tmtx));
 	if (ret != 0)  {  UNRESOLVED(ret, "Failed to lock the mutex");  }
+	#ifdef LOCK_LATENCY
+	lat = &(c->lat[c->tcnt]);
+	#endif
 	c->tcnt += 1;
 	ret = pthread_mutex_unlock(&(c->tmtx));
 	if (ret != 0)  {  UNRESOLVED(ret, "Failed to unlock the mutex");  }
@@ -242,9 +269,16 @@ void * lockthr(void * arg)
 	do
 	{
 		/* Lock, control, then unlock */
+		#ifdef LOCK_LATENCY
+		clock_gettime(CLOCK_MONOTONIC, &ts_ref);
+		#endif
 		ret = pthread_mutex_lock(&(c->mtx));
 		if (ret != 0)
 		{  UNRESOLVED(ret, "Mutex lock failed in worker thread");  }
+		#ifdef LOCK_LATENCY
+		clock_gettime(CLOCK_MONOTONIC, &ts_fin);
+		pts_hist_record_ts(lat, &ts_ref, &ts_fin);
+		#endif
 
 		control(c, &loc);
 			
@@ -267,6 +301,10 @@ void * timedlockthr(void * arg)
 	int ret;
 	char loc; /* Local value for control */
 	struct timespec ts;
+	#ifdef LOCK_LATENCY
+	struct timespec ts_ref, ts_fin;
+	pts_hist_t * lat;
+	#endif
 	cell_t * c = (cell_t *)arg;
 	
 	/* Set the thread local data key value (used in the signal handler) */
@@ -274,9 +312,12 @@ void * timedlockthr(void * arg)
 	if (ret != 0)
 	{  UNRESOLVED(ret, "Unable to assign the thread-local-data key");  }
 	
-	/* Signal we're started */
+	/* Signal we're started, and pick our latency histogram */
 	ret = pthread_mutex_lock(&(c->tmtx));
 	if (ret != 0)  {  UNRESOLVED(ret, "Failed to lock the mutex");  }
+	#ifdef LOCK_LATENCY
+	lat = &(c->lat[c->tcnt]);
+	#endif
 	c->tcnt += 1;
 	ret = pthread_mutex_unlock(&(c->tmtx));
 	if (ret != 0)  {  UNRESOLVED(ret, "Failed to unlock the mutex");  }
@@ -284,6 +325,9 @@ void * timedlockthr(void * arg)
 	do
 	{
 		/* Lock, control, then unlock */
+		#ifdef LOCK_LATENCY
+		clock_gettime(CLOCK_MONOTONIC, &ts_ref);
+		#endif
 		do
 		{
 			ret = clock_gettime(CLOCK_REALTIME, &ts);
@@ -294,6 +338,10 @@ void * timedlockthr(void * arg)
 		} while (ret == ETIMEDOUT);
 		if (ret != 0)
 		{  UNRESOLVED(ret, "Timed mutex lock failed in worker thread");  }
+		#ifdef LOCK_LATENCY
+		clock_gettime(CLOCK_MONOTONIC, &ts_fin);
+		pts_hist_record_ts(lat, &ts_ref, &ts_fin);
+		#endif
 					
 		control(c, &loc);
 			
@@ -315,6 +363,10 @@ void * trylockthr(void * arg)
 {
 	int ret;
 	char loc; /* Local value for control */
+	#ifdef LOCK_LATENCY
+	struct timespec ts_ref, ts_fin;
+	pts_hist_t * lat;
+	#endif
 	cell_t * c = (cell_t *)arg;
 	
 	/* Set the thread local data key value (used in the signal handler) */
@@ -322,9 +374,12 @@ void * trylockthr(void * arg)
 	if (ret != 0)
 	{  UNRESOLVED(ret, "Unable to assign the thread-local-data key");  }
 	
-	/* Signal we're started */
+	/* Signal we're started, and pick our latency histogram */
 	ret = pthread_mutex_lock(&(c->tmtx));
 	if (ret != 0)  {  UNRESOLVED(ret, "Failed to lock the mutex");  }
+	#ifdef LOCK_LATENCY
+	lat = &(c->lat[c->tcnt]);
+	#endif
 	c->tcnt += 1;
 	ret = pthread_mutex_unlock(&(c->tmtx));
 	if (ret != 0)  {  UNRESOLVED(ret, "Failed to unlock the mutex");  }
@@ -332,12 +387,19 @@ void * trylockthr(void * arg)
 	do
 	{
 		/* Lock, control, then unlock */
+		#ifdef LOCK_LATENCY
+		clock_gettime(CLOCK_MONOTONIC, &ts_ref);
+		#endif
 		do
 		{
 			ret = pthread_mutex_trylock(&(c->mtx));
 		}  while (ret == EBUSY);
 		if (ret != 0)
 		{  UNRESOLVED(ret, "Mutex lock try failed in worker thread");  }
+		#ifdef LOCK_LATENCY
+		clock_gettime(CLOCK_MONOTONIC, &ts_fin);
+		pts_hist_record_ts(lat, &ts_ref, &ts_fin);
+		#endif
 		
 		control(c, &loc);
 			
@@ -371,6 +433,15 @@ void cell_init(int id, cell_t * c, pthread_mutexattr_t *pma)
 	c->opcnt = 0;
 	c->tcnt = 0;
 	
+	#ifdef LOCK_LATENCY
+	/* Initialize the latency histograms of the 9 worker threads */
+	c->lat = (pts_hist_t *) malloc(9 * sizeof(pts_hist_t));
+	if (c->lat == NULL)
+	{  UNRESOLVED(errno, "Unable to alloc memory for the histograms");  }
+	for (i=0; i<9; i++)
+		pts_hist_init(&(c->lat[i]));
+	#endif
+	
 	/* Initialize the mutex */
 	ret = pthread_mutex_init(&(c->tmtx), NULL); 
 	if (ret != 0)
@@ -449,7 +520,8 @@ void cell_fini(
 				int id, 
 				cell_t * c, 
 				unsigned long long * globalopcount,
-				unsigned long long * globalsigcount  )
+				unsigned long long * globalsigcount,
+				pts_hist_t * globallat  )
 {
 	int ret, i;
 	
@@ -483,6 +555,11 @@ void cell_fini(
 	/* Report the cell counters */
 	*globalopcount += c->opcnt;
 	*globalsigcount += c->sigcnt;
+	#ifdef LOCK_LATENCY
+	for (i=0; i<9; i++)
+		pts_hist_merge(globallat, &(c->lat[i]));
+	free(c->lat);
+	#endif
 	#if VERBOSE > 1
 	output("Counters for cell %i:\n\t%llu locks and unlocks\n\t%llu signals\n",
 	                   id,
@@ -530,6 +607,9 @@ int main(int argc, char * argv[])
 	pthread_mutexattr_t *pma[sz];
 	
 	cell_t data[sz * N * SCALABILITY_FACTOR];
+	#ifdef LOCK_LATENCY
+	pts_hist_t lat[sz]; /* Lock latencies for each kind of mutex */
+	#endif
 	
 	pma[sz-1] = NULL;
 	
@@ -599,8 +679,15 @@ int main(int argc, char * argv[])
 	output("Starting to join the threads...\n");
 	#endif
 	/* Everybody is stopping, we must join them, and destroy the cell data */
+	#ifdef LOCK_LATENCY
+	for (i=0; i<sz; i++)
+		pts_hist_init(&lat[i]);
+	for (i=0; i< sz * N * SCALABILITY_FACTOR; i++)
+		cell_fini(i, &data[i], &globopcnt, &globsigcnt, &lat[i % sz]);
+	#else
 	for (i=0; i< sz * N * SCALABILITY_FACTOR; i++)
-		cell_fini(i, &data[i], &globopcnt, &globsigcnt);
+		cell_fini(i, &data[i], &globopcnt, &globsigcnt, NULL);
+	#endif
 	
 	/* Destroy the mutex attributes objects */
 	for (i=0; i<sz-1; i++)
@@ -626,6 +713,11 @@ int main(int argc, char * argv[])
 	output("Total counters:\n\t%llu locks and unlocks\n\t%llu signals\n",
 	                   globopcnt,
 	                   globsigcnt);
+	#ifdef LOCK_LATENCY
+	output("Lock latencies:\n");
+	for (i=0; i<sz; i++)
+		pts_hist_report(names[i], &lat[i]);
+	#endif
 	output("pthread_mutex_lock stress test passed.\n");
 	#endif
 
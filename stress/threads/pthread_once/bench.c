@@ -0,0 +1,418 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+
+
+ * This file is a benchmark for the pthread_once function.
+ * It measures the cost of the calls once the routine has run, and the
+ * delays when several threads race on an uninitialized pthread_once_t.
+
+ * The steps are:
+ * -> Fast path: for 1, 2, ... N threads (N is the # of processors, at
+ *    least 2), each thread calls LOOPS times pthread_once on a control
+ *    which is already initialized. We report the mean cost of a call
+ *    and the total # of calls per second.
+ * -> Race: for 2, 4, ... N threads, ROUNDS times, the threads are started
+ *    together on a new control, and the init routine busy-waits INIT_NS ns.
+ *    We report (p50, p99 and max):
+ *    -> the delay between the end of the init routine and the return of
+ *       the last thread from pthread_once;
+ *    -> the delay between the start and the return of the last thread.
+ * -> Cancellation: for 1, 2, ... N waiting threads, ROUNDS times, a thread
+ *    calls pthread_once on a new control, and is canceled while its init
+ *    routine sleeps, once the waiters are blocked in pthread_once (see
+ *    pts_rendezvous.h). Another thread must then run the init routine.
+ *    We report the delay between pthread_cancel and the start of the
+ *    second init routine (p50, p99 and max).
+ * -> The test fails if an init routine completes more than once for a
+ *    control, or if no thread takes over a canceled init routine.
+ */
+
+ /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
+ #define _POSIX_C_SOURCE 200112L
+
+/********************************************************************************************/
+/****************************** standard includes *****************************************/
+/********************************************************************************************/
+ #include <pthread.h>
+ #include <errno.h>
+ #include <unistd.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <stdarg.h>
+ #include <sched.h>
+
+/********************************************************************************************/
+/******************************   Test framework   *****************************************/
+/********************************************************************************************/
+ #include "testfrmw.h"
+ #include "testfrmw.c"
+ #include "pts_bench.h"
+ #include "pts_histogram.h"
+ #include "pts_rendezvous.h"
+ /* testfrmw.h gives UNRESOLVED, FAILED and PASSED, which end the process,
+  * and output(); pts_bench.h gives the clock, start gate and run routines. */
+
+/********************************************************************************************/
+/********************************** Configuration ******************************************/
+/********************************************************************************************/
+#ifndef SCALABILITY_FACTOR
+#define SCALABILITY_FACTOR 1
+#endif
+#ifndef VERBOSE
+#define VERBOSE 1
+#endif
+
+/* # of calls per thread on the fast path */
+#ifndef LOOPS
+#define LOOPS (2000000 * SCALABILITY_FACTOR)
+#endif
+
+/* # of new controls for each race and cancellation case */
+#ifndef ROUNDS
+#define ROUNDS (200 * SCALABILITY_FACTOR)
+#endif
+
+/* Duration of the init routine in the race cases, in ns */
+#ifndef INIT_NS
+#define INIT_NS 10000
+#endif
+
+#ifdef PLOT_OUTPUT
+#undef VERBOSE
+#define VERBOSE 0
+#endif
+
+/********************************************************************************************/
+/***********************************    Test case   *****************************************/
+/********************************************************************************************/
+
+pthread_once_t once;
+pts_gate_t gate;
+
+/* The data of each thread */
+typedef struct
+{
+	pthread_t th;                /* cancellation: a waiter */
+	volatile pid_t tid;          /* cancellation: its kernel id, 0 until known */
+	unsigned long long elapsed;  /* fast path: ns for LOOPS calls */
+	unsigned long long ret;      /* race: time of the return from pthread_once */
+} result_t;
+
+result_t * res;
+
+/* Updated by the init routines, under this mutex */
+pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+int started;      /* # of init routines started for the current control */
+int completed;    /* # of init routines completed for the current control */
+unsigned long long init_end;    /* time of the end of the init routine */
+unsigned long long init_start;  /* time of the start of the last init routine */
+
+void count(int * c, unsigned long long * t)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex lock failed");  }
+	(*c)++;
+	if (t != NULL)
+		*t = pts_now_ns();
+	ret = pthread_mutex_unlock(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Mutex unlock failed");  }
+}
+
+void init_noop(void)
+{
+	count(&started, NULL);
+	count(&completed, NULL);
+}
+
+void init_busy(void)
+{
+	count(&started, NULL);
+	pts_spin_ns(INIT_NS);
+	count(&completed, &init_end);
+}
+
+/* The first call blocks in a cancellation point; the next ones complete */
+void init_cancel(void)
+{
+	count(&started, &init_start);
+	if (started == 1)
+	{
+		for (;;)
+			pts_sleep_ms(1000);
+	}
+	count(&completed, NULL);
+}
+
+void * fast(void * arg)
+{
+	int ret, i;
+	long id = (long)arg;
+	unsigned long long t0;
+
+	ret = pts_gate_ready(&gate);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to wait for the start");  }
+
+	t0 = pts_now_ns();
+	for (i=0; i<LOOPS; i++)
+	{
+		ret = pthread_once(&once, init_noop);
+		if (ret != 0)  {  UNRESOLVED(ret, "pthread_once failed");  }
+	}
+	res[id].elapsed = pts_now_ns() - t0;
+
+	return NULL;
+}
+
+void * racer(void * arg)
+{
+	int ret;
+	long id = (long)arg;
+
+	ret = pts_gate_ready(&gate);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to wait for the start");  }
+
+	ret = pthread_once(&once, init_busy);
+	if (ret != 0)  {  UNRESOLVED(ret, "pthread_once failed");  }
+	res[id].ret = pts_now_ns();
+
+	return NULL;
+}
+
+void * canceled(void * arg)
+{
+	int ret;
+
+	ret = pthread_once(&once, init_cancel);
+	if (ret != 0)  {  UNRESOLVED(ret, "pthread_once failed");  }
+
+	return NULL;
+}
+
+void * waiter(void * arg)
+{
+	long id = (long)arg;
+
+	res[id].tid = pts_gettid();
+	return canceled(NULL);
+}
+
+/* Start n threads of fn together; returns the opening time of the gate */
+unsigned long long run(int n, void * (*fn)(void *))
+{
+	int ret;
+	unsigned long long t0;
+
+	ret = pts_bench_run(&gate, n, fn, NULL, 0, 0, &t0, NULL);
+	if (ret != 0)  {  UNRESOLVED(ret, "Unable to run the threads");  }
+
+	return t0;
+}
+
+/* A new control for each round */
+void reset(void)
+{
+	pthread_once_t o = PTHREAD_ONCE_INIT;
+
+	once = o;
+	started = 0;
+	completed = 0;
+}
+
+void check(int n)
+{
+	if (completed != 1)
+	{
+		output("%i init routines completed (%i started) with %i threads\n", completed, started, n);
+		FAILED("The init routine did not complete exactly once");
+	}
+}
+
+void race_case(int n)
+{
+	int i, r;
+	unsigned long long t0, last;
+	pts_hist_t * rel, * tot;
+
+	rel = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+	tot = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+	if ((rel == NULL) || (tot == NULL))  {  UNRESOLVED(errno, "Unable to alloc memory for the histograms");  }
+	pts_hist_init(rel);
+	pts_hist_init(tot);
+
+	for (r=0; r<ROUNDS; r++)
+	{
+		reset();
+		t0 = run(n, racer);
+		check(n);
+
+		last = 0;
+		for (i=0; i<n; i++)
+			if (res[i].ret > last)
+				last = res[i].ret;
+		pts_hist_record(rel, (last > init_end) ? last - init_end : 0);
+		pts_hist_record(tot, (last > t0) ? last - t0 : 0);
+	}
+
+	#ifdef PLOT_OUTPUT
+	printf("# Race %i %llu %llu %llu %llu %llu %llu\n", n,
+	       pts_hist_percentile(rel, 50.0), pts_hist_percentile(rel, 99.0), rel->max,
+	       pts_hist_percentile(tot, 50.0), pts_hist_percentile(tot, 99.0), tot->max);
+	#endif
+	#if VERBOSE > 0
+	output("%7i %10llu %10llu %10llu %10llu %10llu %10llu\n", n,
+	       pts_hist_percentile(rel, 50.0), pts_hist_percentile(rel, 99.0), rel->max,
+	       pts_hist_percentile(tot, 50.0), pts_hist_percentile(tot, 99.0), tot->max);
+	#endif
+
+	free(rel);
+	free(tot);
+}
+
+void cancel_case(int n)
+{
+	int ret, i, r;
+	pthread_t victim;
+	void * thret;
+	unsigned long long t0;
+	pts_hist_t * lat;
+
+	lat = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+	if (lat == NULL)  {  UNRESOLVED(errno, "Unable to alloc memory for the histogram");  }
+	pts_hist_init(lat);
+
+	for (r=0; r<ROUNDS; r++)
+	{
+		reset();
+
+		ret = pthread_create(&victim, NULL, canceled, NULL);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to create a thread");  }
+		while (started == 0)
+			pts_sleep_ms(1);
+
+		/* The waiters block in pthread_once behind the sleeping init routine */
+		for (i=0; i<n; i++)
+		{
+			res[i].tid = 0;
+			ret = pthread_create(&res[i].th, NULL, waiter, (void *)(long)i);
+			if (ret != 0)  {  UNRESOLVED(ret, "Unable to create a thread");  }
+		}
+
+		/* A late waiter would make the delay include its start-up */
+		for (i=0; i<n; i++)
+		{
+			while (res[i].tid == 0)
+				sched_yield();
+			ret = pts_wait_blocked(res[i].tid, 1000);
+			if (ret == ENOSYS)
+			{
+				pts_sleep_ms(1);
+				break;
+			}
+			if (ret != 0)  {  UNRESOLVED(ret, "A waiter did not block in pthread_once");  }
+		}
+
+		t0 = pts_now_ns();
+		ret = pthread_cancel(victim);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to cancel the thread");  }
+		ret = pthread_join(victim, &thret);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to join a thread");  }
+		if (thret != PTHREAD_CANCELED)  {  FAILED("The thread in the init routine was not canceled");  }
+
+		for (i=0; i<n; i++)
+		{
+			ret = pthread_join(res[i].th, NULL);
+			if (ret != 0)  {  UNRESOLVED(ret, "Unable to join a thread");  }
+		}
+
+		check(n);
+		if (started != 2)
+		{
+			output("%i init routines started with %i waiters\n", started, n);
+			FAILED("The canceled init routine was not taken over by a single thread");
+		}
+		pts_hist_record(lat, (init_start > t0) ? init_start - t0 : 0);
+	}
+
+	#ifdef PLOT_OUTPUT
+	printf("# Cancel %i %llu %llu %llu\n", n,
+	       pts_hist_percentile(lat, 50.0), pts_hist_percentile(lat, 99.0), lat->max);
+	#endif
+	#if VERBOSE > 0
+	output("%7i %10llu %10llu %10llu\n", n,
+	       pts_hist_percentile(lat, 50.0), pts_hist_percentile(lat, 99.0), lat->max);
+	#endif
+
+	free(lat);
+}
+
+int main(int argc, char * argv[])
+{
+	int max, n, i;
+	unsigned long long sum;
+
+	output_init();
+
+	max = pts_max_threads(1);
+
+	res = (result_t *) calloc(max, sizeof(result_t));
+	if (res == NULL)  {  UNRESOLVED(errno, "Unable to alloc memory");  }
+
+	#ifdef PLOT_OUTPUT
+	printf("# COLUMNS 3 Threads ns/call Calls/s\n");
+	#endif
+	#if VERBOSE > 0
+	output("pthread_once benchmark: up to %i threads\n", max);
+	output("Fast path, %i calls per thread\n", LOOPS);
+	output("%7s %10s %14s\n", "Threads", "ns/call", "Calls/s");
+	#endif
+
+	/* Fast path */
+	reset();
+	for (n = 1; n != 0; n = pts_next_count(n, max))
+	{
+		run(n, fast);
+		check(n);
+
+		sum = 0;
+		for (i=0; i<n; i++)
+			sum += res[i].elapsed;
+
+		#ifdef PLOT_OUTPUT
+		printf("%i %.2f %.0f\n", n, (double) sum / ((double) n * LOOPS),
+		       (double) n * LOOPS * 1000000000.0 / ((double) sum / n));
+		#endif
+		#if VERBOSE > 0
+		output("%7i %10.2f %14.0f\n", n, (double) sum / ((double) n * LOOPS),
+		       (double) n * LOOPS * 1000000000.0 / ((double) sum / n));
+		#endif
+	}
+
+	/* Race on a new control */
+	#if VERBOSE > 0
+	output("\nRace on a new control, %i rounds, %i ns init routine (ns)\n", ROUNDS, INIT_NS);
+	output("%7s %10s %10s %10s %10s %10s %10s\n", "Threads",
+	       "Rel-p50", "Rel-p99", "Rel-max", "Total-p50", "Total-p99", "Total-max");
+	#endif
+	for (n = 2; n != 0; n = pts_next_count(n, max))
+		race_case(n);
+
+	/* Cancellation of the init routine */
+	#if VERBOSE > 0
+	output("\nCancellation in the init routine, %i rounds (ns)\n", ROUNDS);
+	output("%7s %10s %10s %10s\n", "Waiters", "Take-p50", "Take-p99", "Take-max");
+	#endif
+	for (n = 1; n != 0; n = pts_next_count(n, max))
+		cancel_case(n);
+
+	free(res);
+
+	#if VERBOSE > 0
+	output("pthread_once benchmark done.\n");
+	#endif
+
+	PASSED;
+}
@@ -0,0 +1,296 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+
+
+ * This file is a benchmark for the pthread_rwlock_rdlock and
+ * pthread_rwlock_wrlock functions.
+ * It measures how the readers scale, and how long the writers wait.
+
+ * The steps are:
+ * -> For each kind of lock (rwlock, and a mutex as a baseline),
+ *    for each read/write ratio in wr_permil[],
+ *    and for 1, 2, 4, ... N threads (N is the # of processors, at least 2),
+ *    the threads loop during DURATION ms:
+ *          {
+ *               pick read or write according to the ratio
+ *               read:  rdlock, check that the table is consistent, unlock
+ *               write: wrlock, update the whole table, unlock
+ *          }
+ * -> For each run we report:
+ *    -> the # of operations per second, and the # of reads per second;
+ *    -> the read rate relative to the same case with 1 thread;
+ *    -> the time the writers waited for the lock (p99 and max).
+ * -> The test fails if a reader ever sees a table being updated.
+ */
+
+ /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
+ #define _POSIX_C_SOURCE 200112L
+
+/********************************************************************************************/
+/****************************** standard includes *****************************************/
+/********************************************************************************************/
+ #include <pthread.h>
+ #include <errno.h>
+ #include <unistd.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <stdarg.h>
+ #include <time.h>
+
+/********************************************************************************************/
+/******************************   Test framework   *****************************************/
+/********************************************************************************************/
+ #include "testfrmw.h"
+ #include "testfrmw.c"
+ #include "pts_bench.h"
+ #include "pts_histogram.h"
+ /* testfrmw.h gives UNRESOLVED, FAILED and PASSED, which end the process,
+  * and output(); pts_bench.h gives the clock, start gate and run routines. */
+
+/********************************************************************************************/
+/********************************** Configuration ******************************************/
+/********************************************************************************************/
+#ifndef SCALABILITY_FACTOR
+#define SCALABILITY_FACTOR 1
+#endif
+#ifndef VERBOSE
+#define VERBOSE 1
+#endif
+
+/* Duration of each run, in ms */
+#ifndef DURATION
+#define DURATION (250 * SCALABILITY_FACTOR)
+#endif
+
+#ifdef PLOT_OUTPUT
+#undef VERBOSE
+#define VERBOSE 0
+#endif
+
+/********************************************************************************************/
+/***********************************    Test case   *****************************************/
+/********************************************************************************************/
+
+/* Writes per 1000 operations: 100/0, 99/1, 90/10 and 50/50 */
+int wr_permil[] = { 0, 10, 100, 500 };
+#define NRATIOS (sizeof(wr_permil) / sizeof(wr_permil[0]))
+
+#define LOCK_RWLOCK 0
+#define LOCK_MUTEX  1
+char * names[] = { "rwlock", "mutex" };
+
+/* The protected data: a reader shall always see all the cells equal */
+#define TABLE_SIZE 16
+volatile unsigned long table[TABLE_SIZE];
+
+/* The data of each thread */
+typedef struct
+{
+	unsigned int seed;
+	unsigned long long reads, writes;
+	pts_hist_t * wrwait;      /* time spent waiting for the write lock */
+	char pad[PTS_CACHE_LINE];
+} thread_t;
+
+/* The data shared by the threads of a run */
+pthread_rwlock_t rwl;
+pthread_mutex_t mtx;
+pts_gate_t gate;
+int lock_kind;
+int permil;
+
+void rd_lock(void)
+{
+	int ret;
+
+	if (lock_kind == LOCK_RWLOCK)
+		ret = pthread_rwlock_rdlock(&rwl);
+	else
+		ret = pthread_mutex_lock(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to lock for reading");  }
+}
+
+void wr_lock(void)
+{
+	int ret;
+
+	if (lock_kind == LOCK_RWLOCK)
+		ret = pthread_rwlock_wrlock(&rwl);
+	else
+		ret = pthread_mutex_lock(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to lock for writing");  }
+}
+
+void un_lock(void)
+{
+	int ret;
+
+	if (lock_kind == LOCK_RWLOCK)
+		ret = pthread_rwlock_unlock(&rwl);
+	else
+		ret = pthread_mutex_unlock(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to unlock");  }
+}
+
+void * worker(void * arg)
+{
+	int ret, i;
+	unsigned long v;
+	unsigned long long t0;
+	thread_t * me = (thread_t *)arg;
+
+	ret = pts_gate_ready(&gate);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to wait at the start gate");  }
+
+	while (!pts_gate_closed(&gate))
+	{
+		/* xorshift */
+		me->seed ^= me->seed << 13;
+		me->seed ^= me->seed >> 17;
+		me->seed ^= me->seed << 5;
+
+		if ((int) (me->seed % 1000) < permil)
+		{
+			t0 = pts_now_ns();
+			wr_lock();
+			pts_hist_record(me->wrwait, pts_now_ns() - t0);
+
+			v = table[0] + 1;
+			for (i=0; i<TABLE_SIZE; i++)
+				table[i] = v;
+
+			un_lock();
+			me->writes++;
+		}
+		else
+		{
+			rd_lock();
+
+			v = table[0];
+			for (i=1; i<TABLE_SIZE; i++)
+				if (table[i] != v)
+				{  FAILED("A reader saw the data while it was being written");  }
+
+			un_lock();
+			me->reads++;
+		}
+	}
+
+	return NULL;
+}
+
+/* Run the n threads; returns the read rate */
+double run(int n, thread_t * th, double ref)
+{
+	int ret, i;
+	unsigned long long start, end, reads, writes;
+	pts_hist_t wrwait;
+	double rate, rdrate;
+
+	if (lock_kind == LOCK_RWLOCK)
+		ret = pthread_rwlock_init(&rwl, NULL);
+	else
+		ret = pthread_mutex_init(&mtx, NULL);
+	if (ret != 0)  {  UNRESOLVED(ret, "Lock init failed");  }
+
+	for (i=0; i<n; i++)
+	{
+		th[i].seed = 2463534242U + i;
+		th[i].reads = 0;
+		th[i].writes = 0;
+		pts_hist_init(th[i].wrwait);
+	}
+
+	ret = pts_bench_run(&gate, n, worker, th, sizeof(thread_t), DURATION, &start, &end);
+	if (ret != 0)  {  UNRESOLVED(ret, "Unable to run the worker threads");  }
+
+	pts_hist_init(&wrwait);
+	reads = writes = 0;
+	for (i=0; i<n; i++)
+	{
+		reads += th[i].reads;
+		writes += th[i].writes;
+		pts_hist_merge(&wrwait, th[i].wrwait);
+	}
+
+	if (lock_kind == LOCK_RWLOCK)
+		ret = pthread_rwlock_destroy(&rwl);
+	else
+		ret = pthread_mutex_destroy(&mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Lock destroy failed");  }
+
+	rate = (double) (reads + writes) * 1000000000.0 / (double) (end - start);
+	rdrate = (double) reads * 1000000000.0 / (double) (end - start);
+	if (ref == 0.0)
+		ref = rdrate;
+
+	#ifdef PLOT_OUTPUT
+	printf("%i %i %i %.0f %.0f %.3f %llu %llu\n", lock_kind, n, permil / 10,
+	       rate, rdrate, (ref > 0.0) ? rdrate / ref : 0.0,
+	       pts_hist_percentile(&wrwait, 99.0), wrwait.max);
+	#endif
+	#if VERBOSE > 0
+	output("%-6s %7i %4i/%-3i %12.0f %12.0f %8.3f %12llu %12llu\n", names[lock_kind], n,
+	       100 - permil / 10, permil / 10,
+	       rate, rdrate, (ref > 0.0) ? rdrate / ref : 0.0,
+	       pts_hist_percentile(&wrwait, 99.0), wrwait.max);
+	#endif
+
+	return rdrate;
+}
+
+int main(int argc, char * argv[])
+{
+	int max, n;
+	unsigned int r, i;
+	double ref, rdrate;
+	thread_t * th;
+
+	output_init();
+
+	max = pts_max_threads(1);
+
+	th = (thread_t *) calloc(max, sizeof(thread_t));
+	if (th == NULL)  {  UNRESOLVED(errno, "Unable to alloc memory for the threads");  }
+	for (i=0; i<(unsigned)max; i++)
+	{
+		th[i].wrwait = (pts_hist_t *) malloc(sizeof(pts_hist_t));
+		if (th[i].wrwait == NULL)  {  UNRESOLVED(errno, "Unable to alloc memory for the histograms");  }
+	}
+
+	#ifdef PLOT_OUTPUT
+	printf("# COLUMNS 8 Lock Threads Write%% Ops/s Reads/s Read-scaling Wr-wait-p99(ns) Wr-wait-max(ns)\n");
+	#endif
+	#if VERBOSE > 0
+	output("Rwlock benchmark: %i ms per run, up to %i threads\n", DURATION, max);
+	output("%-6s %7s %8s %12s %12s %8s %12s %12s\n", "Lock", "Threads", "R/W", "Ops/s", "Reads/s",
+	       "Scaling", "Wr-wait-p99", "Wr-wait-max");
+	#endif
+
+	for (r=0; r<NRATIOS; r++)
+	{
+		permil = wr_permil[r];
+		for (lock_kind = LOCK_RWLOCK; lock_kind <= LOCK_MUTEX; lock_kind++)
+		{
+			ref = 0.0;
+			for (n = 1; n != 0; n = pts_next_count(n, max))
+			{
+				rdrate = run(n, th, ref);
+				if (ref == 0.0)
+					ref = rdrate; /* The reference is the 1 thread case */
+			}
+		}
+	}
+
+	for (i=0; i<(unsigned)max; i++)
+		free(th[i].wrwait);
+	free(th);
+
+	#if VERBOSE > 0
+	output("pthread_rwlock benchmark done.\n");
+	#endif
+
+	PASSED;
+}
@@ -0,0 +1,391 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+
+
+ * This file is a benchmark comparing the pthread_spin_lock and
+ * pthread_mutex_lock functions.
+ * It looks for the critical section length and # of threads above
+ * which a spinlock stops being faster than a mutex.
+
+ * The steps are:
+ * -> For each sharing mode:
+ *    -> private: the workers are threads of this process;
+ *    -> pshared: the workers are processes, and the locks are
+ *       PTHREAD_PROCESS_SHARED objects in shm_open memory;
+ *    for each critical section length in cs_len[],
+ *    and for 1, 2, 4, ... 2 * N workers (N is the # of processors, so
+ *    the last cases are oversubscribed),
+ *    -> the workers loop during DURATION ms on a spinlock:
+ *          {
+ *               spin_lock
+ *               check that no other worker is in the critical section
+ *               work for the critical section length
+ *               spin_unlock
+ *          }
+ *    -> then the same on a mutex.
+ * -> For each case we report both rates and which lock won, then the
+ *    map of the winners for each sharing mode.
+ * -> The test fails if two workers are ever in the critical section.
+ */
+
+ /* We are testing conformance to IEEE Std 1003.1, 2003 Edition */
+ #define _POSIX_C_SOURCE 200112L
+
+/********************************************************************************************/
+/****************************** standard includes *****************************************/
+/********************************************************************************************/
+ #include <pthread.h>
+ #include <errno.h>
+ #include <unistd.h>
+ #include <stdio.h>
+ #include <stdlib.h>
+ #include <stdarg.h>
+ #include <string.h>
+ #include <time.h>
+ #include <sched.h>
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <sys/wait.h>
+
+/********************************************************************************************/
+/******************************   Test framework   *****************************************/
+/********************************************************************************************/
+ #include "testfrmw.h"
+ #include "testfrmw.c"
+ #include "pts_bench.h"
+ /* testfrmw.h gives UNRESOLVED, FAILED and PASSED, which end the process,
+  * and output(); pts_bench.h gives the clock, start gate and run routines. */
+
+/********************************************************************************************/
+/********************************** Configuration ******************************************/
+/********************************************************************************************/
+#ifndef SCALABILITY_FACTOR
+#define SCALABILITY_FACTOR 1
+#endif
+#ifndef VERBOSE
+#define VERBOSE 1
+#endif
+
+/* Duration of each run, in ms */
+#ifndef DURATION
+#define DURATION (200 * SCALABILITY_FACTOR)
+#endif
+
+#ifdef PLOT_OUTPUT
+#undef VERBOSE
+#define VERBOSE 0
+#endif
+
+/********************************************************************************************/
+/***********************************    Test case   *****************************************/
+/********************************************************************************************/
+
+/* Critical section lengths, in ns */
+unsigned long long cs_len[] = { 0, 100, 500, 2000, 10000 };
+#define NCS (sizeof(cs_len) / sizeof(cs_len[0]))
+
+#define LOCK_SPIN  0
+#define LOCK_MUTEX 1
+
+char * modes[] = { "private", "pshared" };
+
+/* The data shared by the workers; it lives in shm_open memory */
+typedef struct
+{
+	pthread_spinlock_t spin;
+	pthread_mutex_t mtx;
+	pthread_mutex_t gate;    /* protects ready */
+	volatile int ready;      /* # of workers ready to start */
+	volatile int start;
+	volatile int stop;
+	volatile int inside;     /* !0 while a worker is in the critical section */
+	int kind;                /* LOCK_SPIN or LOCK_MUTEX */
+	unsigned long long cs;   /* critical section length */
+	struct
+	{
+		unsigned long long ops;
+		char pad[PTS_CACHE_LINE - sizeof(unsigned long long)];
+	} cnt[];                 /* one per worker */
+} shared_t;
+
+shared_t * sh;
+
+void lock(void)
+{
+	int ret;
+
+	if (sh->kind == LOCK_SPIN)
+		ret = pthread_spin_lock(&sh->spin);
+	else
+		ret = pthread_mutex_lock(&sh->mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to lock");  }
+}
+
+void unlock(void)
+{
+	int ret;
+
+	if (sh->kind == LOCK_SPIN)
+		ret = pthread_spin_unlock(&sh->spin);
+	else
+		ret = pthread_mutex_unlock(&sh->mtx);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to unlock");  }
+}
+
+void * worker(void * arg)
+{
+	int ret;
+	long id = (long)arg;
+	unsigned long long t0;
+
+	ret = pthread_mutex_lock(&sh->gate);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to lock the gate");  }
+	sh->ready++;
+	ret = pthread_mutex_unlock(&sh->gate);
+	if (ret != 0)  {  UNRESOLVED(ret, "Failed to unlock the gate");  }
+
+	while (!sh->start)
+		sched_yield();
+
+	while (!sh->stop)
+	{
+		lock();
+
+		if (sh->inside != 0)
+		{
+			/* A worker process exits with the lock held: release it,
+			   or the other workers would spin on it forever */
+			sh->stop = 1;
+			unlock();
+			FAILED("Two workers are in the critical section");
+		}
+		sh->inside = 1;
+
+		/* Work in the critical section */
+		t0 = pts_now_ns();
+		while (pts_now_ns() < t0 + sh->cs)
+			;
+
+		sh->inside = 0;
+
+		unlock();
+
+		sh->cnt[id].ops++;
+	}
+
+	return NULL;
+}
+
+/* Run n workers on the current lock; returns the # of operations per second */
+double run(int pshared, int n, pthread_t * th, pid_t * pr)
+{
+	int ret, i, status;
+	unsigned long long start, end, total;
+
+	sh->ready = 0;
+	sh->start = 0;
+	sh->stop = 0;
+	sh->inside = 0;
+
+	/* Do not duplicate the pending output in the children */
+	fflush(stdout);
+
+	for (i=0; i<n; i++)
+	{
+		sh->cnt[i].ops = 0;
+
+		if (!pshared)
+		{
+			ret = pthread_create(&th[i], NULL, worker, (void *)(long)i);
+			if (ret != 0)  {  UNRESOLVED(ret, "Unable to create a worker thread");  }
+			continue;
+		}
+
+		pr[i] = fork();
+		if (pr[i] == (pid_t) -1)  {  UNRESOLVED(errno, "Unable to fork a worker process");  }
+		if (pr[i] == 0)
+		{
+			worker((void *)(long)i);
+			exit(PTS_PASS);
+		}
+	}
+
+	/* Wait for all the workers */
+	while (sh->ready < n)
+		pts_sleep_ms(1);
+
+	sh->start = 1;
+	start = pts_now_ns();
+
+	pts_sleep_ms(DURATION);
+
+	sh->stop = 1;
+	end = pts_now_ns();
+
+	total = 0;
+	for (i=0; i<n; i++)
+	{
+		if (!pshared)
+		{
+			ret = pthread_join(th[i], NULL);
+			if (ret != 0)  {  UNRESOLVED(ret, "Unable to join a thread");  }
+		}
+		else
+		{
+			if (waitpid(pr[i], &status, 0) != pr[i])
+			{  UNRESOLVED(errno, "Waitpid returned the wrong PID");  }
+			if (!WIFEXITED(status))
+			{  UNRESOLVED(-1, "A worker process was killed");  }
+			if (WEXITSTATUS(status) == PTS_FAIL)
+			{  FAILED("Two workers are in the critical section");  }
+			if (WEXITSTATUS(status) != PTS_PASS)
+			{  UNRESOLVED(WEXITSTATUS(status), "A worker process failed");  }
+		}
+		total += sh->cnt[i].ops;
+	}
+
+	return (double) total * 1000000000.0 / (double) (end - start);
+}
+
+int main(int argc, char * argv[])
+{
+	int ret, max, n, pshared, nn, k, fd;
+	unsigned int c;
+	size_t sz;
+	char name[64];
+	char line[256];
+	double rate[2];
+	char * map; /* winners, see MAP() */
+	pthread_mutexattr_t ma;
+	pthread_t * th;
+	pid_t * pr;
+
+	output_init();
+
+	max = pts_max_threads(2);
+
+	/* # of values of n */
+	nn = 0;
+	for (n = 1; n != 0; n = pts_next_count(n, max))
+		nn++;
+	#define MAP(p, k, c) map[((p) * nn + (k)) * NCS + (c)]
+
+	th = (pthread_t *) calloc(max, sizeof(pthread_t));
+	pr = (pid_t *) calloc(max, sizeof(pid_t));
+	map = (char *) calloc(2 * nn * NCS, 1);
+	if ((th == NULL) || (pr == NULL) || (map == NULL))
+	{  UNRESOLVED(errno, "Unable to alloc memory");  }
+
+	/* The shared memory */
+	snprintf(name, sizeof(name), "/pts_spin_bench_%ld", (long) getpid());
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if (fd == -1)  {  UNRESOLVED(errno, "Unable to open shared memory");  }
+	shm_unlink(name);
+
+	sz = sizeof(shared_t) + max * sizeof(sh->cnt[0]);
+	if (ftruncate(fd, sz) != 0)  {  UNRESOLVED(errno, "Unable to size shared memory");  }
+	sh = (shared_t *) mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (sh == MAP_FAILED)  {  UNRESOLVED(errno, "Unable to map shared memory");  }
+	close(fd);
+
+	#ifdef PLOT_OUTPUT
+	printf("# COLUMNS 6 Pshared Threads CS(ns) Spin-ops/s Mutex-ops/s Spin/Mutex\n");
+	#endif
+	#if VERBOSE > 0
+	output("Spinlock / mutex benchmark: %i ms per run, up to %i workers on %li CPUs\n",
+	       DURATION, max, pts_ncpus());
+	output("%-8s %7s %7s %12s %12s %10s %s\n", "Mode", "Workers", "CS(ns)", "Spin-ops/s",
+	       "Mutex-ops/s", "Spin/Mutex", "Winner");
+	#endif
+
+	for (pshared = 0; pshared <= 1; pshared++)
+	{
+		if (pshared && (sysconf(_SC_THREAD_PROCESS_SHARED) <= 0))
+		{
+			output("Process-shared primitives are not supported, skipping\n");
+			break;
+		}
+
+		ret = pthread_spin_init(&sh->spin, pshared ? PTHREAD_PROCESS_SHARED : PTHREAD_PROCESS_PRIVATE);
+		if (ret != 0)  {  UNRESOLVED(ret, "Spinlock init failed");  }
+
+		ret = pthread_mutexattr_init(&ma);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to init a mutex attribute object");  }
+		if (pshared)
+		{
+			ret = pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+			if (ret != 0)  {  UNRESOLVED(ret, "Unable to set the mutex process-shared");  }
+		}
+		ret = pthread_mutex_init(&sh->mtx, &ma);
+		if (ret != 0)  {  UNRESOLVED(ret, "Mutex init failed");  }
+		ret = pthread_mutex_init(&sh->gate, &ma);
+		if (ret != 0)  {  UNRESOLVED(ret, "Mutex init failed");  }
+		ret = pthread_mutexattr_destroy(&ma);
+		if (ret != 0)  {  UNRESOLVED(ret, "Unable to destroy a mutex attribute object");  }
+
+		for (c=0; c<NCS; c++)
+		{
+			sh->cs = cs_len[c];
+			for (n = 1, k = 0; n != 0; n = pts_next_count(n, max), k++)
+			{
+				sh->kind = LOCK_SPIN;
+				rate[LOCK_SPIN] = run(pshared, n, th, pr);
+				sh->kind = LOCK_MUTEX;
+				rate[LOCK_MUTEX] = run(pshared, n, th, pr);
+
+				MAP(pshared, k, c) = (rate[LOCK_SPIN] > rate[LOCK_MUTEX]) ? 'S' : 'M';
+
+				#ifdef PLOT_OUTPUT
+				printf("%i %i %llu %.0f %.0f %.3f\n", pshared, n, sh->cs,
+				       rate[LOCK_SPIN], rate[LOCK_MUTEX], rate[LOCK_SPIN] / rate[LOCK_MUTEX]);
+				#endif
+				#if VERBOSE > 0
+				output("%-8s %7i %7llu %12.0f %12.0f %10.3f %s%s\n", modes[pshared], n, sh->cs,
+				       rate[LOCK_SPIN], rate[LOCK_MUTEX], rate[LOCK_SPIN] / rate[LOCK_MUTEX],
+				       (rate[LOCK_SPIN] > rate[LOCK_MUTEX]) ? "spin" : "mutex",
+				       (n > pts_ncpus()) ? " (oversubscribed)" : "");
+				#endif
+			}
+		}
+
+		ret = pthread_spin_destroy(&sh->spin);
+		if (ret != 0)  {  UNRESOLVED(ret, "Spinlock destroy failed");  }
+		ret = pthread_mutex_destroy(&sh->mtx);
+		if (ret != 0)  {  UNRESOLVED(ret, "Mutex destroy failed");  }
+		ret = pthread_mutex_destroy(&sh->gate);
+		if (ret != 0)  {  UNRESOLVED(ret, "Mutex destroy failed");  }
+	}
+
+	#if VERBOSE > 0
+	/* The crossover map: S where the spinlock is faster, M where the mutex is */
+	for (pshared = 0; pshared <= 1; pshared++)
+	{
+		output("Crossover map (%s): S = spinlock faster, M = mutex faster\n", modes[pshared]);
+		sprintf(line, "%7s", "Workers");
+		for (c=0; c<NCS; c++)
+			sprintf(line + strlen(line), " %6llu", cs_len[c]);
+		output("%s  <- CS(ns)\n", line);
+		for (n = 1, k = 0; n != 0; n = pts_next_count(n, max), k++)
+		{
+			sprintf(line, "%7i", n);
+			for (c=0; c<NCS; c++)
+				sprintf(line + strlen(line), " %6c", MAP(pshared, k, c) ? MAP(pshared, k, c) : '-');
+			output("%s\n", line);
+		}
+	}
+	#endif
+
+	munmap(sh, sz);
+	free(map);
+	free(pr);
+	free(th);
+
+	#if VERBOSE > 0
+	output("pthread_spin_lock benchmark done.\n");
+	#endif
+
+	PASSED;
+}
@@ -51,6 +51,7 @@
 /********************************************************************************************/
 #include "testfrmw.h"
 #include "testfrmw.c" 
+#include "pts_scalability.h"
 /* This header is responsible for defining the following macros:
  * UNRESOLVED(ret, descr);  
  *    where descr is a description of the error and ret is an int (error code for example)
@@ -416,373 +417,75 @@ int main ( int argc, char *argv[] )
 
 
 /***
- * The next function will seek for the better model for each series of measurements.
- *
- * The tested models are: -- X = # threads; Y = latency
- * -> Y = a;      -- Error is r1 = avg( (Y - Yavg)² );
- * -> Y = aX + b; -- Error is r2 = avg( (Y -aX -b)² );
- *                -- where a = avg ( (X - Xavg)(Y - Yavg) ) / avg( ( X - Xavg)² )
- *                --         Note: We will call _q = sum( (X - Xavg) * (Y - Yavg) ); 
- *                --                       and  _d = sum( (X - Xavg)² );
- *                -- and   b = Yavg - a * Xavg
- * -> Y = c * X^a;-- Same as previous, but with log(Y) = a log(X) + b; and b = log(c). Error is r3
- * -> Y = exp(aX + b); -- log(Y) = aX + b. Error is r4
- *
- * We compute each error factor (r1, r2, r3, r4) then search which is the smallest (with ponderation).
- * The function returns 0 when r1 is the best for all cases (latency is constant) and !0 otherwise.
+ * The next function will seek for the better model for each series of measurements
+ * (see pts_scalability.h for the models and the verdict).
+ * The function returns 0 when both durations are constant and !0 otherwise.
  */
 
-struct row
-{
-	long X;  /* the X values -- copied from function argument */
-	long Y_o;  /* the Y values -- copied from function argument */
-	long Y_c;  /* the Y values -- copied from function argument */
-	long _x; /* Value X - Xavg */
-	long _y_o; /* Value Y - Yavg */
-	long _y_c; /* Value Y - Yavg */
-	double LnX; /* Natural logarithm of X values */
-	double LnY_o; /* Natural logarithm of Y values */
-	double LnY_c; /* Natural logarithm of Y values */
-	double _lnx; /* Value LnX - LnXavg */
-	double _lny_o; /* Value LnY - LnYavg */
-	double _lny_c; /* Value LnY - LnYavg */
-};
-
 int parse_measure( mes_t * measures )
 {
-	int ret, r;
+	int ret, err;
 
 	mes_t *cur;
 
-	double Xavg, Yavg_o, Yavg_c;
-	double LnXavg, LnYavg_o, LnYavg_c;
-
-	int N;
-
-	double r1_o, r2_o, r3_o, r4_o;
-	double r1_c, r2_c, r3_c, r4_c;
-
-	/* Some more intermediate vars */
-	long double _q_o[ 3 ];
-	long double _d_o[ 3 ];
-	long double _q_c[ 3 ];
-	long double _d_c[ 3 ];
-
-	long double t; /* temp value */
-
-	struct row *Table = NULL;
-
-	/* This array contains the last element of each serie */
-	int array_max;
-
-	/* Initialize the datas */
-
-	array_max = -1; /* means no data */
-	Xavg = 0.0;
-	LnXavg = 0.0;
-	Yavg_o = 0.0;
-	LnYavg_o = 0.0;
-	r1_o = 0.0;
-	r2_o = 0.0;
-	r3_o = 0.0;
-	r4_o = 0.0;
-	_q_o[ 0 ] = 0.0;
-	_q_o[ 1 ] = 0.0;
-	_q_o[ 2 ] = 0.0;
-	_d_o[ 0 ] = 0.0;
-	_d_o[ 1 ] = 0.0;
-	_d_o[ 2 ] = 0.0;
-	Yavg_c = 0.0;
-	LnYavg_c = 0.0;
-	r1_c = 0.0;
-	r2_c = 0.0;
-	r3_c = 0.0;
-	r4_c = 0.0;
-	_q_c[ 0 ] = 0.0;
-	_q_c[ 1 ] = 0.0;
-	_q_c[ 2 ] = 0.0;
-	_d_c[ 0 ] = 0.0;
-	_d_c[ 1 ] = 0.0;
-	_d_c[ 2 ] = 0.0;
-
-	N = 0;
-	cur = measures;
+	pts_serie_t serie_o = PTS_SERIE_INITIALIZER;
+	pts_serie_t serie_c = PTS_SERIE_INITIALIZER;
+	pts_fit_t fit;
 
 #if VERBOSE > 1
 	output( "Data analysis starting\n" );
+
 #endif
 
-	/* We start with reading the list to find:
-	 * -> number of elements, to assign an array.
-	 * -> average values 
-	 */
+	err = 0;
 
-	while ( cur->next != NULL )
+	for ( cur = measures->next; ( cur != NULL ) && ( err == 0 ); cur = cur->next )
 	{
-		cur = cur->next;
-
-		N++;
-
 		if ( cur->_data_open != 0 )
-		{
-			array_max = N;
-			Xavg += ( double ) cur->nsem;
-			LnXavg += log( ( double ) cur->nsem );
-			Yavg_o += ( double ) cur->_data_open;
-			LnYavg_o += log( ( double ) cur->_data_open );
-			Yavg_c += ( double ) cur->_data_close;
-			LnYavg_c += log( ( double ) cur->_data_close );
-		}
+			err = pts_serie_add( &serie_o, ( double ) cur->nsem, ( double ) cur->_data_open );
 
+		if ( ( cur->_data_close != 0 ) && ( err == 0 ) )
+			err = pts_serie_add( &serie_c, ( double ) cur->nsem, ( double ) cur->_data_close );
 	}
 
-	/* We have the sum; we can divide to obtain the average values */
-	if ( array_max != -1 )
+	if ( err != 0 )
 	{
-		Xavg /= array_max;
-		LnXavg /= array_max;
-		Yavg_o /= array_max;
-		LnYavg_o /= array_max;
-		Yavg_c /= array_max;
-		LnYavg_c /= array_max;
+		UNRESOLVED( err, "Unable to alloc space for results parsing" );
 	}
 
-#if VERBOSE > 1
-	output( " Found %d rows\n", N );
-
-#endif
-
-
-	/* We will now alloc the array ... */
-
-	Table = calloc( N, sizeof( struct row ) );
-
-	if ( Table == NULL )
-	{
-		UNRESOLVED( errno, "Unable to alloc space for results parsing" );
-	}
-
-	/* ... and fill it */
-	N = 0;
+	ret = 0;
 
-	cur = measures;
+	err = pts_scal_fit( &serie_o, &fit );
 
-	while ( cur->next != NULL )
+	if ( err != 0 )
 	{
-		cur = cur->next;
-
-		Table[ N ].X = ( long ) cur->nsem;
-		Table[ N ].LnX = log( ( double ) cur->nsem );
-
-		if ( array_max > N )
-		{
-			Table[ N ]._x = Table[ N ].X - Xavg ;
-			Table[ N ]._lnx = Table[ N ].LnX - LnXavg;
-			Table[ N ].Y_o = cur->_data_open;
-			Table[ N ]._y_o = Table[ N ].Y_o - Yavg_o ;
-			Table[ N ].LnY_o = log( ( double ) cur->_data_open );
-			Table[ N ]._lny_o = Table[ N ].LnY_o - LnYavg_o;
-			Table[ N ].Y_c = cur->_data_close;
-			Table[ N ]._y_c = Table[ N ].Y_c - Yavg_c ;
-			Table[ N ].LnY_c = log( ( double ) cur->_data_close );
-			Table[ N ]._lny_c = Table[ N ].LnY_c - LnYavg_c;
-		}
-
-		N++;
+		UNRESOLVED( err, "Unable to alloc space for results parsing" );
 	}
 
-	/* We won't need the list anymore -- we'll work with the array which should be faster. */
 #if VERBOSE > 1
-	output( " Data was stored in an array.\n" );
+	pts_scal_report( "sem_open", &fit );
 
 #endif
 
-	/* We need to read the full array at least twice to compute all the error factors */
+	ret += fit.grows;
 
-	/* In the first pass, we'll compute:
-	 * -> r1 for each scenar.
-	 * -> "a" factor for linear (0), power (1) and exponential (2) approximations -- with using the _d and _q vars.
-	 */
-#if VERBOSE > 1
-	output( "Starting first pass...\n" );
+	err = pts_scal_fit( &serie_c, &fit );
 
-#endif
-	for ( r = 0; r < array_max; r++ )
+	if ( err != 0 )
 	{
-		r1_o += ( ( double ) Table[ r ]._y_o / array_max ) * ( double ) Table[ r ]._y_o;
-
-		_q_o[ 0 ] += Table[ r ]._y_o * Table[ r ]._x;
-		_d_o[ 0 ] += Table[ r ]._x * Table[ r ]._x;
-
-		_q_o[ 1 ] += Table[ r ]._lny_o * Table[ r ]._lnx;
-		_d_o[ 1 ] += Table[ r ]._lnx * Table[ r ]._lnx;
-
-		_q_o[ 2 ] += Table[ r ]._lny_o * Table[ r ]._x;
-		_d_o[ 2 ] += Table[ r ]._x * Table[ r ]._x;
-
-
-		r1_c += ( ( double ) Table[ r ]._y_c / array_max ) * ( double ) Table[ r ]._y_c;
-
-		_q_c[ 0 ] += Table[ r ]._y_c * Table[ r ]._x;
-		_d_c[ 0 ] += Table[ r ]._x * Table[ r ]._x;
-
-		_q_c[ 1 ] += Table[ r ]._lny_c * Table[ r ]._lnx;
-		_d_c[ 1 ] += Table[ r ]._lnx * Table[ r ]._lnx;
-
-		_q_c[ 2 ] += Table[ r ]._lny_c * Table[ r ]._x;
-		_d_c[ 2 ] += Table[ r ]._x * Table[ r ]._x;
-
+		UNRESOLVED( err, "Unable to alloc space for results parsing" );
 	}
 
-	/* First pass is terminated; a2 = _q[0]/_d[0]; a3 = _q[1]/_d[1]; a4 = _q[2]/_d[2] */
-
-	/* In the first pass, we'll compute:
-	 * -> r2, r3, r4 for each scenar.
-	 */
-
 #if VERBOSE > 1
-	output( "Starting second pass...\n" );
+	pts_scal_report( "sem_close", &fit );
 
 #endif
-	for ( r = 0; r < array_max; r++ )
-	{
-		/* r2 = avg((y - ax -b)²);  t = (y - ax - b) = (y - yavg) - a (x - xavg); */
-		t = ( Table[ r ]._y_o - ( ( _q_o[ 0 ] * Table[ r ]._x ) / _d_o[ 0 ] ) );
-		r2_o += t * t / array_max ;
-
-		t = ( Table[ r ]._y_c - ( ( _q_c[ 0 ] * Table[ r ]._x ) / _d_c[ 0 ] ) );
-		r2_c += t * t / array_max ;
-
-		/* r3 = avg(( y - c.x^a) ²);
-		    t = y - c * x ^ a 
-		      = y - log (LnYavg - (_q[1]/_d[1]) * LnXavg) * x ^ (_q[1]/_d[1])
-		*/
-		t = ( Table[ r ].Y_o
-		      - ( logl ( LnYavg_o - ( _q_o[ 1 ] / _d_o[ 1 ] ) * LnXavg )
-		          * powl( Table[ r ].X, ( _q_o[ 1 ] / _d_o[ 1 ] ) )
-		        ) );
-		r3_o += t * t / array_max ;
-
-		t = ( Table[ r ].Y_c
-		      - ( logl ( LnYavg_c - ( _q_c[ 1 ] / _d_c[ 1 ] ) * LnXavg )
-		          * powl( Table[ r ].X, ( _q_c[ 1 ] / _d_c[ 1 ] ) )
-		        ) );
-		r3_c += t * t / array_max ;
-
-		/* r4 = avg(( y - exp(ax+b))²);
-		    t = y - exp(ax+b)
-		      = y - exp( _q[2]/_d[2] * x + ( LnYavg - (_q[2]/_d[2] * Xavg) ));
-		      = y - exp( _q[2]/_d[2] * (x - Xavg) + LnYavg );
-		*/
-		t = ( Table[ r ].Y_o
-		      - expl( ( _q_o[ 2 ] / _d_o[ 2 ] ) * Table[ r ]._x + LnYavg_o ) );
-		r4_o += t * t / array_max ;
-
-		t = ( Table[ r ].Y_c
-		      - expl( ( _q_c[ 2 ] / _d_c[ 2 ] ) * Table[ r ]._x + LnYavg_c ) );
-		r4_c += t * t / array_max ;
-
-	}
-
-#if VERBOSE > 1
-	output( "All computing terminated.\n" );
-
-#endif
-	ret = 0;
-
-#if VERBOSE > 1
-	output( " # of data: %i\n", array_max );
 
-	output( "  Model: Y = k\n" );
+	ret += fit.grows;
 
-	output( "   sem_open:\n" );
-
-	output( "       k = %g\n", Yavg_o );
-
-	output( "    Divergence %g\n", r1_o );
-
-	output( "   sem_close:\n" );
-
-	output( "       k = %g\n", Yavg_c );
-
-	output( "    Divergence %g\n", r1_c );
-
-	output( "  Model: Y = a * X + b\n" );
-
-	output( "   sem_open:\n" );
-
-	output( "       a = %Lg\n", _q_o[ 0 ] / _d_o[ 0 ] );
-
-	output( "       b = %Lg\n", Yavg_o - ( ( _q_o[ 0 ] / _d_o[ 0 ] ) * Xavg ) );
-
-	output( "    Divergence %g\n", r2_o );
-
-	output( "   sem_close:\n" );
-
-	output( "       a = %Lg\n", _q_c[ 0 ] / _d_c[ 0 ] );
-
-	output( "       b = %Lg\n", Yavg_c - ( ( _q_c[ 0 ] / _d_c[ 0 ] ) * Xavg ) );
-
-	output( "    Divergence %g\n", r2_c );
-
-	output( "  Model: Y = c * X ^ a\n" );
-
-	output( "   sem_open:\n" );
-
-	output( "       a = %Lg\n", _q_o[ 1 ] / _d_o[ 1 ] );
-
-	output( "       c = %Lg\n", logl ( LnYavg_o - ( _q_o[ 1 ] / _d_o[ 1 ] ) * LnXavg ) );
-
-	output( "    Divergence %g\n", r3_o );
-
-	output( "   sem_close:\n" );
-
-	output( "       a = %Lg\n", _q_c[ 1 ] / _d_c[ 1 ] );
-
-	output( "       c = %Lg\n", logl ( LnYavg_c - ( _q_c[ 1 ] / _d_c[ 1 ] ) * LnXavg ) );
-
-	output( "    Divergence %g\n", r3_c );
-
-	output( "  Model: Y = exp(a * X + b)\n" );
-
-	output( "   sem_open:\n" );
-
-	output( "       a = %Lg\n", _q_o[ 2 ] / _d_o[ 2 ] );
-
-	output( "       b = %Lg\n", LnYavg_o - ( ( _q_o[ 2 ] / _d_o[ 2 ] ) * Xavg ) );
-
-	output( "    Divergence %g\n", r4_o );
-
-	output( "   sem_close:\n" );
-
-	output( "       a = %Lg\n", _q_c[ 2 ] / _d_c[ 2 ] );
-
-	output( "       b = %Lg\n", LnYavg_c - ( ( _q_c[ 2 ] / _d_c[ 2 ] ) * Xavg ) );
-
-	output( "    Divergence %g\n", r4_c );
-
-#endif
-
-	if ( array_max != -1 )
-	{
-		/* Compare r1 to other values, with some ponderations */
-
-		if ( ( r1_o > 1.1 * r2_o ) || ( r1_o > 1.2 * r3_o ) || ( r1_o > 1.3 * r4_o )
-		        || ( r1_c > 1.1 * r2_c ) || ( r1_c > 1.2 * r3_c ) || ( r1_c > 1.3 * r4_c ) )
-			ret++;
-
-#if VERBOSE > 1
-		else
-			output( " Sanction: OK\n" );
-
-#endif
-
-	}
-
-	/* We need to free the array */
-	free( Table );
+	pts_serie_free( &serie_o );
+	pts_serie_free( &serie_c );
 
 	/* We're done */
 	return ret;
 }
-
@@ -0,0 +1,334 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * This is a benchmark of the cost of reading the time.
+ *
+ * 1. Cost per call: for each source of srcs[] (clock_gettime on each
+ *    clock id, including CLOCK_PROCESS_CPUTIME_ID, the process clock
+ *    from clock_getcpuclockid and the thread clock from
+ *    pthread_getcpuclockid, then time and gettimeofday) and for 1, 2,
+ *    4, ... N threads (N is the # of CPUs, at least 2), each thread
+ *    makes CALLS calls. The mean cost of a call and the total # of
+ *    calls per second are reported, with the clock_getres resolution.
+ *
+ * 2. Monotonicity across CPUs: N threads, pinned one per CPU when
+ *    the system allows it, read each monotonic clock during
+ *    DURATION ms. The readings are serialized with a spinlock, so
+ *    each one must not be smaller than the previous one, whichever
+ *    thread made it. The test fails if the time ever goes backwards.
+ */
+
+/* The threads are pinned with the Linux affinity API */
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <pthread.h>
+
+#include "posixtest.h"
+#include "pts_bench.h"
+#include "pts_placement.h"
+
+#define CALLS		200000
+#define DURATION	500	/* ms per clock, for the monotonicity check */
+
+#define SRC_CLOCK	0	/* clock_gettime(id) */
+#define SRC_PROCCPU	1	/* clock_gettime(clock_getcpuclockid) */
+#define SRC_THREADCPU	2	/* clock_gettime(pthread_getcpuclockid) */
+#define SRC_TIME	3	/* time() */
+#define SRC_GTOD	4	/* gettimeofday() */
+
+typedef struct {
+	char *name;
+	int kind;
+	clockid_t id;
+	int monotonic;
+} source_t;
+
+source_t srcs[] = {
+	{ "CLOCK_REALTIME",		SRC_CLOCK, CLOCK_REALTIME, 0 },
+	{ "CLOCK_MONOTONIC",		SRC_CLOCK, CLOCK_MONOTONIC, 1 },
+#ifdef CLOCK_MONOTONIC_RAW
+	{ "CLOCK_MONOTONIC_RAW",	SRC_CLOCK, CLOCK_MONOTONIC_RAW, 1 },
+#endif
+#ifdef CLOCK_BOOTTIME
+	{ "CLOCK_BOOTTIME",		SRC_CLOCK, CLOCK_BOOTTIME, 1 },
+#endif
+#ifdef CLOCK_REALTIME_COARSE
+	{ "CLOCK_REALTIME_COARSE",	SRC_CLOCK, CLOCK_REALTIME_COARSE, 0 },
+#endif
+#ifdef CLOCK_MONOTONIC_COARSE
+	{ "CLOCK_MONOTONIC_COARSE",	SRC_CLOCK, CLOCK_MONOTONIC_COARSE, 1 },
+#endif
+	{ "CLOCK_PROCESS_CPUTIME_ID",	SRC_CLOCK, CLOCK_PROCESS_CPUTIME_ID, 0 },
+	{ "CLOCK_THREAD_CPUTIME_ID",	SRC_CLOCK, CLOCK_THREAD_CPUTIME_ID, 0 },
+	{ "clock_getcpuclockid",	SRC_PROCCPU, 0, 0 },
+	{ "pthread_getcpuclockid",	SRC_THREADCPU, 0, 0 },
+	{ "time",			SRC_TIME, 0, 0 },
+	{ "gettimeofday",		SRC_GTOD, 0, 0 },
+};
+#define NSRCS	(sizeof(srcs) / sizeof(srcs[0]))
+
+/* The data of each thread */
+typedef struct {
+	pthread_t th;
+	int index;
+	int error;
+	unsigned long long elapsed;	/* ns for the CALLS calls */
+	unsigned long long checks;
+	unsigned long long backsteps;
+} worker_t;
+
+source_t *src;
+pts_gate_t gate;
+int pinned;
+
+/* The monotonicity check */
+pthread_spinlock_t lock;
+struct timespec last;
+unsigned long long max_backstep;
+
+/* The clock id of a source for the calling thread */
+static int source_clock(source_t *s, clockid_t *id)
+{
+	switch (s->kind) {
+	case SRC_PROCCPU:
+		return clock_getcpuclockid(getpid(), id);
+	case SRC_THREADCPU:
+		return pthread_getcpuclockid(pthread_self(), id);
+	default:
+		*id = s->id;
+		return 0;
+	}
+}
+
+static void *caller(void *arg)
+{
+	worker_t *w = (worker_t *)arg;
+	struct timespec ts;
+	struct timeval tv;
+	unsigned long long t0;
+	clockid_t id;
+	int i;
+
+	if (pinned && (0 != pts_place_thread(w->index)))
+		w->error = 1;
+	if (0 != source_clock(src, &id))
+		w->error = 1;
+	if (0 != pts_gate_ready(&gate))
+		w->error = 1;
+	if (w->error)
+		return NULL;
+
+	t0 = pts_now_ns();
+	switch (src->kind) {
+	case SRC_TIME:
+		for (i = 0; i < CALLS; i++)
+			if ((time_t)-1 == time(NULL))
+				w->error = 1;
+		break;
+	case SRC_GTOD:
+		for (i = 0; i < CALLS; i++)
+			if (-1 == gettimeofday(&tv, NULL))
+				w->error = 1;
+		break;
+	default:
+		for (i = 0; i < CALLS; i++)
+			if (-1 == clock_gettime(id, &ts))
+				w->error = 1;
+		break;
+	}
+	w->elapsed = pts_now_ns() - t0;
+	return NULL;
+}
+
+static void *checker(void *arg)
+{
+	worker_t *w = (worker_t *)arg;
+	struct timespec now;
+	long long diff;
+
+	if (pinned && (0 != pts_place_thread(w->index)))
+		w->error = 1;
+	if (0 != pts_gate_ready(&gate))
+		w->error = 1;
+	if (w->error)
+		return NULL;
+
+	while (!pts_gate_closed(&gate)) {
+		pthread_spin_lock(&lock);
+		if (-1 == clock_gettime(src->id, &now))
+			w->error = 1;
+		diff = (long long)(now.tv_sec - last.tv_sec) * 1000000000LL
+			+ (now.tv_nsec - last.tv_nsec);
+		if (diff < 0) {
+			w->backsteps++;
+			if ((unsigned long long)-diff > max_backstep)
+				max_backstep = -diff;
+		} else {
+			last = now;
+		}
+		pthread_spin_unlock(&lock);
+		w->checks++;
+	}
+	return NULL;
+}
+
+/* Run n threads of fn; returns -1 if a thread failed */
+static int run(int n, worker_t *w, void *(*fn)(void *), int timed)
+{
+	int i, ret = 0;
+
+	if (0 != pts_gate_init(&gate)) {
+		perror("pts_gate_init didn't return success \n");
+		return -1;
+	}
+	for (i = 0; i < n; i++) {
+		memset(&w[i], 0, sizeof(worker_t));
+		w[i].index = i;
+		if (0 != pthread_create(&w[i].th, NULL, fn, &w[i])) {
+			perror("pthread_create didn't return success \n");
+			return -1;
+		}
+	}
+	if (0 != pts_gate_open(&gate, n)) {
+		perror("pts_gate_open didn't return success \n");
+		return -1;
+	}
+	if (timed) {
+		pts_sleep_ms(DURATION);
+		pts_gate_close(&gate);
+	}
+	for (i = 0; i < n; i++) {
+		if (0 != pthread_join(w[i].th, NULL)) {
+			perror("pthread_join didn't return success \n");
+			return -1;
+		}
+		if (w[i].error)
+			ret = -1;
+	}
+	pts_gate_destroy(&gate);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	worker_t *w;
+	struct timespec res;
+	clockid_t id;
+	unsigned long long sum, checks, backsteps;
+	unsigned int s;
+	int i, n, max, npin, ret = PTS_PASS;
+
+#ifndef	_POSIX_TIMERS
+	printf("_POSIX_TIMERS is not defined \n");
+	return PTS_UNRESOLVED;
+#endif
+
+	max = pts_max_threads(1);
+
+	npin = pts_placement_init();
+	if (npin > 0)
+		pts_placement = PTS_PLACE_COMPACT;
+
+	w = calloc(max, sizeof(worker_t));
+	if (w == NULL) {
+		perror("calloc didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	/* 1. Cost per call */
+	printf("%d calls per thread, up to %d threads\n", CALLS, max);
+	printf("%-26s %8s %7s %9s %12s\n", "Source", "Res(ns)", "Threads",
+		"ns/call", "Calls/s");
+
+	for (s = 0; s < NSRCS; s++) {
+		src = &srcs[s];
+
+		res.tv_sec = 0;
+		res.tv_nsec = 0;
+		if ((src->kind != SRC_TIME) && (src->kind != SRC_GTOD)
+		 && ((0 != source_clock(src, &id)) || (-1 == clock_getres(id, &res)))) {
+			printf("%-26s is not supported\n", src->name);
+			continue;
+		}
+
+		for (n = 1; n != 0; n = pts_next_count(n, max)) {
+			if (-1 == run(n, w, caller, 0)) {
+				printf("%s failed with %d threads\n", src->name, n);
+				ret = PTS_UNRESOLVED;
+				goto out;
+			}
+			sum = 0;
+			for (i = 0; i < n; i++)
+				sum += w[i].elapsed;
+			printf("%-26s %8ld %7d %9.1f %12.0f\n", src->name,
+				(long)res.tv_sec * 1000000000L + res.tv_nsec, n,
+				(double)sum / ((double)n * CALLS),
+				(double)n * CALLS * 1000000000.0 / ((double)sum / n));
+		}
+	}
+
+	/* 2. Monotonicity across CPUs */
+	pinned = (npin > 0);
+	if (0 != pthread_spin_init(&lock, PTHREAD_PROCESS_PRIVATE)) {
+		perror("pthread_spin_init didn't return success \n");
+		ret = PTS_UNRESOLVED;
+		goto out;
+	}
+
+	if (pinned)
+		printf("\nMonotonicity: %d threads pinned on %d CPUs, %d ms per clock\n",
+			max, (npin < max) ? npin : max, DURATION);
+	else
+		printf("\nMonotonicity: %d threads, %d ms per clock\n", max, DURATION);
+	printf("%-26s %12s %10s %14s\n", "Clock", "Readings", "Backsteps",
+		"Max-back(ns)");
+
+	for (s = 0; s < NSRCS; s++) {
+		src = &srcs[s];
+		if (!src->monotonic)
+			continue;
+
+		if (-1 == clock_gettime(src->id, &last)) {
+			printf("%-26s is not supported\n", src->name);
+			continue;
+		}
+		max_backstep = 0;
+		if (-1 == run(max, w, checker, 1)) {
+			printf("%s failed\n", src->name);
+			ret = PTS_UNRESOLVED;
+			break;
+		}
+		checks = backsteps = 0;
+		for (i = 0; i < max; i++) {
+			checks += w[i].checks;
+			backsteps += w[i].backsteps;
+		}
+		printf("%-26s %12llu %10llu %14llu\n", src->name, checks,
+			backsteps, max_backstep);
+		if (backsteps != 0) {
+			printf("%s went backwards\n", src->name);
+			ret = PTS_FAIL;
+		}
+	}
+	pthread_spin_destroy(&lock);
+
+out:
+	free(w);
+
+	if (ret == PTS_PASS)
+		printf("Test PASSED\n");
+	else
+		printf("Test %s\n", (ret == PTS_FAIL) ? "FAILED" : "UNRESOLVED");
+	return ret;
+}
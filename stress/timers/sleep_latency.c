@@ -0,0 +1,267 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * This is a wakeup latency benchmark of clock_nanosleep. One measuring
+ * thread per CPU (pinned when the system allows it) loops LOOPS times:
+ *	next += INTERVAL;
+ *	clock_nanosleep(clock, TIMER_ABSTIME, &next, NULL);
+ *	overshoot = now - next;
+ * for CLOCK_MONOTONIC, then for CLOCK_REALTIME.
+ *
+ * Options:
+ *  -r  run the measuring threads under SCHED_FIFO (sched_setscheduler on
+ *      the process, inherited by the threads), with mlockall.
+ *  -l  run a background load: one process per CPU, SCHED_OTHER, which
+ *      loops over a busy CPU, memory churn and syscalls (sched_yield).
+ *      It is built in, rather than made of the stress tests of the other
+ *      directories, so that it is the same on each run and each system.
+ *
+ * The overshoot histogram (min, p50, p99, p99.9, max) is reported per
+ * CPU and for all the CPUs. The test fails if clock_nanosleep returns
+ * before a CLOCK_MONOTONIC deadline. Early CLOCK_REALTIME wakeups are
+ * only reported: the clock may be stepped (by NTP, or by hand) during
+ * the run, so that it reads before the deadline after a correct wakeup.
+ */
+
+/* The measuring threads are pinned with the Linux affinity API */
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "posixtest.h"
+#include "pts_bench.h"
+#include "pts_histogram.h"
+#include "pts_placement.h"
+
+#define LOOPS		1000
+#define INTERVAL	1000000		/* ns */
+#define LOAD_MEM	(4 * 1024 * 1024)
+
+clockid_t clocks[] = { CLOCK_MONOTONIC, CLOCK_REALTIME };
+char *clock_names[] = { "MONOTONIC", "REALTIME" };
+#define NCLOCKS	(sizeof(clocks) / sizeof(clocks[0]))
+
+/* The data of each measuring thread */
+typedef struct {
+	pthread_t th;
+	int index;
+	int cpu;
+	clockid_t clk;
+	int early;		/* # of wakeups before the deadline */
+	pts_hist_t lat;
+} meas_t;
+
+static unsigned long long ts2ns(struct timespec *ts)
+{
+	return (unsigned long long)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+static void *measure(void *arg)
+{
+	meas_t *m = (meas_t *)arg;
+	struct timespec next, now;
+	unsigned long long dl, t;
+	int i, ret;
+
+	if (0 != pts_place_thread(m->index))
+		return (void *)1;
+
+	clock_gettime(m->clk, &next);
+	for (i = 0; i < LOOPS; i++) {
+		next.tv_nsec += INTERVAL;
+		while (next.tv_nsec >= 1000000000) {
+			next.tv_nsec -= 1000000000;
+			next.tv_sec++;
+		}
+
+		do {
+			ret = clock_nanosleep(m->clk, TIMER_ABSTIME, &next, NULL);
+		} while (ret == EINTR);
+		if (ret != 0)
+			return (void *)1;
+
+		clock_gettime(m->clk, &now);
+		dl = ts2ns(&next);
+		t = ts2ns(&now);
+		if (t < dl) {
+			m->early++;
+			continue;
+		}
+		pts_hist_record(&m->lat, t - dl);
+	}
+	return NULL;
+}
+
+/* A background load process; never returns */
+static void load(void)
+{
+	char *mem;
+	int i;
+
+	mem = malloc(LOAD_MEM);
+	if (mem == NULL)
+		_exit(PTS_UNRESOLVED);
+
+	for (;;) {
+		pts_spin_ns(1000000);
+		memset(mem, 0x5a, LOAD_MEM);
+		for (i = 0; i < 100; i++)
+			sched_yield();
+	}
+}
+
+static void report(char *clk, char *cpu, pts_hist_t *h)
+{
+	printf("%-10s %4s %8llu %9llu %9llu %9llu %9llu %9llu\n", clk, cpu,
+		h->count, h->min, pts_hist_percentile(h, 50.0),
+		pts_hist_percentile(h, 99.0), pts_hist_percentile(h, 99.9), h->max);
+}
+
+int main(int argc, char *argv[])
+{
+	struct sched_param sp;
+	meas_t *m;
+	pid_t *loaders;
+	pts_hist_t *all;
+	char cpu[16];
+	void *thret;
+	int c, i, ncpus, npin, rt = 0, loaded = 0, ret = PTS_PASS;
+	unsigned int k;
+
+	while ((c = getopt(argc, argv, "rl")) != -1) {
+		switch (c) {
+		case 'r':
+			rt = 1;
+			break;
+		case 'l':
+			loaded = 1;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-r] [-l]\n", argv[0]);
+			return PTS_UNRESOLVED;
+		}
+	}
+
+	npin = pts_placement_init();
+	ncpus = (npin > 0) ? npin : pts_ncpus();
+	if (npin > 0)
+		pts_placement = PTS_PLACE_COMPACT;
+
+	m = calloc(ncpus, sizeof(meas_t));
+	loaders = calloc(ncpus, sizeof(pid_t));
+	all = malloc(sizeof(pts_hist_t));
+	if ((m == NULL) || (loaders == NULL) || (all == NULL)) {
+		perror("malloc didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	/* The load is started first, so that it does not inherit SCHED_FIFO */
+	if (loaded) {
+		fflush(stdout);
+		for (i = 0; i < ncpus; i++) {
+			loaders[i] = fork();
+			if (loaders[i] == -1) {
+				perror("fork didn't return success \n");
+				ret = PTS_UNRESOLVED;
+				goto out;
+			}
+			if (loaders[i] == 0)
+				load();
+		}
+	}
+
+	if (rt) {
+		if (-1 == mlockall(MCL_CURRENT | MCL_FUTURE)) {
+			perror("mlockall didn't return success \n");
+			ret = PTS_UNRESOLVED;
+			goto out;
+		}
+		sp.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+		if (-1 == sched_setscheduler(0, SCHED_FIFO, &sp)) {
+			perror("sched_setscheduler didn't return success \n");
+			ret = PTS_UNRESOLVED;
+			goto out;
+		}
+	}
+
+	printf("%d wakeups per thread every %d us, %s, %s, %d CPUs%s\n",
+		LOOPS, INTERVAL / 1000, rt ? "SCHED_FIFO" : "SCHED_OTHER",
+		loaded ? "loaded" : "idle", ncpus, (npin > 0) ? "" : " (not pinned)");
+	printf("Overshoot of the deadline in ns\n");
+	printf("%-10s %4s %8s %9s %9s %9s %9s %9s\n", "Clock", "CPU", "Samples",
+		"min", "p50", "p99", "p99.9", "max");
+
+	for (k = 0; (k < NCLOCKS) && (ret == PTS_PASS); k++) {
+		for (i = 0; i < ncpus; i++) {
+			m[i].index = i;
+			m[i].cpu = (npin > 0) ? pts_topo.cpu[pts_topo.compact[i]] : -1;
+			m[i].clk = clocks[k];
+			m[i].early = 0;
+			pts_hist_init(&m[i].lat);
+			if (0 != pthread_create(&m[i].th, NULL, measure, &m[i])) {
+				perror("pthread_create didn't return success \n");
+				ret = PTS_UNRESOLVED;
+				goto out;
+			}
+		}
+
+		pts_hist_init(all);
+		for (i = 0; i < ncpus; i++) {
+			if ((0 != pthread_join(m[i].th, &thret)) || (thret != NULL)) {
+				printf("A measuring thread failed\n");
+				ret = PTS_UNRESOLVED;
+				continue;
+			}
+			if (m[i].early != 0) {
+				printf("clock_nanosleep returned %d times before the deadline on %s\n",
+					m[i].early, clock_names[k]);
+				if (clocks[k] == CLOCK_MONOTONIC)
+					ret = PTS_FAIL;
+				else
+					printf("The clock may have been set during the run\n");
+			}
+			pts_hist_merge(all, &m[i].lat);
+
+			if (m[i].cpu >= 0)
+				sprintf(cpu, "%d", m[i].cpu);
+			else
+				sprintf(cpu, "#%d", i);
+			report(clock_names[k], cpu, &m[i].lat);
+		}
+		report(clock_names[k], "all", all);
+	}
+
+out:
+	if (loaded) {
+		for (i = 0; i < ncpus; i++) {
+			if (loaders[i] > 0) {
+				kill(loaders[i], SIGKILL);
+				waitpid(loaders[i], NULL, 0);
+			}
+		}
+	}
+
+	free(all);
+	free(loaders);
+	free(m);
+
+	if (ret == PTS_PASS)
+		printf("Test PASSED\n");
+	else
+		printf("Test %s\n", (ret == PTS_FAIL) ? "FAILED" : "UNRESOLVED");
+	return ret;
+}
@@ -0,0 +1,282 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * This is a cyclictest-like benchmark of the periodic POSIX timers.
+ * Timers are armed with timer_settime on CLOCK_MONOTONIC, with an
+ * absolute first expiration and a fixed period. Each notification is
+ * timed against the expiration which generated it:
+ *	latency = now - (start + expirations * period)
+ * where expirations is the # of expirations already accounted for,
+ * i.e. the previous notifications plus their timer_getoverrun counts.
+ * A timer disarms itself at its first notification after the end of
+ * the case, so a period too short for the system cannot starve the
+ * main thread.
+ *
+ * The notification is delivered in three ways:
+ * - signal:      SIGEV_SIGNAL, caught by a SA_SIGINFO handler;
+ * - thread:      SIGEV_THREAD, a notification function in a new thread;
+ * - sigwaitinfo: SIGEV_SIGNAL, blocked and fetched with sigwaitinfo.
+ * For each delivery, each period of periods[] (50 us to 100 ms) and
+ * each # of timers of ntimers[], the timers run during DURATION ms.
+ *
+ * The # of notifications, the total overrun count and the p50/p99/max
+ * latencies are reported for each case.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "posixtest.h"
+#include "pts_bench.h"
+#include "pts_histogram.h"
+
+#define DURATION	1000	/* ms per case */
+#define MAX_TIMERS	8
+#define SIGTIMER	SIGRTMIN
+
+long periods[] = { 50000, 100000, 1000000, 10000000, 100000000 };	/* ns */
+int ntimers[] = { 1, MAX_TIMERS };
+#define NPERIODS	(sizeof(periods) / sizeof(periods[0]))
+#define NCOUNTS		(sizeof(ntimers) / sizeof(ntimers[0]))
+
+#define DELIVER_SIGNAL		0
+#define DELIVER_THREAD		1
+#define DELIVER_SIGWAITINFO	2
+char *deliveries[] = { "signal", "thread", "sigwaitinfo" };
+
+/* The state of each timer */
+typedef struct {
+	timer_t id;
+	unsigned long long start;
+	unsigned long long expirations;
+	unsigned long long notifications;
+	unsigned long long overruns;
+	pts_hist_t lat;
+} tmr_t;
+
+tmr_t timers[MAX_TIMERS];
+unsigned long long period;
+unsigned long long end;
+volatile int active;
+
+/* Serializes the notification threads of the SIGEV_THREAD case */
+pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+
+/* Account for one notification of timer i */
+static void expired(int i)
+{
+	tmr_t *t;
+	struct itimerspec zero;
+	unsigned long long now, expected;
+	int overrun;
+
+	now = pts_now_ns();
+	if (!active || (i < 0) || (i >= MAX_TIMERS))
+		return;
+	t = &timers[i];
+
+	overrun = timer_getoverrun(t->id);
+	if (overrun < 0)
+		overrun = 0;
+
+	expected = t->start + t->expirations * period;
+	pts_hist_record(&t->lat, (now > expected) ? now - expected : 0);
+	t->notifications++;
+	t->overruns += overrun;
+	t->expirations += 1 + overrun;
+
+	if (now >= end) {
+		memset(&zero, 0, sizeof(zero));
+		timer_settime(t->id, 0, &zero, NULL);
+	}
+}
+
+static void handler(int signo, siginfo_t *info, void *context)
+{
+	expired(info->si_value.sival_int);
+}
+
+static void notify(union sigval sv)
+{
+	pthread_mutex_lock(&mtx);
+	expired(sv.sival_int);
+	pthread_mutex_unlock(&mtx);
+}
+
+/* Discard the signals still pending after the timers are deleted */
+static void drain(void)
+{
+	struct timespec zero = { 0, 0 };
+	sigset_t set;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGTIMER);
+	while (sigtimedwait(&set, NULL, &zero) != -1)
+		;
+}
+
+/* Run one case; returns a PTS_* status */
+static int run(int delivery, int n)
+{
+	struct sigevent ev;
+	struct itimerspec its;
+	unsigned long long first, notif = 0, over = 0;
+	pts_hist_t *lat;
+	sigset_t set, oset;
+	siginfo_t info;
+	int i;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGTIMER);
+
+	/* The signal is blocked except while waiting in the signal case */
+	if (-1 == sigprocmask(SIG_BLOCK, &set, &oset)) {
+		perror("sigprocmask didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	first = pts_now_ns() + 10000000;
+	end = first + DURATION * 1000000ULL;
+	for (i = 0; i < n; i++) {
+		memset(&ev, 0, sizeof(ev));
+		if (delivery == DELIVER_THREAD) {
+			ev.sigev_notify = SIGEV_THREAD;
+			ev.sigev_notify_function = notify;
+		} else {
+			ev.sigev_notify = SIGEV_SIGNAL;
+			ev.sigev_signo = SIGTIMER;
+		}
+		ev.sigev_value.sival_int = i;
+		if (-1 == timer_create(CLOCK_MONOTONIC, &ev, &timers[i].id)) {
+			perror("timer_create didn't return success \n");
+			return PTS_UNRESOLVED;
+		}
+		timers[i].start = first;
+		timers[i].expirations = 0;
+		timers[i].notifications = 0;
+		timers[i].overruns = 0;
+		pts_hist_init(&timers[i].lat);
+	}
+	active = 1;
+
+	/* All the timers expire together */
+	for (i = 0; i < n; i++) {
+		its.it_value.tv_sec = first / 1000000000;
+		its.it_value.tv_nsec = first % 1000000000;
+		its.it_interval.tv_sec = period / 1000000000;
+		its.it_interval.tv_nsec = period % 1000000000;
+		if (-1 == timer_settime(timers[i].id, TIMER_ABSTIME, &its, NULL)) {
+			perror("timer_settime didn't return success \n");
+			return PTS_UNRESOLVED;
+		}
+	}
+
+	switch (delivery) {
+	case DELIVER_SIGNAL:
+		if (-1 == sigprocmask(SIG_SETMASK, &oset, NULL)) {
+			perror("sigprocmask didn't return success \n");
+			return PTS_UNRESOLVED;
+		}
+		while (pts_now_ns() < end)
+			pts_sleep_ms(10);
+		sigprocmask(SIG_BLOCK, &set, NULL);
+		break;
+	case DELIVER_THREAD:
+		while (pts_now_ns() < end)
+			pts_sleep_ms(10);
+		break;
+	default:
+		while (pts_now_ns() < end) {
+			if (-1 == sigwaitinfo(&set, &info)) {
+				if (errno == EINTR)
+					continue;
+				perror("sigwaitinfo didn't return success \n");
+				return PTS_UNRESOLVED;
+			}
+			expired(info.si_value.sival_int);
+		}
+		break;
+	}
+
+	pthread_mutex_lock(&mtx);
+	active = 0;
+	pthread_mutex_unlock(&mtx);
+
+	for (i = 0; i < n; i++) {
+		if (-1 == timer_delete(timers[i].id)) {
+			perror("timer_delete didn't return success \n");
+			return PTS_UNRESOLVED;
+		}
+	}
+	drain();
+	sigprocmask(SIG_SETMASK, &oset, NULL);
+
+	lat = malloc(sizeof(pts_hist_t));
+	if (lat == NULL) {
+		perror("malloc didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+	pts_hist_init(lat);
+	for (i = 0; i < n; i++) {
+		notif += timers[i].notifications;
+		over += timers[i].overruns;
+		pts_hist_merge(lat, &timers[i].lat);
+	}
+
+	printf("%-11s %10.1f %6d %10llu %10llu %10llu %10llu %10llu\n",
+		deliveries[delivery], (double)period / 1000.0, n, notif, over,
+		pts_hist_percentile(lat, 50.0), pts_hist_percentile(lat, 99.0),
+		lat->max);
+
+	free(lat);
+	return PTS_PASS;
+}
+
+int main(int argc, char *argv[])
+{
+	struct sigaction act;
+	unsigned int p, c;
+	int delivery, ret;
+
+#ifndef	_POSIX_TIMERS
+	printf("_POSIX_TIMERS is not defined \n");
+	return PTS_UNRESOLVED;
+#endif
+
+	memset(&act, 0, sizeof(act));
+	act.sa_sigaction = handler;
+	act.sa_flags = SA_SIGINFO;
+	sigemptyset(&act.sa_mask);
+	if (-1 == sigaction(SIGTIMER, &act, NULL)) {
+		perror("sigaction didn't return success \n");
+		return PTS_UNRESOLVED;
+	}
+
+	printf("%d ms per case, latencies in ns\n", DURATION);
+	printf("%-11s %10s %6s %10s %10s %10s %10s %10s\n", "Delivery",
+		"Period(us)", "Timers", "Notified", "Overruns", "p50", "p99", "max");
+
+	for (delivery = DELIVER_SIGNAL; delivery <= DELIVER_SIGWAITINFO; delivery++) {
+		for (p = 0; p < NPERIODS; p++) {
+			period = periods[p];
+			for (c = 0; c < NCOUNTS; c++) {
+				ret = run(delivery, ntimers[c]);
+				if (ret != PTS_PASS) {
+					printf("Test UNRESOLVED\n");
+					return ret;
+				}
+			}
+		}
+	}
+
+	printf("Test PASSED\n");
+	return PTS_PASS;
+}
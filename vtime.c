@@ -0,0 +1,123 @@
+/*
+ * This file is licensed under the GPL license.  For the full content
+ * of this license, see the COPYING file at the top level of this
+ * source tree.
+ *
+ * This is a LD_PRELOAD helper which accelerates the sleeps used by
+ * the tests as mere synchronization delays ("let the other thread
+ * get there").
+ *
+ * sleep(), usleep() and nanosleep() are intercepted and the requested
+ * duration is divided by the PTS_VTIME_SCALE environment variable
+ * (default 10). When the call is interrupted, the remaining time
+ * reported to the caller is scaled back up, so the test sees
+ * consistent values.
+ *
+ * Build it with:
+ * $ cc -O2 -shared -fPIC -o vtime.so vtime.c -ldl -lpthread
+ * and use it as:
+ * $ LD_PRELOAD=./vtime.so PTS_VTIME_SCALE=20 ./test
+ *
+ * Tests which measure elapsed time or which expect a sleep to be
+ * interrupted by a timer must not be run through this helper. Such
+ * tests carry the PTS_REAL_TIME tag in a comment of their source; the
+ * "make VTIME=n run-tests" target leaves them on the real clock.
+ */
+
+/* dlsym(RTLD_NEXT, ...) is a GNU extension */
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NSEC_PER_SEC 1000000000LL
+
+typedef int (*nanosleep_t)(const struct timespec *, struct timespec *);
+
+static nanosleep_t real_nanosleep = NULL;
+static long long scale = 1;
+static pthread_once_t vtime_once = PTHREAD_ONCE_INIT;
+
+static void vtime_init(void)
+{
+	char *env;
+
+	real_nanosleep = (nanosleep_t) dlsym(RTLD_NEXT, "nanosleep");
+
+	env = getenv("PTS_VTIME_SCALE");
+	scale = (env != NULL) ? atoll(env) : 10;
+	if (scale < 1)
+		scale = 1;
+}
+
+/* Sleep for ns / scale nanoseconds; return the unslept time in real-scale ns */
+static int vtime_sleep(long long ns, long long *left)
+{
+	struct timespec req, rem;
+	int ret;
+
+	pthread_once(&vtime_once, vtime_init);
+
+	/* Without the real routine there is no way to sleep at all */
+	if (real_nanosleep == NULL)
+	{
+		if (left != NULL)
+			*left = ns;
+		errno = ENOSYS;
+		return -1;
+	}
+
+	ns /= scale;
+	req.tv_sec = ns / NSEC_PER_SEC;
+	req.tv_nsec = ns % NSEC_PER_SEC;
+
+	ret = real_nanosleep(&req, &rem);
+
+	if (left != NULL)
+		*left = (ret == 0) ? 0 :
+			(rem.tv_sec * NSEC_PER_SEC + rem.tv_nsec) * scale;
+
+	return ret;
+}
+
+int nanosleep(const struct timespec *req, struct timespec *rem)
+{
+	long long left;
+	int ret;
+
+	if ((req->tv_nsec < 0) || (req->tv_nsec >= NSEC_PER_SEC) || (req->tv_sec < 0))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	ret = vtime_sleep(req->tv_sec * NSEC_PER_SEC + req->tv_nsec, &left);
+
+	if ((ret != 0) && (rem != NULL))
+	{
+		rem->tv_sec = left / NSEC_PER_SEC;
+		rem->tv_nsec = left % NSEC_PER_SEC;
+	}
+
+	return ret;
+}
+
+unsigned int sleep(unsigned int seconds)
+{
+	long long left;
+
+	if (vtime_sleep(seconds * NSEC_PER_SEC, &left) == 0)
+		return 0;
+
+	/* Round up as the real sleep() would not report a full second too early */
+	return (unsigned int) ((left + NSEC_PER_SEC - 1) / NSEC_PER_SEC);
+}
+
+int usleep(useconds_t usec)
+{
+	return vtime_sleep(usec * 1000LL, NULL);
+}